@@ -19,6 +19,9 @@
  *
  * Using these datastructures, the tool can 'link' objects
  * together and construct dependency information.
+ *
+ * ELF objects and archives are also accepted and their symbol
+ * tables read directly (see scanBinary()).
  */
 
 /*
@@ -65,10 +68,26 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <assert.h>
-#include <search.h>
 #include <unistd.h>
 #include <string.h>
 #include <ctype.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 /*
  * some debugging flags are actually 'verbosity' flags
@@ -80,10 +99,20 @@
 #define DEBUG_LINK		(1<<3)
 #define DEBUG_UNLINK	(1<<4)
 #define DEBUG_COMMENT	(1<<5)
+#define DEBUG_TRACE		(1<<6)	/* binary trace events ('--trace-events') */
 
 #undef DEBUG
 
-#define NWORK
+/*
+ * run-time logging compiled in; building with e.g. -DLOG_MASK=0
+ * removes the link/unlink logging and tracing from the hot paths
+ * altogether.
+ */
+#ifndef LOG_MASK
+#define LOG_MASK		(DEBUG_LINK | DEBUG_UNLINK | DEBUG_TRACE)
+#endif
+
+#define LOGGING(flags)	(verbose & (flags) & (LOG_MASK))
 
 #define LINKER_VERSION_SEPARATOR '@'
 #define DUMMY_ALIAS_PREFIX       "__cexp_dummy_alias_"
@@ -120,29 +149,71 @@ typedef struct ObjFRec_ {
 	ObjF		next;		/* linked list of all objects */
 	Lib			lib;		/* libary we're part of or NULL */
 	LinkNodeRec link; 		/* link set we're a member of */
-	Xref		work;		/* temp pointer to do work */
-#ifdef NWORK
-	int         workDepth;
-#else
-	ObjF		work1;
-#endif
+	int			seq;		/* position in the list of all objects */
 	int			nexports;
 	Xref		exports;	/* symbols exported by this object */
 	int			nimports;
 	Xref		imports;	/* symbols imported by this object */
 } ObjFRec;
 
+/* slot of a name index; the key is a string owned by the item */
+typedef struct NameSlotRec_ {
+	unsigned		hash;
+	const char		*key;
+	void			*item;
+} NameSlotRec, *NameSlot;
+
+/* open-addressing (linear probing) hash table mapping names to items */
+typedef struct NameIdxRec_ {
+	NameSlot		slots;
+	unsigned		size;		/* number of slots; always a power of two */
+	unsigned		n;			/* number of occupied slots */
+} NameIdxRec, *NameIdx;
+
 typedef struct LibRec_ {
 	char	*name;
+	char	*bname;		/* 'name' stripped of any path (points into 'name') */
 	Lib		next;		/* linked list of libraries */
 	int		nfiles;
+	int		afiles;		/* allocated size of 'files' */
 	ObjF	*files;		/* pointer to an array of library members */
+	NameIdxRec members;	/* index of 'files' by name */
 } LibRec;
 
 
 typedef void (*DepWalkAction)   (ObjF f, int depth, void *closure);
 typedef void (*DepWalkActionRef)(Xref f, int depth, void *closure);
 
+/* frame of the explicit stack used by depwalk_rec() */
+typedef struct DepWalkFrameRec_ {
+	ObjF	f;
+	int		depth;
+	int		i;			/* index of the export/import currently processed */
+	Xref	ref;		/* next reference to examine for index 'i' (NULL: advance 'i') */
+	Xref	child;		/* reference we descended into; needs cleanup on return */
+} DepWalkFrameRec, *DepWalkFrame;
+
+/*
+ * State of a depwalk(). The work list and the 'visited' marks are
+ * kept here (indexed by ObjFRec.seq) rather than in the objects, so
+ * walks using different contexts may run concurrently (the database
+ * is only read).
+ */
+typedef struct DepWalkCtxRec_ {
+	DepWalkAction	action;
+	void			*closure;
+	int				mode;
+	unsigned		gen;		/* objects visited by the current walk have mark[seq] == gen */
+	unsigned		*mark;
+	Xref			*work;		/* work list: reference to the next object (BUSY: end) */
+	int				*depth;		/* depth at which an object was reached */
+	int				size;		/* number of elements of 'mark', 'work' and 'depth' */
+	DepWalkFrame	stack;
+	int				avail;
+	unsigned long	nodes;		/* statistics (see statReport()) */
+	unsigned long	edges;
+} DepWalkCtxRec, *DepWalkCtx;
+
 typedef struct DepPrintArgRec_ {
 	int		minDepth;
 	int 	indent;
@@ -156,6 +227,22 @@ typedef struct ProcTabRec_ {
 	int		linkNotUnlink;
 } ProcTabRec, *ProcTab;
 
+/*
+ * A configuration ('--config'): the lists to process and the files
+ * to write. The options preceding the first '--config' make up the
+ * unnamed default one.
+ */
+typedef struct ConfigRec_ {
+	char	*name;
+	ProcTab	procTab;
+	int		nProc;
+	int		hasOptional;	/* number of '-o' lists */
+	char	*scrn;			/* '-e' */
+	char	*srcn;			/* '-C' */
+	char	*cmpn;			/* '-K' */
+	char	*expn;			/* '--export' */
+} ConfigRec, *Config;
+
 
 #define TYPE(ref) ((ref)->xtype)
 
@@ -173,12 +260,18 @@ typedef struct ProcTabRec_ {
 #define INLINE
 #endif
 
-#define SYM_FLG_MARK 1
+#define SYM_FLG_MARK  1
+#define SYM_FLG_LIBDB 2	/* listed by a library nm_file (incremental database cache) */
 
 /* struct describing a symbol */
 typedef struct SymRec_ {
 	char	 *name;			/* we point 'name' to a string and store the type in 'name[-1]' */
+	int      len;			/* strlen(name) */
+	unsigned hash;			/* symHash(name, len) */
 	Xref	 exportedBy;	/* linked list of cross-references to objects exporting this symbol */
+	Xref	 exportedLast;	/* tail of 'exportedBy' (for appending in constant time) */
+	Xref	 exportedMax;	/* strongest of all but the last export (checked for redefinitions) */
+	Xref	 strongest;		/* cached strongestXref(exportedBy), maintained by fixupObj() */
 	Xref	 importedFrom;	/* anchor of a linked list of cross-references to objects importing this symbol */
 	int      flags;
 	int      refcnt;
@@ -193,6 +286,23 @@ typedef struct XrefRec_ {
 	char            xtype;
 } XrefRec;
 
+/* slot of the symbol hash table; the hash is kept in the slot
+ * so that probing doesn't have to touch the symbols
+ */
+typedef struct SymSlotRec_ {
+	unsigned		hash;
+	Sym				sym;
+} SymSlotRec, *SymSlot;
+
+/* open-addressing (linear probing) hash table of all symbols */
+typedef struct SymTblRec_ {
+	SymSlot			slots;
+	unsigned		size;		/* number of slots; always a power of two */
+	unsigned		nsyms;		/* number of occupied slots */
+} SymTblRec, *SymTbl;
+
+typedef void (*SymWalkAction)(Sym s, void *closure);
+
 /* 'forward' declaration of Variables     */
 static ObjFRec undefSymPod;
 
@@ -248,10 +358,13 @@ Xref r;
  *
  * This routine assumes that there can be multiple weak
  * definitions but only one strong definition.
+ *
+ * The export list doesn't change once it is built, hence
+ * fixupObj() maintains the result as exports are appended.
  */
 static INLINE Xref strongestExport(Sym s)
 {
-	return strongestXref(s->exportedBy);
+	return s->strongest;
 }
 
 static INLINE Xref strongestImport(Sym s)
@@ -278,6 +391,11 @@ static int	verbose =
 
 static int	force = 0;
 static int  emitUndefs = 0;
+static int  batchUnlink = 0;	/* use the batch unlink engine ('-B') */
+static int  nThreads = 1;		/* worker threads ('-j') */
+static int  sortedOutput = 0;	/* reproducible (sorted) output files ('-R') */
+static int  lowMem = 0;			/* release memory as soon as it's no longer needed ('--low-mem') */
+static int  listUndefs = 0;		/* list the undefined symbols ('--list-undefs') */
 
 #define WARN_UNDEFINED_SYMS (1<<0)
 
@@ -291,9 +409,16 @@ static int  emitUndefs = 0;
 
 static int warn = DEFAULT_WARN_FLAGS;
 
+/* expensive consistency checks ('--paranoid'); always on in PARANOID builds */
+#ifdef PARANOID
+static int  paranoid = 1;
+#else
+static int  paranoid = 0;
+#endif
+
 /* FUNCTION FORWARD DECLARATIONS */
 
-static void depwalk_rec(ObjF f, int depth);
+static void depwalk_rec(DepWalkCtx c, ObjF f, int depth);
 static void depPrint(ObjF f, int depth, void *closure);
 
 /* depwalk mode bits */
@@ -301,11 +426,14 @@ static void depPrint(ObjF f, int depth, void *closure);
 #define WALK_EXPORTS	(1<<1)
 #define WALK_IMPORTS	(0)
 
-void depwalk(ObjF f, DepWalkAction action, void *closure, int mode);
-int  checkCircWorkList(ObjF f);
-void depwalkListRelease(ObjF f);
-void workListIterate(ObjF f, DepWalkAction action, void *closure);
-void workListIterateRef(ObjF f, DepWalkActionRef action, void *closure);
+void depwalk(DepWalkCtx c, ObjF f, DepWalkAction action, void *closure, int mode);
+int  checkCircWorkList(DepWalkCtx c, ObjF f);
+void depwalkListRelease(DepWalkCtx c, ObjF f);
+void workListIterate(DepWalkCtx c, ObjF f, DepWalkAction action, void *closure);
+void workListIterateRef(DepWalkCtx c, ObjF f, DepWalkActionRef action, void *closure);
+
+/* context of the depwalks done by the main thread */
+static DepWalkCtxRec depwalkMain;
 
 /* VARIABLE FORWARD DECLARATIONS */
 extern LinkSetRec appLinkSet;
@@ -316,14 +444,21 @@ extern LinkSetRec optionalLinkSet;
 
 #define STRCHUNK	10000
 
-/* string space allocator (for strings living forever) */
+/*
+ * string space allocator (for strings living forever); strings
+ * longer than a quarter chunk get a block of their own so that the
+ * rest of the current chunk isn't wasted.
+ */
 char *stralloc(int len)
 {
 static char		*buf;
 static int		avail=0;
 char			*rval;
 
-	assert(len<=STRCHUNK);
+	if ( len > STRCHUNK/4 ) {
+		assert( rval = malloc(len) );
+		return rval;
+	}
 
 	if (len > avail) {
 		avail = STRCHUNK;
@@ -337,13 +472,16 @@ char			*rval;
 }
 
 #define MAXBUF	500
+#define LOG_BUFSIZE	(1<<16)	/* stdio buffer of 'logf' unless it's a terminal */
 
 #define NMFMT(max)  "%"#max"s"
 #define XNMFMT(m)	NMFMT(m)
 #define STRFMT		XNMFMT(MAXBUF)"%*[ \t]"
 /* #define FMT(max)	"%"#max"s%*[ \t]%c%*[^\n] \n" */
 
-/* format string to scan 'nm -g -fposix' output */
+/* format of a 'nm -g -fposix' line (used for diagnostics; scan_file()
+ * tokenizes in place)
+ */
 #define THEFMT 		"%c%x%x"
 
 /* GLOBAL VARIABLES */
@@ -351,6 +489,126 @@ char			*rval;
 /* streams where to print debugging and log messages, repectively */
 static FILE *debugf, *logf;
 
+/*
+ * Diagnostics emitted while building the database are recorded
+ * (if 'notesRecord' is set) so that they can be stored in and
+ * replayed from the database cache ('-c'). Every note is the
+ * stream tag ('E': stderr, 'L': logf) followed by the NUL-terminated
+ * message.
+ */
+static int		notesRecord = 0;
+static char		*notes      = 0;
+static size_t	notesSize   = 0;
+static size_t	notesAvail  = 0;
+
+static void
+logNote(FILE *feil, const char *fmt, ...)
+{
+va_list	ap;
+int		len;
+
+	va_start(ap, fmt);
+	len = vfprintf(feil, fmt, ap);
+	va_end(ap);
+
+	if ( !notesRecord || len < 0 )
+		return;
+
+	if ( notesSize + len + 2 > notesAvail ) {
+		notesAvail = 2*notesAvail + len + 2 + BUFSIZ;
+		assert( notes = realloc(notes, notesAvail) );
+	}
+	notes[notesSize++] = (feil == stderr) ? 'E' : 'L';
+	va_start(ap, fmt);
+	vsnprintf(notes + notesSize, len + 1, fmt, ap);
+	va_end(ap);
+	notesSize += len + 1;
+}
+
+/*
+ * Instrumentation ('--stats', '--stats-json'): wall and CPU time spent
+ * in the phases of a run and a few counters. Phases don't nest; a phase
+ * may be entered several times (the times add up).
+ */
+typedef enum {
+	STAT_SCAN = 0,			/* scanning nm_files */
+	STAT_XREFS,				/* placeXrefs() */
+	STAT_FIXUP,				/* fixupObj() loop */
+	STAT_UNDEFS,			/* gatherDanglingUndefs() */
+	STAT_CACHE_LOAD,		/* dbcLoad() */
+	STAT_CACHE_WRITE,		/* dbcWrite() */
+	STAT_INDEX,				/* fileListBuildIndex() */
+	STAT_LINK,				/* linking the application and optional link sets */
+	STAT_PROCESS,			/* '-o'/'-x' lists */
+	STAT_REPORTS,			/* '-s', '-t', '-d', '-D' */
+	STAT_UNLINK_UNDEFS,		/* unlinkUndefs() */
+	STAT_UNLINK_MULTDEFS,	/* unlinkMultdefs() */
+	STAT_WRITE,				/* '-e', '-C', '-K', '--export' */
+	STAT_NPHASES
+} StatPhase;
+
+static const char *statPhaseNames[STAT_NPHASES] = {
+	"scan",
+	"place_xrefs",
+	"fixup",
+	"gather_undefs",
+	"cache_load",
+	"cache_write",
+	"build_index",
+	"link",
+	"process_lists",
+	"reports",
+	"unlink_undefs",
+	"unlink_multdefs",
+	"write_output",
+};
+
+typedef struct StatsRec_ {
+	int				on;
+	int				human;		/* report on stderr */
+	char			*json;		/* file for the JSON report */
+	double			start[2];	/* wall / cpu time when the run started */
+	double			begin[2];	/* ... when the current phase started */
+	double			t[STAT_NPHASES][2];
+	unsigned long	lines;		/* lines scanned */
+	unsigned long	probes;		/* symbol table slots probed */
+	unsigned long	walkNodes;	/* objects visited by depwalk() */
+	unsigned long	walkEdges;	/* cross-references followed by depwalk() */
+	unsigned long	unlinkCalls;/* unlinkObj() calls */
+	unsigned long	released;	/* bytes released early ('--low-mem') */
+} StatsRec;
+
+static StatsRec stats = { 0 };
+
+/* store the current wall and (process) cpu time in 't' */
+static void
+statNow(double *t)
+{
+struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t[0] = ts.tv_sec + 1.0E-9 * ts.tv_nsec;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	t[1] = ts.tv_sec + 1.0E-9 * ts.tv_nsec;
+}
+
+static INLINE void
+statBegin(StatPhase ph)
+{
+	if ( stats.on )
+		statNow(stats.begin);
+}
+
+static INLINE void
+statEnd(StatPhase ph)
+{
+double now[2];
+	if ( stats.on ) {
+		statNow(now);
+		stats.t[ph][0] += now[0] - stats.begin[0];
+		stats.t[ph][1] += now[1] - stats.begin[1];
+	}
+}
+
 /*
  * a "special" object exporting all symbols not defined
  * anywhere else
@@ -387,11 +645,14 @@ static int	numFiles = 1; /* undefFilePod */
 Lib  libListHead=0, libListTail=0;
 static int  numLibs  = 0;
 
+/* index of all known libraries (by name stripped of any path) */
+static NameIdxRec libIndex = { 0 };
+
 /* sorted index (by name) of all known object files */
 ObjF *fileListIndex = 0;
 
-/* The global symbol table (a binary tree) */
-void *symTbl = 0;
+/* The global symbol table (a hash table) */
+SymTblRec symTbl = { 0 };
 
 /* Global table of search paths */
 static char *defPaths[]={"."};
@@ -414,24 +675,236 @@ fileListFirst()
 }
 
 
-/* Compare two symbols by their name (suitable for tsearch/tfind) */
+/* Compare two symbols by their name (suitable for qsort on an array of Sym) */
 static int
 symcmp(const void *a, const void *b)
 {
-const Sym sa=(const Sym)a, sb=(const Sym)b;
-	return strcmp(sa->name, sb->name);
+const Sym sa=*(const Sym*)a, sb=*(const Sym*)b;
+	/* symbols are unique */
+	return sa == sb ? 0 : strcmp(sa->name, sb->name);
 }
 
-/* Compare two library names stripping any path from either */
-static int
-libcmp(const char *a, const char *b)
+/* FNV-1a */
+static INLINE unsigned
+symHash(const char *name, int len)
+{
+unsigned h = 2166136261U;
+	while ( len-- > 0 ) {
+		h ^= *(const unsigned char*)name++;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+#define SYMTBL_MIN_SIZE	1024
+
+/* (Re)size the symbol table to hold at least 'nsyms' symbols without
+ * exceeding a load factor of 1/2.
+ */
+static void
+symTblResize(SymTbl t, unsigned nsyms)
+{
+SymSlot		old = t->slots;
+unsigned	osz = t->size;
+unsigned	sz, i, j;
+
+	for ( sz = SYMTBL_MIN_SIZE; sz < 2*nsyms; sz <<= 1 )
+		/* nothing else to do */;
+
+	if ( sz <= osz )
+		return;
+
+	assert( t->slots = calloc(sz, sizeof(*t->slots)) );
+	t->size = sz;
+
+	for ( i=0; i<osz; i++ ) {
+		if ( !old[i].sym )
+			continue;
+		for ( j = old[i].hash & (sz-1); t->slots[j].sym; j = (j+1) & (sz-1) )
+			/* nothing else to do */;
+		t->slots[j] = old[i];
+	}
+	free(old);
+}
+
+/* Locate the slot for 'name' (which is either occupied by the symbol or empty) */
+static INLINE SymSlot
+symTblProbe(SymTbl t, const char *name, int len, unsigned hash)
+{
+unsigned	mask = t->size - 1;
+unsigned	i;
+Sym			s;
+
+	for ( i = hash & mask; (s = t->slots[i].sym); i = (i+1) & mask ) {
+		stats.probes++;
+		if ( t->slots[i].hash == hash && s->len == len && !memcmp(s->name, name, len) )
+			break;
+	}
+	stats.probes++;
+	return &t->slots[i];
+}
+
+/* Find a symbol by name; RETURNS NULL if not found */
+Sym
+symTblFind(SymTbl t, const char *name)
+{
+int len = strlen(name);
+	if ( !t->size )
+		return 0;
+	return symTblProbe(t, name, len, symHash(name, len))->sym;
+}
+
+/*
+ * Look up the symbol named 'nsym->name' ('nsym->len' and 'nsym->hash'
+ * must be set); if it is not present then 'nsym' is entered into
+ * the table.
+ *
+ * RETURNS: the symbol found in the table ('nsym' if it was added).
+ */
+Sym
+symTblSearch(SymTbl t, Sym nsym)
+{
+SymSlot slot;
+
+	if ( 2*(t->nsyms + 1) > t->size )
+		symTblResize(t, t->nsyms + 1);
+
+	slot = symTblProbe(t, nsym->name, nsym->len, nsym->hash);
+	if ( ! slot->sym ) {
+		slot->hash = nsym->hash;
+		slot->sym  = nsym;
+		t->nsyms++;
+	}
+	return slot->sym;
+}
+
+/* Invoke 'action' for every symbol in the table (sorted by name) */
+void
+symTblWalk(SymTbl t, SymWalkAction action, void *closure)
+{
+Sym			*sorted;
+unsigned	i, n;
+
+	if ( !t->nsyms )
+		return;
+
+	assert( sorted = malloc(t->nsyms * sizeof(*sorted)) );
+	for ( i=n=0; i<t->size; i++ ) {
+		if ( t->slots[i].sym )
+			sorted[n++] = t->slots[i].sym;
+	}
+	qsort(sorted, n, sizeof(*sorted), symcmp);
+	for ( i=0; i<n; i++ )
+		action(sorted[i], closure);
+	free(sorted);
+}
+
+#define NAMEIDX_MIN_SIZE	8
+
+/* Grow a name index so it can hold 'n' items with a load factor <= 1/2 */
+static void
+nameIdxResize(NameIdx x, unsigned n)
+{
+NameSlot	old = x->slots;
+unsigned	osz = x->size;
+unsigned	sz, i, j;
+
+	for ( sz = NAMEIDX_MIN_SIZE; sz < 2*n; sz <<= 1 )
+		/* nothing else to do */;
+
+	if ( sz <= osz )
+		return;
+
+	assert( x->slots = calloc(sz, sizeof(*x->slots)) );
+	x->size = sz;
+
+	for ( i=0; i<osz; i++ ) {
+		if ( !old[i].item )
+			continue;
+		for ( j = old[i].hash & (sz-1); x->slots[j].item; j = (j+1) & (sz-1) )
+			/* nothing else to do */;
+		x->slots[j] = old[i];
+	}
+	free(old);
+}
+
+/* Find the item keyed by 'key' (with hash 'hash'); RETURNS NULL if not found */
+static void *
+nameIdxFind(NameIdx x, const char *key, unsigned hash)
+{
+unsigned mask = x->size - 1;
+unsigned i;
+
+	if ( !x->size )
+		return 0;
+
+	for ( i = hash & mask; x->slots[i].item; i = (i+1) & mask ) {
+		if ( x->slots[i].hash == hash && !strcmp(x->slots[i].key, key) )
+			return x->slots[i].item;
+	}
+	return 0;
+}
+
+/* Add an item (the caller asserts that 'key' is not present yet) */
+static void
+nameIdxAdd(NameIdx x, const char *key, unsigned hash, void *item)
+{
+unsigned i;
+
+	if ( 2*(x->n + 1) > x->size )
+		nameIdxResize(x, x->n + 1);
+
+	for ( i = hash & (x->size - 1); x->slots[i].item; i = (i+1) & (x->size - 1) )
+		/* nothing else to do */;
+
+	x->slots[i].hash = hash;
+	x->slots[i].key  = key;
+	x->slots[i].item = item;
+	x->n++;
+}
+
+/* Strip any path from a library name */
+static INLINE char *
+libBasename(char *name)
+{
+char *tmp;
+	return (tmp = strrchr(name, '/')) ? tmp + 1 : name;
+}
+
+/*
+ * Library and object names are interned: every distinct name is
+ * stored once, so names can be compared for equality by pointer.
+ */
+static NameIdxRec strIndex = { 0 };
+
+/* RETURNS the interned copy of 'str' or NULL if there is none */
+static char *
+strInterned(const char *str)
+{
+	return nameIdxFind(&strIndex, str, symHash(str, strlen(str)));
+}
+
+/*
+ * RETURNS the interned copy of 'str'; if there is none yet, 'str' itself
+ * is entered ('copy' == 0; it must live forever) or a copy of it.
+ */
+static char *
+strIntern(char *str, int copy)
 {
-register char *tmp;
-	if ( tmp = strrchr(a,'/') )
-		a = tmp+1;
-	if ( tmp = strrchr(b,'/') )
-		b = tmp+1;
-	return strcmp(a,b);
+int      len  = strlen(str);
+unsigned hash = symHash(str, len);
+char     *rval;
+
+	if ( !(rval = nameIdxFind(&strIndex, str, hash)) ) {
+		if ( copy ) {
+			assert( rval = stralloc(len + 1) );
+			memcpy(rval, str, len + 1);
+		} else {
+			rval = str;
+		}
+		nameIdxAdd(&strIndex, rval, hash, rval);
+	}
+	return rval;
 }
 
 /* find and open a file */
@@ -455,6 +928,31 @@ int  i;
 	free(buf);
 	return rval;
 }
+
+/*
+ * Estimate (generously) the number of symbols listed in a set
+ * of nm files from their sizes. Used to pre-size the
+ * symbol table so that it never needs to be rehashed.
+ */
+#define NM_BYTES_PER_SYM	16
+
+static unsigned long
+estimateSymbols(char **fnams, int n)
+{
+unsigned long	rval = 0;
+struct stat		st;
+FILE			*f;
+int				i;
+
+	for ( i=0; i<n; i++ ) {
+		if ( (f = ffind(fnams[i])) ) {
+			if ( 0 == fstat(fileno(f), &st) )
+				rval += st.st_size / NM_BYTES_PER_SYM;
+			fclose(f);
+		}
+	}
+	return rval;
+}
 	
 /*
  * Fixup an object, i.e. set final values for pointers at a time
@@ -476,21 +974,27 @@ int		i;
 		/* append to list of modules exporting this symbol */
 		sym = ex->sym;
 		if ( sym->exportedBy ) {
-			Xref etmp, max;
-			for ( max = etmp = sym->exportedBy; XREF_NEXT(etmp); etmp=XREF_NEXT(etmp) ) {
-				if ( strongerXref( etmp, max ) ) {
-					max = etmp;
-				}
-			}
+			Xref etmp = sym->exportedLast, max = sym->exportedMax;
 			if ( ISSTRONG( TYPE(max)) && ISSTRONG( TYPE(ex) )  ) {
 				if ( !ISCOMMON( TYPE( max ) ) || ! ISCOMMON( TYPE( ex ) ) ) {
-					fprintf(logf, "Redefinition of %s in %s\n", sym->name, f->name);
+					logNote(logf, "Redefinition of %s in %s\n", sym->name, f->name);
 				}
 			}
+			/* the current tail is no longer the last export */
+			if ( strongerXref( etmp, max ) ) {
+				sym->exportedMax = etmp;
+			}
+			/* strongestXref() picks the first export stronger than the head */
+			if ( sym->strongest == sym->exportedBy && strongerXref( ex, sym->exportedBy ) ) {
+				sym->strongest = ex;
+			}
 			xref_set_next(etmp, ex);
 		} else {
-			sym->exportedBy = ex;
+			sym->exportedBy  = ex;
+			sym->exportedMax = ex;
+			sym->strongest   = ex;
 		}
+		sym->exportedLast = ex;
 	}
 }
 
@@ -501,47 +1005,53 @@ createLib(char *name)
 Lib	rval;
 
 	assert( rval = calloc(1, sizeof(*rval)) );
-	assert( rval->name = stralloc(strlen(name) + 1) );
-	strcpy( rval->name, name );
+	rval->name  = strIntern(name, 1);
+	rval->bname = libBasename(rval->name);
 	if (libListTail)
 		libListTail->next = rval;
 	else
 		libListHead	= rval;
 	libListTail = rval;
 	numLibs++;
+	nameIdxAdd(&libIndex, rval->bname, symHash(rval->bname, strlen(rval->bname)), rval);
 	return rval;
 }
 
-/* Add an object file to a library */
-ObjF
-libAddObj(char *libname, char *objname, ObjF obj)
+/*
+ * Find a library by name (ignoring any path); a new library
+ * is created if none is found and 'create' is nonzero.
+ */
+static Lib
+libFind(char *libname, int create)
 {
-Lib l;
-int i;
-	for (l=libListHead; l; l=l->next) {
-		if ( !libcmp(l->name, libname) )
-			break;
-	}
-	if ( !l ) {
+Lib  l;
+char *bname = libBasename(libname);
+
+	if ( !(l = nameIdxFind(&libIndex, bname, symHash(bname, strlen(bname)))) && create ) {
 		/* must create a new library */
 		l = createLib(libname);
 	}
-	/* seems that a single object file can occur multiple times in a library
-	 * (libbsd.a / arm-rtems4.12)
-	 */
-	for ( i=0; i<l->nfiles; i++) {
-		if ( 0 == strcmp(l->files[i]->name, objname) ) {
-			fprintf(stderr,"WARNING: multiple occurrences of '%s' in lib '%s'\n", objname, libname);
-			return l->files[i];
-		}
-	}
-	i = l->nfiles+1;
-	assert( l->files = realloc(l->files, i * sizeof(*l->files)) );
+	return l;
+}
+
+/* Find a library member by name; RETURNS NULL if not found */
+static ObjF
+libFindObj(Lib l, char *objname)
+{
+	return nameIdxFind(&l->members, objname, symHash(objname, strlen(objname)));
+}
 
-	l->files[l->nfiles] = obj;
-	l->nfiles = i;
+/* Add an object file to a library */
+static void
+libAddObj(Lib l, ObjF obj)
+{
+	if ( l->nfiles == l->afiles ) {
+		l->afiles = l->afiles ? 2*l->afiles : 16;
+		assert( l->files = realloc(l->files, l->afiles * sizeof(*l->files)) );
+	}
+	l->files[l->nfiles++] = obj;
 	obj->lib  = l;
-	return obj;
+	nameIdxAdd(&l->members, obj->name, symHash(obj->name, strlen(obj->name)), obj);
 }
 
 /*
@@ -586,24 +1096,28 @@ static int
 printObjName(FILE *feil, ObjF f)
 {
 Lib l = f->lib;
-char *lname = "";
+char *lname = l ? l->bname : "";
 
-	if ( l ) {
-		if ((lname = strrchr(l->name,'/'))) {
-			lname++;
-		} else  {
-			lname = l->name;
-		}
-	}
 	return fprintf(feil, l ? "%s[%s]" : "%s%s", lname, f->name);
 }
 
+/* Format the name of 'f' as printObjName() does; RETURNS 'buf' */
+static char *
+sprintObjName(char *buf, int size, ObjF f)
+{
+Lib l = f->lib;
+char *lname = l ? l->bname : "";
+
+	snprintf(buf, size, l ? "%s[%s]" : "%s%s", lname, f->name);
+	return buf;
+}
+
 /* Create an object file 'object' */
 static ObjF
 createObj(char *name)
 {
-ObjF obj, libobj;
-int  l = strlen(name);
+ObjF obj = 0;
+Lib  lib = 0;
 char *po,*pc,*objn;
 
 	/* is it part of a library ? */
@@ -612,28 +1126,31 @@ char *po,*pc,*objn;
 	if (!objn)
 		exit(1); /* found an ill-formed name; fatal */
 
-	assert( obj = calloc(1, sizeof(*obj)) );
-
-	libobj = obj;
-
 	if (po) {
 		/* part of a library */
-		libobj = libAddObj(name, objn, obj);
+		lib = libFind(name, 1);
+		/* seems that a single object file can occur multiple times in a library
+		 * (libbsd.a / arm-rtems4.12)
+		 */
+		if ( (obj = libFindObj(lib, objn)) ) {
+			/* this obj already present in library; extend */
+			logNote(stderr,"WARNING: multiple occurrences of '%s' in lib '%s'\n", objn, name);
+		}
 	}
 
-	if ( libobj != obj ) {
-		/* this obj already present in library; extend */
-		free( obj );
-		obj = libobj;
-	} else {
+	if ( !obj ) {
+		assert( obj = calloc(1, sizeof(*obj)) );
+
 		/* build/copy name */
-		assert( obj->name = stralloc(strlen(objn) + 1) );
-		strcpy( obj->name, objn );
+		obj->name = strIntern(objn, 1);
+
+		if ( lib )
+			libAddObj(lib, obj);
 
 		/* append to list of objects */
 		fileListTail->next = obj;
 		fileListTail = obj;
-		numFiles++;
+		obj->seq     = numFiles++;
 	}
 
 	if ( po ) {
@@ -672,102 +1189,868 @@ sym_significance(char type)
 	return SIGNIFICANCE_STRNG;
 }
 
+/*
+ * While scanning, cross-references are merely staged in a
+ * chunked arena (and counted per object). Once all files have
+ * been scanned, placeXrefs() moves them into a single, exactly
+ * sized slab.
+ */
+#define XREF_STAGE_CHUNK	4096
+
+typedef struct XrefStageRec_ {
+	ObjF	obj;
+	Sym		sym;
+	int		size;
+	char	xtype;
+	char	isImport;
+} XrefStageRec, *XrefStage;
+
+typedef struct XrefStageChunkRec_ *XrefStageChunk;
+
+typedef struct XrefStageChunkRec_ {
+	XrefStageChunk	next;
+	int				n;
+	XrefStageRec	recs[XREF_STAGE_CHUNK];
+} XrefStageChunkRec;
+
+static XrefStageChunk	xrefStageHead = 0, xrefStageTail = 0;
+static unsigned long	numXrefs      = 0;
+
+static INLINE void
+stageXref(ObjF obj, Sym sym, int type, int size, int isImport)
+{
+XrefStage st;
+
+	if ( !xrefStageTail || XREF_STAGE_CHUNK == xrefStageTail->n ) {
+		XrefStageChunk c;
+		assert( c = malloc(sizeof(*c)) );
+		c->next = 0;
+		c->n    = 0;
+		if ( xrefStageTail )
+			xrefStageTail->next = c;
+		else
+			xrefStageHead       = c;
+		xrefStageTail = c;
+	}
+	st = &xrefStageTail->recs[xrefStageTail->n++];
+	st->obj      = obj;
+	st->sym      = sym;
+	st->size     = size;
+	st->xtype    = type;
+	st->isImport = isImport;
+	sym->refcnt++;
+	numXrefs++;
+}
+
 static void
 add_export(ObjF obj, Sym sym, int type, unsigned size)
 {
-Xref ex;
-
 	obj->nexports++;
-	assert( obj->exports = realloc(obj->exports, sizeof(*obj->exports) * obj->nexports) );
-	/* check alignment with flags */
-	assert( 0 == ((unsigned long)obj->exports & XREF_FLAGS) );
-	ex = &obj->exports[obj->nexports - 1];
-	ex->sym   = sym;
-	sym->refcnt++;
-	ex->obj   = obj;
-	ex->xtype = type;
-	ex->size  = size;
-	xref_set_next(ex,0);
+	stageXref(obj, sym, type, size, 0);
 }
 
 static void
 add_import(ObjF obj, Sym sym, int type)
 {
-Xref im;
-
 	obj->nimports++;
-	assert( obj->imports = realloc(obj->imports, sizeof(*obj->imports) * obj->nimports) );
-	/* check alignment with flags */
-	assert( 0 == ((unsigned long)obj->imports & XREF_FLAGS) );
-	im = &obj->imports[obj->nimports - 1];
-	im->sym   = sym;
-	sym->refcnt++;
-	im->obj   = obj;
-	im->xtype = type;
-	im->size  = -1;
-	xref_set_next(im,0);
+	stageXref(obj, sym, type, -1, 1);
 }
 
-/* Scan a file generated with 'nm -g -fposix' */
-int
-scan_file(FILE *f, char *name)
+/*
+ * Move all staged cross-references into the export and import
+ * arrays of their objects. All arrays are carved out of one slab;
+ * objects are laid out in file-list order, each with its exports
+ * followed by its imports. Must be called after scanning (for the
+ * objects from 'from' to the end of the file list, i.e., all objects
+ * scanned since the last call) and before fixupObj().
+ */
+static void
+placeXrefs(ObjF from)
 {
-char	buf[MAXBUF+1];
-char	*rest;
-int		got;
-char	type, otype;
-int		line=0;
-ObjF	obj =0;
-int		len;
-int		weak;
-int		size;
-int		val;
-Sym		nsym = 0,sym;
-Sym		*found;
-Xref    ref;
-
-	/* tag end of buffer */
-	buf[MAXBUF]='X';
+Xref			slab, ref;
+ObjF			f;
+XrefStageChunk	c, n;
+XrefStage		st;
+int				i;
 
-	while ( fgets(buf, sizeof(buf), f) ) {
+	if ( !numXrefs )
+		return;
 
-		/* scan the initial string and chop everything beyond the first whitespace off */
-		for (rest = buf; *rest && ' '!= *rest && '\t'!=*rest && '\n'!=*rest; rest++)
-			/* nothing else to do */;
+	statBegin(STAT_XREFS);
+	assert( slab = malloc(numXrefs * sizeof(*slab)) );
+	/* check alignment with flags */
+	assert( 0 == ((unsigned long)slab & XREF_FLAGS) );
+
+	for ( f = from; f; f = f->next ) {
+		f->exports  = f->nexports ? slab : 0;
+		slab       += f->nexports;
+		f->imports  = f->nimports ? slab : 0;
+		slab       += f->nimports;
+		/* used as fill counters below */
+		f->nexports = f->nimports = 0;
+	}
 
-		got = (rest == buf) ? 0 : 1;
-		if ( *rest )
-			*rest++ = 0;
-		
-		if ( got && *rest )
-			got += sscanf(rest, THEFMT, &otype, &val, &size);
+	for ( c = xrefStageHead; c; c = n ) {
+		for ( i=0, st=c->recs; i<c->n; i++, st++ ) {
+			f   = st->obj;
+			ref = st->isImport ? &f->imports[f->nimports++] : &f->exports[f->nexports++];
+			ref->sym   = st->sym;
+			ref->obj   = f;
+			ref->xtype = st->xtype;
+			ref->size  = st->size;
+			xref_set_next(ref, 0);
+		}
+		n = c->next;
+		free(c);
+	}
+	xrefStageHead = xrefStageTail = 0;
+	numXrefs      = 0;
+	statEnd(STAT_XREFS);
+}
 
-		line++;
+/* 'nm_files' may also be ELF objects or archives (see scanBinary()) */
+#define AR_MAGIC		"!<arch>\n"
+#define AR_THIN_MAGIC	"!<thin>\n"
+#define ELF_MAGIC		"\177ELF"
 
-		if ( !buf[MAXBUF] ) {
-			fprintf(stderr,"Scanner buffer overrun\n");
-			return -1;
+/* nonzero if a buffer holds an object or archive (rather than 'nm' output) */
+static int
+binaryInput(const char *buf, size_t len)
+{
+	return    (len >= 4 && 0 == memcmp(buf, ELF_MAGIC, 4))
+	       || (len >= 8 && (0 == memcmp(buf, AR_MAGIC, 8) || 0 == memcmp(buf, AR_THIN_MAGIC, 8)));
+}
+
+/*
+ * Obtain the contents of a 'nm' file in a single buffer.
+ *
+ * Regular files are memory-mapped (private mapping; the scanner
+ * terminates tokens in place and the dirtied pages are not written
+ * back). Anything else (stdin, pipes) is read into malloc()ed memory.
+ *
+ * The buffer of a text file is guaranteed to end with a '\n' so that
+ * the scanner always finds a place to terminate the last token (objects
+ * and archives are mapped as they are). Symbol names point into it,
+ * so it is kept unless '--low-mem' is used (then scanSymResolve() copies
+ * the names and scanJobRelease() drops the buffer).
+ *
+ * RETURNS: pointer to the buffer (length in *plen, nonzero in *pmapped
+ *          if it was mmap()ed) or NULL on error.
+ */
+static char *
+mapFile(FILE *f, size_t *plen, int *pmapped)
+{
+struct stat	st;
+char		*rval;
+size_t		len, avail;
+int			got;
+
+	if ( 0 == fstat(fileno(f), &st) && S_ISREG(st.st_mode) && st.st_size > 0 ) {
+		rval = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), 0);
+		if ( MAP_FAILED != rval ) {
+			if ( '\n' == rval[st.st_size - 1] || binaryInput(rval, st.st_size) ) {
+				*plen    = st.st_size;
+				*pmapped = 1;
+				return rval;
+			}
+			/* missing final newline; no room to terminate the last token */
+			munmap(rval, st.st_size);
+		}
+	}
+
+	/* streaming fallback */
+	len   = 0;
+	avail = 0;
+	rval  = 0;
+	do {
+		if ( avail - len < BUFSIZ + 1 ) {
+			avail = avail ? 2*avail : 16*BUFSIZ;
+			assert( rval = realloc(rval, avail) );
+		}
+		got  = fread(rval + len, 1, avail - len - 1, f);
+		len += got;
+	} while ( got > 0 );
+
+	if ( ferror(f) ) {
+		free(rval);
+		return 0;
+	}
+
+	if ( 0 == len || '\n' != rval[len - 1] )
+		rval[len++] = '\n';
+
+	*plen    = len;
+	*pmapped = 0;
+	return rval;
+}
+
+/*
+ * Classify the 'nm' type letter 'otype' of a global symbol; the
+ * text and the ELF scanner both go through here. The GNU letters
+ * are recorded as the type they behave like: 'u' (unique global,
+ * the definitions of all objects are merged) as a weak object and
+ * 'i' (indirect function) as a function.
+ *
+ * RETURNS: the type to record, 0 if 'otype' is unknown.
+ */
+static char
+scanSymType(char otype)
+{
+	switch ( otype ) {
+		case 'u': return 'V';
+		case 'i': return 'T';
+		default:  break;
+	}
+
+	switch ( TOUPPER(otype) ) {
+		case 'W': case 'V': case 'D': case 'T': case 'B': case 'R':
+		case 'G': case 'S': case 'A': case 'C': case 'N':
+		case '?': case 'w': case 'U':
+			return otype;
+
+		default:
+			break;
+	}
+	return 0;
+}
+
+/*
+ * Scan a hex number from [*pp, end) with the semantics
+ * of sscanf's "%x" (leading white space is skipped).
+ *
+ * RETURNS: 1 if a number was converted, 0 otherwise.
+ */
+static INLINE int
+scanHex(char **pp, char *end, int *pval)
+{
+char			*p = *pp;
+unsigned long	v  = 0;
+int				d;
+
+	while ( p < end && isspace(*(unsigned char*)p) )
+		p++;
+
+	if ( p + 1 < end && '0' == p[0] && ('x' == p[1] || 'X' == p[1]) && p + 2 < end && isxdigit(*(unsigned char*)(p+2)) )
+		p += 2;
+
+	if ( p >= end || !isxdigit(*(unsigned char*)p) )
+		return 0;
+
+	do {
+		d = *(unsigned char*)p;
+		v = (v << 4) | (isdigit(d) ? d - '0' : tolower(d) - 'a' + 10);
+	} while ( ++p < end && isxdigit(*(unsigned char*)p) );
+
+	*pval = (int)v;
+	*pp   = p;
+	return 1;
+}
+
+/*
+ * Make sure a stack (array) of elements of size 'elsz' can hold
+ * 'need' elements; it grows geometrically and is never shrunk.
+ */
+static void *
+stackReserve(void *stack, int *pavail, int need, size_t elsz)
+{
+	if ( need > *pavail ) {
+		*pavail = *pavail ? 2 * *pavail : 256;
+		if ( *pavail < need )
+			*pavail = need;
+		assert( stack = realloc(stack, *pavail * elsz) );
+	}
+	return stack;
+}
+
+/*
+ * Scanning is split in two phases so that several files can be parsed
+ * concurrently ('-j'):
+ *
+ * scanParse() tokenizes a file into a list of 'events' (objects, symbol
+ * lines, diagnostics) without touching any global table; symbol names
+ * are hashed already.
+ *
+ * scanApply() replays the events (in command line order), creating the
+ * objects and entering symbols and cross-references into the global
+ * tables. Diagnostics are thus emitted in the same order as if all files
+ * were scanned one after another.
+ */
+#define SCAN_OBJ	1		/* start of an object named 'str' */
+#define SCAN_SYM	2		/* symbol line; 'str' is the name */
+#define SCAN_MSG	3		/* diagnostic 'str' for stderr */
+
+typedef struct ScanEvtRec_ {
+	char		*str;
+	int			len;		/* strlen(str) and */
+	unsigned	hash;		/* symHash(str) of a symbol */
+	int			size;
+	char		kind;
+	char		otype;
+	char		owned;		/* 'str' was malloc()ed */
+} ScanEvtRec, *ScanEvt;
+
+/* apply events (when scanning serially) as soon as this many are pending */
+#define SCAN_FLUSH	4096
+
+typedef struct ScanJobRec_ {
+	char		*name;		/* name of the nm file */
+	FILE		*file;
+	ScanEvt		evts;
+	int			nevts;
+	int			aevts;
+	ObjF		obj;		/* current object (scanApply()) */
+	int			flush;		/* apply events while parsing */
+	int			status;		/* scanParse() return value */
+	int			err;		/* errno if the file couldn't be opened */
+	int			done;		/* parsing finished */
+	int			lines;		/* lines parsed */
+	char		*buf;		/* contents of the file (mapFile()) */
+	size_t		buflen;
+	int			mapped;
+} ScanJobRec, *ScanJob;
+
+static void scanApply(ScanJob job);
+
+static ScanEvt
+scanEvt(ScanJob job, int kind)
+{
+ScanEvt ev;
+	if ( job->flush && job->nevts >= SCAN_FLUSH )
+		scanApply(job);
+	job->evts  = stackReserve(job->evts, &job->aevts, job->nevts + 1, sizeof(*job->evts));
+	ev         = &job->evts[job->nevts++];
+	memset(ev, 0, sizeof(*ev));
+	ev->kind   = kind;
+	return ev;
+}
+
+/* record a diagnostic message */
+static void
+scanMsg(ScanJob job, const char *fmt, ...)
+{
+va_list	ap;
+ScanEvt	ev;
+int		len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(0, 0, fmt, ap);
+	va_end(ap);
+
+	ev = scanEvt(job, SCAN_MSG);
+	assert( ev->str = malloc(len + 1) );
+	ev->owned = 1;
+
+	va_start(ap, fmt);
+	vsnprintf(ev->str, len + 1, fmt, ap);
+	va_end(ap);
+}
+
+/* tag symbols resolved by scanApply() with SYM_FLG_LIBDB */
+static int scanMarkSyms = 0;
+
+/* find the global symbol named by a SCAN_SYM event (entering it if necessary) */
+static Sym
+scanSymResolve(ScanEvt ev)
+{
+static Sym nsym = 0;
+Sym        sym;
+
+	if ( !nsym )
+		assert( nsym = calloc(1,sizeof(*nsym)) );
+
+	/* the name is a slice of the file buffer */
+	nsym->name = ev->str;
+	nsym->len  = ev->len;
+	nsym->hash = ev->hash;
+
+	sym = symTblSearch(&symTbl, nsym);
+	if ( sym == nsym ) {
+		/* the scanner's buffer goes away ('--low-mem') */
+		if ( lowMem ) {
+			assert( sym->name = stralloc(ev->len + 1) );
+			memcpy(sym->name, ev->str, ev->len + 1);
+		}
+#if DEBUG & DEBUG_TREE
+		fprintf(debugf,"Adding new symbol %s (sym %p)\n",sym->name, sym);
+#endif
+		nsym = 0;
+	} else {
+#if DEBUG & DEBUG_TREE
+		fprintf(debugf,"Found existing symbol %s (sym %p)\n",sym->name, sym);
+#endif
+	}
+	if ( scanMarkSyms )
+		sym->flags |= SYM_FLG_LIBDB;
+	return sym;
+}
+
+/*
+ * Direct ingestion of ELF objects and 'ar' archives of ELF objects
+ * (no 'nm' pass needed). The symbol tables are read from the mapped
+ * file and translated into the same events (and type letters) as
+ * 'nm -g -fposix' would produce:
+ *
+ *   undefined           'U' (weak: 'w')
+ *   common              'C'
+ *   weak definition     'V' (data object) or 'W'
+ *   absolute            'A'
+ *   code                'T'
+ *   uninitialized data  'B' ('S' for small data, .sbss*)
+ *   read-only data      'R'
+ *   data                'D' ('G' for small data, .sdata*)
+ *   anything else       'N' (not allocated, e.g. debugging sections)
+ *
+ * Archive members are named 'archive[member]' (the archive name being
+ * the 'nm_file' name), stand-alone objects by their 'nm_file' name;
+ * just like 'nm' with several input files. Both byte orders and ELF32
+ * as well as ELF64 are supported (the host's ones are irrelevant).
+ */
+
+#define AR_HDR_SIZE		60
+
+#define ELF_CLASS64		2
+#define ELF_DATA_MSB	2
+#define ELF_SHT_SYMTAB	2
+#define ELF_SHT_NOBITS	8
+#define ELF_SHT_SHNDX	18		/* SHT_SYMTAB_SHNDX */
+#define ELF_SHF_WRITE	1
+#define ELF_SHF_ALLOC	2
+#define ELF_SHF_EXEC	4
+#define ELF_SHN_UNDEF	0
+#define ELF_SHN_LORES	0xff00
+#define ELF_SHN_ABS		0xfff1
+#define ELF_SHN_COMMON	0xfff2
+#define ELF_SHN_XINDEX	0xffff
+#define ELF_STB_LOCAL	0
+#define ELF_STB_WEAK	2
+#define ELF_STB_GNU_UNIQUE	10
+#define ELF_STT_OBJECT	1
+#define ELF_STT_SECTION	3
+#define ELF_STT_FILE	4
+#define ELF_STT_COMMON	5
+#define ELF_STT_TLS		6
+#define ELF_STT_GNU_IFUNC	10
+
+typedef struct ElfImgRec_ {
+	unsigned char	*img;
+	size_t			len;
+	int				is64;
+	int				msb;
+	int				bad;		/* an access was out of bounds */
+} ElfImgRec, *ElfImg;
+
+/* read an 'n'-byte field at 'off' (sets 'bad' and returns 0 if out of bounds) */
+static unsigned long long
+elfGet(ElfImg e, unsigned long long off, int n)
+{
+unsigned long long	v = 0;
+int					i;
+
+	if ( off > e->len || n > e->len - off ) {
+		e->bad = 1;
+		return 0;
+	}
+	for ( i = 0; i < n; i++ )
+		v |= (unsigned long long)e->img[off + i] << (8 * (e->msb ? n - 1 - i : i));
+	return v;
+}
+
+/* address-sized field */
+#define ELF_ADDR(e, off32, off64)	elfGet((e), (e)->is64 ? (off64) : (off32), (e)->is64 ? 8 : 4)
+
+typedef struct ElfShdrRec_ {
+	unsigned long long	name, type, flags, offset, size, link, entsize;
+} ElfShdrRec, *ElfShdr;
+
+static void
+elfShdr(ElfImg e, unsigned long long shoff, int shentsize, unsigned long i, ElfShdr sh)
+{
+unsigned long long	b = shoff + i * shentsize;
+
+	sh->name    = elfGet(e, b + 0, 4);
+	sh->type    = elfGet(e, b + 4, 4);
+	sh->flags   = ELF_ADDR(e, b +  8, b +  8);
+	sh->offset  = ELF_ADDR(e, b + 16, b + 24);
+	sh->size    = ELF_ADDR(e, b + 20, b + 32);
+	sh->link    = elfGet(e, e->is64 ? b + 40 : b + 24, 4);
+	sh->entsize = ELF_ADDR(e, b + 36, b + 56);
+}
+
+/* 'nm' type letter of a global symbol defined in section 'sh' */
+static char
+elfSecType(ElfImg e, ElfShdr sh, ElfShdr shstr)
+{
+const char	*nm    = "";
+int			small;
+
+	if ( sh->name < shstr->size && memchr(e->img + shstr->offset + sh->name, 0, shstr->size - sh->name) )
+		nm = (const char*)e->img + shstr->offset + sh->name;
+	small = !strncmp(nm, ".sdata", 6) || !strncmp(nm, ".sbss", 5);
+
+	if ( sh->flags & ELF_SHF_EXEC )
+		return 'T';
+	if ( !(sh->flags & ELF_SHF_ALLOC) )
+		return 'N';
+	if ( ELF_SHT_NOBITS == sh->type )
+		return small ? 'S' : 'B';
+	if ( !(sh->flags & ELF_SHF_WRITE) )
+		return 'R';
+	return small ? 'G' : 'D';
+}
+
+/* order symbols by name, like 'nm' does (ties: by position in the string table) */
+static int
+scanEvtCmp(const void *a, const void *b)
+{
+const ScanEvtRec	*ea = a, *eb = b;
+int					rval;
+
+	if ( (rval = strcmp(ea->str, eb->str)) )
+		return rval;
+	return ea->str < eb->str ? -1 : ea->str > eb->str;
+}
+
+/*
+ * Record the global symbols of the ELF object at img[0..len) as
+ * a SCAN_OBJ event for 'objn' (which is consumed) followed by
+ * SCAN_SYM events (sorted by name so that the result is the same
+ * as with 'nm' output).
+ *
+ * RETURNS: 0 on success, -1 if the object is malformed.
+ */
+static int
+scanElf(ScanJob job, char *objn, unsigned char *img, size_t len)
+{
+ElfImgRec			e;
+ElfShdrRec			sym, str, shstr, sh, shndx;
+unsigned long long	shoff, i, nsyms, b, nm, shn;
+unsigned long		shnum, shstrndx, j;
+int					shentsize, symsz, bind, type, first, flush;
+char				otype;
+ScanEvt				ev;
+
+	ev        = scanEvt(job, SCAN_OBJ);
+	ev->str   = objn;
+	ev->owned = 1;
+	job->lines++;
+
+	/* the symbols are sorted once all are recorded; don't apply any before */
+	flush      = job->flush;
+	job->flush = 0;
+	first      = job->nevts;
+
+	e.img  = img;
+	e.len  = len;
+	e.is64 = len > 5 && ELF_CLASS64  == img[4];
+	e.msb  = len > 5 && ELF_DATA_MSB == img[5];
+	e.bad  = 0;
+
+	shoff     = ELF_ADDR(&e, 32, 40);
+	shentsize = elfGet(&e, e.is64 ? 58 : 46, 2);
+	shnum     = elfGet(&e, e.is64 ? 60 : 48, 2);
+	shstrndx  = elfGet(&e, e.is64 ? 62 : 50, 2);
+
+	if ( e.bad || shentsize < (e.is64 ? 64 : 40) )
+		goto bad;
+
+	if ( shoff && 0 == shnum ) {
+		/* more than SHN_LORESERVE sections; the count is in section 0 */
+		elfShdr(&e, shoff, shentsize, 0, &sh);
+		shnum = sh.size;
+	}
+
+	memset(&sym,   0, sizeof(sym));
+	memset(&shndx, 0, sizeof(shndx));
+	memset(&shstr, 0, sizeof(shstr));
+	for ( j = 0; j < shnum; j++ ) {
+		elfShdr(&e, shoff, shentsize, j, &sh);
+		if ( ELF_SHT_SYMTAB == sh.type && !sym.type )
+			sym = sh;
+		else if ( ELF_SHT_SHNDX == sh.type )
+			shndx = sh;
+	}
+	if ( ELF_SHN_XINDEX == shstrndx && shnum ) {
+		elfShdr(&e, shoff, shentsize, 0, &sh);
+		shstrndx = sh.link;
+	}
+	if ( shstrndx < shnum )
+		elfShdr(&e, shoff, shentsize, shstrndx, &shstr);
+
+	if ( e.bad )
+		goto bad;
+
+	/* no symbols */
+	if ( !sym.type ) {
+		job->flush = flush;
+		return 0;
+	}
+
+	symsz = e.is64 ? 24 : 16;
+	if ( sym.link >= shnum || sym.entsize < symsz || sym.offset > len || sym.size > len - sym.offset )
+		goto bad;
+
+	elfShdr(&e, shoff, shentsize, sym.link, &str);
+	if ( e.bad || str.offset > len || str.size > len - str.offset )
+		goto bad;
+	if ( shstr.offset > len || shstr.size > len - shstr.offset )
+		memset(&shstr, 0, sizeof(shstr));
+
+	nsyms = sym.size / sym.entsize;
+
+	/* entry 0 is reserved */
+	for ( i = 1; i < nsyms; i++ ) {
+		b = sym.offset + i * sym.entsize;
+		if ( e.is64 ) {
+			nm   = elfGet(&e, b + 0, 4);
+			bind = img[b + 4] >> 4;
+			type = img[b + 4] & 0xf;
+			shn  = elfGet(&e, b + 6, 2);
+		} else {
+			nm   = elfGet(&e, b + 0, 4);
+			bind = img[b + 12] >> 4;
+			type = img[b + 12] & 0xf;
+			shn  = elfGet(&e, b + 14, 2);
+		}
+
+		/* like 'nm -g': external symbols only */
+		if ( ELF_STB_LOCAL == bind || ELF_STT_SECTION == type || ELF_STT_FILE == type )
+			continue;
+
+		if ( nm >= str.size || !img[str.offset + nm] || !memchr(img + str.offset + nm, 0, str.size - nm) )
+			continue;
+
+		if ( ELF_SHN_XINDEX == shn && shndx.type )
+			shn = elfGet(&e, shndx.offset + 4 * i, 4);
+
+		if ( ELF_SHN_UNDEF == shn )
+			otype = ELF_STB_WEAK == bind ? 'w' : 'U';
+		else if ( ELF_SHN_COMMON == shn || ELF_STT_COMMON == type )
+			otype = 'C';
+		else if ( ELF_STT_GNU_IFUNC == type )
+			otype = 'i';
+		else if ( ELF_STB_WEAK == bind )
+			otype = ELF_STT_OBJECT == type || ELF_STT_TLS == type ? 'V' : 'W';
+		else if ( ELF_STB_GNU_UNIQUE == bind )
+			otype = 'u';
+		else if ( ELF_SHN_ABS == shn )
+			otype = 'A';
+		else if ( shn >= shnum || (shn >= ELF_SHN_LORES && !shndx.type) )
+			otype = '?';
+		else {
+			elfShdr(&e, shoff, shentsize, shn, &sh);
+			otype = elfSecType(&e, &sh, &shstr);
+		}
+
+		/* all letters above are known */
+		otype = scanSymType(otype);
+
+		if ( 'N' == otype && !force )
+			continue;
+
+		ev        = scanEvt(job, SCAN_SYM);
+		ev->str   = (char*)img + str.offset + nm;
+		ev->len   = strlen(ev->str);
+		ev->hash  = symHash(ev->str, ev->len);
+		ev->otype = otype;
+		ev->size  = ISUNDEF(otype) ? -1 : (int)ELF_ADDR(&e, b + 8, b + 16);
+		job->lines++;
+
+		if ( e.bad )
+			goto bad;
+	}
+	qsort(job->evts + first, job->nevts - first, sizeof(*job->evts), scanEvtCmp);
+	job->flush = flush;
+	return 0;
+
+bad:
+	job->flush = flush;
+	scanMsg(job, "Malformed ELF object '%s'\n", objn);
+	return -1;
+}
+
+/* build 'archive[member]' (malloc()ed) */
+static char *
+arObjName(const char *ar, const char *mem, size_t len)
+{
+char *rval;
+	assert( rval = malloc(strlen(ar) + len + 3) );
+	sprintf(rval, "%s[%.*s]", ar, (int)len, mem);
+	return rval;
+}
+
+/*
+ * Scan an 'ar' archive (SysV/GNU or BSD flavor) of ELF objects.
+ *
+ * RETURNS: 0 on success, -1 on error.
+ */
+static int
+scanArchive(ScanJob job, unsigned char *buf, size_t len)
+{
+size_t			off = 8, sz, nlen, hlen;
+char			*names  = 0, *nm, *p;
+size_t			nameslen = 0;
+unsigned long	lof;
+
+	if ( 0 == memcmp(buf, AR_THIN_MAGIC, 8) ) {
+		scanMsg(job, "Thin archive %s not supported (use 'nm -g -fposix')\n", job->name);
+		return -1;
+	}
+
+	while ( off + AR_HDR_SIZE <= len ) {
+		unsigned char *h = buf + off;
+
+		if ( '`' != h[58] || '\n' != h[59] ) {
+			scanMsg(job, "Malformed archive %s (member header at offset %lu)\n", job->name, (unsigned long)off);
+			return -1;
+		}
+
+		sz = strtoul((char*)h + 48, 0, 10);
+		off += AR_HDR_SIZE;
+		if ( sz > len - off ) {
+			scanMsg(job, "Truncated archive %s\n", job->name);
+			return -1;
+		}
+
+		nm   = (char*)h;
+		hlen = 0;
+		if ( '/' == nm[0] && '/' == nm[1] && ' ' == nm[2] ) {
+			/* GNU long name table */
+			names    = (char*)buf + off;
+			nameslen = sz;
+			nlen     = 0;
+		} else if ( '/' == nm[0] && (' ' == nm[1] || !strncmp(nm, "/SYM64/", 7)) ) {
+			/* symbol index */
+			nlen     = 0;
+		} else if ( '/' == nm[0] && isdigit(*(unsigned char*)(nm + 1)) ) {
+			lof = strtoul(nm + 1, 0, 10);
+			if ( !names || lof >= nameslen ) {
+				scanMsg(job, "Malformed archive %s (long member name)\n", job->name);
+				return -1;
+			}
+			nm = names + lof;
+			for ( nlen = 0; lof + nlen < nameslen && '\n' != nm[nlen]; nlen++ )
+				;
+			if ( nlen && '/' == nm[nlen - 1] )
+				nlen--;
+		} else if ( !strncmp(nm, "#1/", 3) ) {
+			/* BSD: name follows the header */
+			hlen = strtoul(nm + 3, 0, 10);
+			if ( hlen > sz ) {
+				scanMsg(job, "Malformed archive %s (BSD member name)\n", job->name);
+				return -1;
+			}
+			nm = (char*)buf + off;
+			for ( nlen = 0; nlen < hlen && nm[nlen]; nlen++ )
+				;
+		} else {
+			for ( nlen = 16; nlen > 0 && ' ' == nm[nlen - 1]; nlen-- )
+				;
+			if ( (p = memchr(nm, '/', nlen)) )
+				nlen = p - nm;
+		}
+
+		if ( nlen && (nlen < 9 || memcmp(nm, "__.SYMDEF", 9)) ) {
+			if ( sz - hlen >= 4 && 0 == memcmp(buf + off + hlen, ELF_MAGIC, 4) ) {
+				if ( scanElf(job, arObjName(job->name, nm, nlen), buf + off + hlen, sz - hlen) )
+					return -1;
+			} else {
+				scanMsg(job, "Warning: %s[%.*s] is not an ELF object; skipped\n", job->name, (int)nlen, nm);
+			}
+		}
+
+		/* members are 2-byte aligned */
+		off += sz + (sz & 1);
+	}
+	return 0;
+}
+
+/* Scan an object or archive (see binaryInput()) */
+static int
+scanBinary(ScanJob job, char *buf, size_t len)
+{
+char *objn;
+
+	if ( len >= 4 && 0 == memcmp(buf, ELF_MAGIC, 4) ) {
+		assert( objn = malloc(strlen(job->name) + 1) );
+		strcpy(objn, job->name);
+		return scanElf(job, objn, (unsigned char*)buf, len);
+	}
+	return scanArchive(job, (unsigned char*)buf, len);
+}
+
+/* Parse a file generated with 'nm -g -fposix' (see above) */
+static int
+scanParse(ScanJob job)
+{
+char	*name = job->name;
+char	*buf, *end, *eol;
+char	*rest;
+size_t	buflen;
+int		got;
+char	type, otype;
+int		line=0;
+int		haveObj = 0;
+int		len;
+int		size;
+int		val;
+ScanEvt	ev;
+
+	if ( ! (buf = job->buf = mapFile(job->file, &buflen, &job->mapped)) ) {
+		scanMsg(job, "Unable to read %s: %s\n", name, strerror(errno));
+		return -1;
+	}
+
+	job->buflen = buflen;
+
+	if ( binaryInput(buf, buflen) )
+		return scanBinary(job, buf, buflen);
+
+	for ( end = buf + buflen; buf < end; buf = eol + 1 ) {
+
+		/* mapFile() guarantees that the last line is terminated */
+		eol = memchr(buf, '\n', end - buf);
+
+		/* scan the initial string and chop everything beyond the first whitespace off */
+		for (rest = buf; rest < eol && ' '!= *rest && '\t'!=*rest && *rest; rest++)
+			/* nothing else to do */;
+
+		got = (rest == buf) ? 0 : 1;
+
+		if ( got && rest < eol ) {
+			/* "%c" consumes the character right after the separator; this
+			 * may well be the '\n' (-> unknown symbol type)
+			 */
+			*rest++ = 0;
+			got++;
+			otype = *rest++;
+			if ( scanHex(&rest, eol, &val) ) {
+				got++;
+				if ( scanHex(&rest, eol, &size) )
+					got++;
+			}
+		} else {
+			*rest = 0;
 		}
+
+		job->lines = ++line;
+
 		switch (got) {
 			default:
-				fprintf(stderr,"Unable to read %s/line %i (%i conversions of '%s')\n",name,line,got,STRFMT""THEFMT);
+				scanMsg(job, "Unable to read %s/line %i (%i conversions of '%s')\n",name,line,got,STRFMT""THEFMT);
 				return -1;
 
 			case 1:
 				len = strlen(buf);
 				if ( ':' != buf[len-1] ) {
-					fprintf(stderr,"<FILENAME> in %s/line %i not ':' terminated - did you use 'nm -fposix?'\n", name, line);
+					scanMsg(job, "<FILENAME> in %s/line %i not ':' terminated - did you use 'nm -fposix?'\n", name, line);
 					return -1;
 				}
 
 				/* strip trailing ':' */
 				buf[--len]=0;
 
-				obj = createObj(buf);
-
-#if DEBUG & DEBUG_SCAN
-				fprintf(debugf,"In FILE: '%s'\n", buf);
-#endif
+				scanEvt(job, SCAN_OBJ)->str = buf;
+				haveObj = 1;
 			break;
 
 			case 2:
@@ -779,17 +2062,22 @@ Xref    ref;
 					default: break;
 				}
 
-				type = TOUPPER(otype);
+				if ( ! (type = scanSymType(otype)) ) {
+					scanMsg(job, "Unknown symbol type '%c' (line %i)\n",TOUPPER(otype),line);
+					return -1;
+				}
+				otype = type;
+				type  = TOUPPER(otype);
 
 				if ( 'N' == type && !force ) {
-					fprintf(stderr,"Warning: Ignoring debugging symbol ('N'): %s\n", buf);
+					scanMsg(job, "Warning: Ignoring debugging symbol ('N'): %s\n", buf);
 					break;
 				}
 
 
-				if (!obj) {
+				if (!haveObj) {
 					char *dot, *slash,*nmbuf;
-					fprintf(stderr,"Warning: Symbol without object file??\n");
+					scanMsg(job, "Warning: Symbol without object file??\n");
 
 					assert( nmbuf = malloc(strlen(name)+5) );
 
@@ -802,49 +2090,65 @@ Xref    ref;
 						strcpy(dot+1,"o");
 					}
 					slash = slash ? slash + 1 : nmbuf;
-					obj = createObj( slash );
 
-				    fprintf(stderr,"-> substituting symbol file name, using '%s'... (%s/line %i)\n",slash,name,line);
+					ev = scanEvt(job, SCAN_OBJ);
+					assert( ev->str = malloc(strlen(slash) + 1) );
+					strcpy( ev->str, slash );
+					ev->owned = 1;
+					haveObj   = 1;
+
+				    scanMsg(job, "-> substituting symbol file name, using '%s'... (%s/line %i)\n",slash,name,line);
 					free(nmbuf);
 				}
 
-				if ( !nsym )
-					assert( nsym = calloc(1,sizeof(*nsym)) );
-
-				nsym->name = buf;
-
 				if ( -1==size && ! ISUNDEF(type) ) {
-					fprintf(stderr,"Warning: '%s' (type '%c') has unknown size; setting to zero\n",
-							nsym->name, type);
+					scanMsg(job, "Warning: '%s' (type '%c') has unknown size; setting to zero\n",
+							buf, type);
 					size = 0;
 				}
 
-				assert( found = (Sym*) tsearch(nsym, &symTbl, symcmp) );
-				if ( *found == nsym ) {
-#if DEBUG & DEBUG_TREE
-					fprintf(debugf,"Adding new symbol %s (found %p, sym %p)\n",(*found)->name, found, *found);
-#endif
-					nsym->name = stralloc(strlen(buf) + 1);
-					strcpy(nsym->name, buf);
-					nsym = 0;
-				} else {
-#if DEBUG & DEBUG_TREE
-					fprintf(debugf,"Found existing symbol %s (found %p, sym %p)\n",(*found)->name, found, *found);
+				ev        = scanEvt(job, SCAN_SYM);
+				ev->str   = buf;
+				ev->len   = strlen(buf);
+				ev->hash  = symHash(buf, ev->len);
+				ev->otype = otype;
+				ev->size  = size;
+			break;
+		}
+	}
+	return 0;
+}
+
+/* Replay (and discard) the events recorded by scanParse() */
+static void
+scanApply(ScanJob job)
+{
+ScanEvt	ev;
+Sym		sym;
+int		i;
+
+	for ( i=0, ev=job->evts; i<job->nevts; i++, ev++ ) {
+		switch ( ev->kind ) {
+			case SCAN_MSG:
+				logNote(stderr, "%s", ev->str);
+			break;
 
+			case SCAN_OBJ:
+				job->obj = createObj(ev->str);
+#if DEBUG & DEBUG_SCAN
+				fprintf(debugf,"In FILE: '%s'\n", ev->str);
 #endif
-				}
-				sym = *found;
+			break;
 
-				weak = 0;
+			case SCAN_SYM:
+				sym = scanSymResolve(ev);
 
-				switch ( type ) {
-bail:
-					default:
-						fprintf(stderr,"Unknown symbol type '%c' (line %i)\n",type,line);
-					return -1;
+				switch ( TOUPPER(ev->otype) ) {
+					default: /* scanParse() has reported the error */
+					break;
 
 					case 'W':
-					case 'V': weak = 1;
+					case 'V':
 					case 'D':
 					case 'T':
 					case 'B':
@@ -853,9 +2157,9 @@ bail:
 					case 'S':
 					case 'A':
 					case 'C':
-					case 'N': /* only get here for 'N' if !force */
+					case 'N': /* only get here for 'N' if force */
 
-							  add_export(obj, sym, otype, size);
+							  add_export(job->obj, sym, ev->otype, ev->size);
 
 					break;
 
@@ -864,1385 +2168,6037 @@ bail:
 								continue
 							    ;
 							  /* else:  less paranoia */
-							  add_import(obj, sym, otype);
+							  add_import(job->obj, sym, ev->otype);
 					break;
 
 					case 'w':
-							  add_export(obj, sym, otype, size);
-							  weak = 1;
+							  add_export(job->obj, sym, ev->otype, ev->size);
 
 							  /* FALL THRU */
 
 					case 'U':
-							  add_import(obj, sym, otype);
+							  add_import(job->obj, sym, ev->otype);
 					break;
 				}
 #if DEBUG & DEBUG_SCAN
-				fprintf(debugf,"\t '%c' %s\n",type,buf);
+				fprintf(debugf,"\t '%c' %s\n",TOUPPER(ev->otype),sym->name);
 #endif
 			break;
 		}
+		if ( ev->owned )
+			free(ev->str);
 	}
-	free(nsym);
-	return 0;
+	job->nevts = 0;
 }
 
 static void
-gatherDanglingUndefsAct(const void *pnode, const VISIT when, const int depth)
+scanJobRelease(ScanJob job)
 {
-const Sym sym = *(const Sym*)pnode;
-	if ( (postorder == when || leaf == when) && ! sym->exportedBy) {
-		Xref ex;
-		undefSymPod.nexports++;
-		undefSymPod.exports = realloc(undefSymPod.exports, sizeof(*undefSymPod.exports) * undefSymPod.nexports);
-		/* check alignment with flags */
-		assert( 0 == ((unsigned long)undefSymPod.exports & XREF_FLAGS) );
-		ex = &undefSymPod.exports[undefSymPod.nexports-1];
-		ex->sym   = sym;
-		ex->obj   = &undefSymPod;
-		ex->xtype = UNDEFTYPE;
-		xref_set_next(ex,0);
+	stats.lines += job->lines;
+	free(job->evts);
+	job->evts  = 0;
+	job->aevts = 0;
+	if ( lowMem && job->buf ) {
+		/* nothing points into it but the events just applied */
+		if ( job->mapped )
+			munmap(job->buf, job->buflen);
+		else
+			free(job->buf);
+		stats.released += job->buflen;
+		job->buf = 0;
 	}
 }
 
-/*
- * Gather symbols which are defined nowhere and attach them
- * to the export list of the 'special' object at the list head.
- */
-void
-gatherDanglingUndefs()
+/* Scan a file generated with 'nm -g -fposix' */
+int
+scan_file(FILE *f, char *name)
 {
-	twalk(symTbl, gatherDanglingUndefsAct);
-	fixupObj(&undefSymPod);
-}
+ScanJobRec	job;
+int			rval;
 
-/*
- * Link an object and recursively resolve all of its
- * dependencies. Objects which are not already members
- * of a link set become members of 'f's link set.
- *
- * Semantics: caller must have asserted that
- * 'f' is not part of any linkset already
- * (f->link.anchor == 0).
- * Then, the caller sets f->link.anchor and
- * calls 'link' to perform a recursive link.
- */
+	memset(&job, 0, sizeof(job));
+	job.name  = name;
+	job.file  = f;
+	job.flush = 1;
 
-int
-linkObj(ObjF f, char *symname, int l)
-{
-register int i;
-register Xref imp;
+	rval = scanParse(&job);
+	scanApply(&job);
+	scanJobRelease(&job);
+	return rval;
+}
 
-	assert(f->link.anchor);
+#ifdef HAVE_PTHREAD_H
+typedef struct ScanPoolRec_ {
+	ScanJob			jobs;
+	int				njobs;
+	int				next;		/* next job to parse */
+	pthread_mutex_t	mtx;
+	pthread_cond_t	cond;		/* signals a job being done */
+} ScanPoolRec, *ScanPool;
+
+static void *
+scanWorker(void *arg)
+{
+ScanPool	p = arg;
+ScanJob		job;
 
+	for (;;) {
+		pthread_mutex_lock(&p->mtx);
+		job = p->next < p->njobs ? &p->jobs[p->next++] : 0;
+		pthread_mutex_unlock(&p->mtx);
 
-	if (verbose & DEBUG_LINK) {
-		for ( i=0; i<l; i++ )
-			fputc(' ', logf);
-		fprintf(logf,"Linking '"); printObjName(debugf,f); fputc('\'', debugf);
-		if (symname)
-			fprintf(logf,"because of '%s'",symname);
-		fprintf(logf," to %s link set\n", f->link.anchor->name);
-	}
+		if ( !job )
+			break;
 
-	for (i=0, imp=f->imports; i<f->nimports; i++, imp++) {
-		register Sym *found;
-		assert( 0 == XREF_NEXT(imp) );
-		assert (found = (Sym*)tfind( imp->sym, &symTbl, symcmp ));
+		if ( (job->file = ffind(job->name)) ) {
+			job->status = scanParse(job);
+			fclose(job->file);
+		} else {
+			job->err    = errno;
+		}
 
-		/* add ourself to the importers of that symbol */
-		xref_set_next(imp, (*found)->importedFrom);
-		(*found)->importedFrom = imp;
+		pthread_mutex_lock(&p->mtx);
+		job->done = 1;
+		pthread_cond_broadcast(&p->cond);
+		pthread_mutex_unlock(&p->mtx);
+	}
+	return 0;
+}
 
-		if ( !(*found)->exportedBy ) {
-			if (warn & WARN_UNDEFINED_SYMS) {
-				fprintf(stderr,
-					"Warning: symbol %s:%s undefined\n",
-					f->name, imp->sym->name);
-			}
-		} else {
-			ObjF	dep= strongestExport(*found)->obj;
-			if ( f->link.anchor && !dep->link.anchor ) {
-				dep->link.anchor = f->link.anchor;
-				linkObj(dep,(*found)->name, l+1);
-			}
+/*
+ * Scan 'n' nm files using up to 'nThreads' threads. The files
+ * are parsed concurrently and merged in order; the last object of
+ * the first file is stored in *plastAppObj (unless already set).
+ * Errors are fatal (as for serial scanning).
+ */
+static void
+scanFilesMT(char **names, int n, ObjF *plastAppObj)
+{
+ScanPoolRec	pool;
+pthread_t	*tids;
+int			i, nt;
+
+	assert( pool.jobs = calloc(n, sizeof(*pool.jobs)) );
+	pool.njobs = n;
+	pool.next  = 0;
+	pthread_mutex_init(&pool.mtx, 0);
+	pthread_cond_init(&pool.cond, 0);
+
+	for ( i=0; i<n; i++ )
+		pool.jobs[i].name = names[i];
+
+	nt = nThreads < n ? nThreads : n;
+	assert( tids = malloc(nt * sizeof(*tids)) );
+	for ( i=0; i<nt; i++ )
+		assert( 0 == pthread_create(&tids[i], 0, scanWorker, &pool) );
+
+	for ( i=0; i<n; i++ ) {
+		ScanJob job = &pool.jobs[i];
+
+		pthread_mutex_lock(&pool.mtx);
+		while ( !job->done )
+			pthread_cond_wait(&pool.cond, &pool.mtx);
+		pthread_mutex_unlock(&pool.mtx);
+
+		if ( !job->file ) {
+			fprintf(stderr,"Opening nm_file '%s': %s\n", job->name, strerror(job->err));
+			exit(1);
 		}
+		scanApply(job);
+		scanJobRelease(job);
+		if ( job->status ) {
+			fprintf(stderr,"Error scanning %s\n",job->name);
+			exit(1);
+		}
+		/* see main() */
+		if ( !*plastAppObj )
+			*plastAppObj = fileListTail;
 	}
 
-	f->link.next = (f->link.anchor->set);
-	f->link.anchor->set = f;
+	for ( i=0; i<nt; i++ )
+		pthread_join(tids[i], 0);
+	free(tids);
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.mtx);
+	free(pool.jobs);
+}
+#endif
 
-	return 0;
+static void
+gatherDanglingUndefsAct(Sym sym, void *closure)
+{
+	if ( ! sym->exportedBy) {
+		Xref ex;
+		ex = &undefSymPod.exports[undefSymPod.nexports++];
+		ex->sym   = sym;
+		ex->obj   = &undefSymPod;
+		ex->xtype = UNDEFTYPE;
+		ex->size  = 0;
+		xref_set_next(ex,0);
+	}
 }
 
-/* Dump info about a symbol to 'feil' */
+/*
+ * Gather symbols which are defined nowhere and attach them
+ * to the export list of the 'special' object at the list head.
+ */
 void
-trackSym(FILE *feil, Sym s)
+gatherDanglingUndefs()
 {
-Xref 			ex;
-Xref			imp;
-DepPrintArgRec	arg;
-
-	arg.depthIndent = -2;
-	arg.file		= feil;
+unsigned i, n;
 
-	fprintf(feil,"What I know about Symbol '%s':\n", s->name);
-	fprintf(feil,"  Defined in object: ");
-	if ( ! (ex = s->exportedBy) ) {
-		fprintf(feil," NOWHERE!!!\n");
-	} else {
-		printObjName(feil, ex->obj);
-		fprintf(feil,"%s\n", XREF_WEAK(ex) ? " (WEAK)" : "");
-		while ( ex=XREF_NEXT(ex) ) {
-			fprintf(feil,"      AND in object: ");
-			printObjName(feil, ex->obj);
-			fprintf(feil,"%s\n", XREF_WEAK(ex) ? " (WEAK)" : "");
-		}
+	/* count first so that the export array can be sized exactly */
+	for ( i=n=0; i<symTbl.size; i++ ) {
+		if ( symTbl.slots[i].sym && ! symTbl.slots[i].sym->exportedBy )
+			n++;
 	}
+	if ( !n )
+		return;
 
-	if ( (ex=s->exportedBy) ) {
-		fprintf(feil,"  Depending on objects (triggers linkage of):");
-		if (0 == ex->obj->nimports) {
-			fprintf(feil," NONE\n");
-		} else {
-			fprintf(feil,"\n");
-			arg.minDepth    = 1;
-			arg.indent      = 0;
-			depwalk(ex->obj, depPrint, (void*)&arg, WALK_IMPORTS | WALK_BUILD_LIST);
-			depwalkListRelease(ex->obj);
+	assert( undefSymPod.exports = malloc(n * sizeof(*undefSymPod.exports)) );
+	/* check alignment with flags */
+	assert( 0 == ((unsigned long)undefSymPod.exports & XREF_FLAGS) );
+
+	symTblWalk(&symTbl, gatherDanglingUndefsAct, 0);
+	fixupObj(&undefSymPod);
+}
+
+/*
+ * Database cache ('-c').
+ *
+ * The database as it is after scanning and fixing up all objects
+ * (and gathering the dangling undefineds) is written to a binary file.
+ * The file is relocatable: all references are indices (symbols are
+ * identified by their slot in the symbol table, cross-references by
+ * their position in a slab laid out like placeXrefs() does) and the
+ * strings are used in place from the memory-mapped file.
+ *
+ * The cache is keyed on the list of 'nm_files' (name, device, inode,
+ * size and mtime) and on the '-f' flag; if anything differs, the files
+ * are scanned and the cache is rewritten. Diagnostics issued while
+ * building the database are stored and replayed.
+ *
+ * In incremental mode ('-I') the cache holds the (not yet fixed up)
+ * database of all but the first 'nm_file'; the application's nm_file
+ * is always scanned and the cached libraries are merged behind it,
+ * then everything is fixed up as usual. The result is the same as if
+ * all files had been scanned. (The removals are relinked incrementally
+ * as well, see relinkUndefs().)
+ *
+ * A cache is only used if its checksum (over everything following the
+ * header) matches and every index and string offset it contains is in
+ * range; anything else is treated like a stale cache.
+ */
+#define DBC_MAGIC	0x6c646570	/* 'ldep' */
+#define DBC_VERSION	3
+#define DBC_NONE	0xffffffff
+
+/* cache modes */
+#define DBC_FULL	0	/* the database of all 'nm_files' */
+#define DBC_LIBS	1	/* all but the first 'nm_file' ('-I') */
+
+/* dbcSum() of the library cache in use (if 'dbcLibValid'); identifies its database */
+static uint32_t	dbcLibSum;
+static int		dbcLibValid = 0;
+
+typedef struct DbcHdrRec_ {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	force;
+	uint32_t	mode;
+	uint32_t	ninputs;
+	uint32_t	nobjs;		/* including the undefSymPod */
+	uint32_t	nlibs;
+	uint32_t	nlibfiles;
+	uint32_t	symTblSize;
+	uint32_t	nsyms;
+	uint32_t	nxrefs;
+	uint32_t	lastApp;	/* seq of the last object of the first file (lastAppObj) */
+	uint32_t	notesSize;
+	uint32_t	strSize;
+	uint32_t	sum;		/* dbcSum() of the payload */
+	uint32_t	pad;
+} DbcHdrRec, *DbcHdr;
+
+typedef struct DbcInputRec_ {
+	uint32_t	name;		/* all names are offsets into the string table */
+	uint32_t	pad;
+	uint64_t	dev;
+	uint64_t	ino;
+	uint64_t	size;
+	int64_t		mtime;
+	int64_t		mtimeNs;
+} DbcInputRec, *DbcInput;
+
+typedef struct DbcLibRec_ {
+	uint32_t	name;
+	uint32_t	nfiles;		/* members (seq) follow in the 'libfiles' array */
+} DbcLibRec, *DbcLib;
+
+/* objects are stored in file list order; their cross-references
+ * (exports followed by imports) are consecutive in the same order
+ */
+typedef struct DbcObjRec_ {
+	uint32_t	name;
+	uint32_t	lib;
+	uint32_t	nexports;
+	uint32_t	nimports;
+} DbcObjRec, *DbcObj;
+
+typedef struct DbcSymRec_ {
+	uint32_t	name;
+	uint32_t	len;
+	uint32_t	hash;
+	uint32_t	slot;
+	int32_t		flags;
+	int32_t		refcnt;
+	uint32_t	exportedBy;
+	uint32_t	exportedLast;
+	uint32_t	exportedMax;
+	uint32_t	strongest;
+} DbcSymRec, *DbcSym;
+
+typedef struct DbcXrefRec_ {
+	uint32_t	sym;
+	uint32_t	next;
+	int32_t		size;
+	char		xtype;
+	char		pad[3];
+} DbcXrefRec, *DbcXref;
+
+/* key of an input file; RETURNS 0 on success */
+static int
+dbcInputKey(char *name, DbcInput in)
+{
+FILE		*f;
+struct stat	st;
+int			rval = -1;
+
+	memset(in, 0, sizeof(*in));
+	if ( (f = ffind(name)) ) {
+		if ( 0 == fstat(fileno(f), &st) ) {
+			in->dev     = st.st_dev;
+			in->ino     = st.st_ino;
+			in->size    = st.st_size;
+			in->mtime   = st.st_mtim.tv_sec;
+			in->mtimeNs = st.st_mtim.tv_nsec;
+			rval        = 0;
 		}
+		fclose(f);
 	}
+	return rval;
+}
 
-	fprintf(feil,"  Objects depending (maybe indirectly) on this symbol:\n");
-    fprintf(feil,"  Note: the host object may depend on yet more objects due to other symbols...\n");
-
-	imp = s->importedFrom;
+/* FNV-1a over 'n' bytes at 'p', continuing from 'h' (start with DBC_SUM_INIT) */
+#define DBC_SUM_INIT	2166136261U
 
-	if ( imp ) {
-		fprintf(feil,"\n");
-		arg.minDepth    = 0;
-		arg.indent      = 4;
-		do {
-			depwalk(imp->obj, depPrint, (void*)&arg, WALK_EXPORTS | WALK_BUILD_LIST);
-			depwalkListRelease(imp->obj);
-		} while ( imp = XREF_NEXT(imp) );
-	} else {
-		fprintf(feil," NONE\n");
+static uint32_t
+dbcSum(uint32_t h, const void *p, size_t n)
+{
+const unsigned char *b = p;
+	while ( n-- > 0 ) {
+		h ^= *b++;
+		h *= 16777619U;
 	}
+	return h;
 }
 
-/* Dump info about an object to 'feil' */
-int
-trackObj(FILE *feil, ObjF f)
+/* write 'n' elements of the payload (summing them up in 'hdr.sum') or bail */
+#define DBC_WRITE(p, n, feil) \
+	do { \
+		if ( (n) && (n) != fwrite((p), sizeof(*(p)), (n), (feil)) ) goto bail; \
+		hdr.sum = dbcSum(hdr.sum, (p), (n) * sizeof(*(p))); \
+	} while (0)
+
+/* append a string to the string table; RETURNS its offset */
+static uint32_t
+dbcString(char **ptab, int *pavail, uint32_t *psize, const char *str)
 {
-int				i;
-DepPrintArgRec	arg;
+int      len = strlen(str) + 1;
+uint32_t rval = *psize;
 
-	fprintf(feil,"What I know about object '");
-	printObjName(feil,f);
-	fprintf(feil,"':\n");
+	*ptab = stackReserve(*ptab, pavail, *psize + len, 1);
+	memcpy(*ptab + *psize, str, len);
+	*psize += len;
+	return rval;
+}
 
-	fprintf(feil,"  Exported symbols:\n");
+/* index of a cross-reference given the index of its object's first xref */
+static INLINE uint32_t
+dbcXrefIdx(Xref r, uint32_t *xbase)
+{
+ObjF f = r->obj;
+	if ( f->exports && r >= f->exports && r < f->exports + f->nexports )
+		return xbase[f->seq] + (r - f->exports);
+	return xbase[f->seq] + f->nexports + (r - f->imports);
+}
 
-	for ( i=0; i<f->nexports; i++)
-		fprintf(feil,"    %s\n",f->exports[i].sym->name);
+/* index of an object in the cache (the undefSymPod is 0, 'first' is 1) */
+#define DBC_OBJIDX(f, first)	((f) == &undefSymPod ? 0 : (f)->seq - (first)->seq + 1)
 
-	fprintf(feil,"  Imported symbols:\n");
+/*
+ * Write the database to 'dbname'; RETURNS 0 on success.
+ *
+ * DBC_FULL:  the entire (fixed-up) database.
+ * DBC_LIBS:  the objects from 'first' to the end of the file list and
+ *            the symbols tagged SYM_FLG_LIBDB; the database must not be
+ *            fixed up yet (no export lists, no dangling undefineds).
+ */
+static int
+dbcWrite(char *dbname, char **inputs, int ninputs, ObjF lastAppObj, ObjF first, int mode)
+{
+DbcHdrRec	hdr;
+DbcInputRec	in;
+DbcLibRec	dl;
+DbcObjRec	dobj;
+DbcSymRec	dsym;
+DbcXrefRec	dx;
+char		*strs = 0;
+int			savail = 0;
+uint32_t	*xbase, *libOf;
+uint32_t	nx, li;
+char		*tmpn;
+FILE		*feil;
+ObjF		f;
+Lib			l;
+Sym			s;
+Xref		r;
+unsigned	i;
+int			k;
+
+	statBegin(STAT_CACHE_WRITE);
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic      = DBC_MAGIC;
+	hdr.version    = DBC_VERSION;
+	hdr.force      = force;
+	hdr.mode       = mode;
+	hdr.ninputs    = ninputs;
+	hdr.nobjs      = 1 + (first ? numFiles - first->seq : 0);
+	hdr.nlibs      = numLibs;
+	hdr.symTblSize = symTbl.size;
+	hdr.lastApp    = lastAppObj ? DBC_OBJIDX(lastAppObj, first) : DBC_NONE;
+	hdr.notesSize  = notesSize;
+	hdr.sum        = DBC_SUM_INIT;
+
+	if ( DBC_LIBS == mode ) {
+		/* only count the references from the objects we store */
+		for ( f = fileListFirst(); f != first; f = f->next ) {
+			for ( k = 0; k < f->nexports; k++ )
+				f->exports[k].sym->refcnt--;
+			for ( k = 0; k < f->nimports; k++ )
+				f->imports[k].sym->refcnt--;
+		}
+	}
 
-	for ( i=0; i<f->nimports; i++)
-		fprintf(feil,"    %s\n",f->imports[i].sym->name);
+	assert( xbase = malloc(numFiles * sizeof(*xbase)) );
+	assert( libOf = malloc(numFiles * sizeof(*libOf)) );
+	xbase[0] = 0;
+	libOf[0] = DBC_NONE;
+	nx       = undefSymPod.nexports + undefSymPod.nimports;
+	for ( f = first; f; f = f->next ) {
+		xbase[f->seq] = nx;
+		libOf[f->seq] = DBC_NONE;
+		nx           += f->nexports + f->nimports;
+	}
+	hdr.nxrefs = nx;
+	for ( li = 0, l = libListHead; l; l = l->next, li++ ) {
+		for ( k = 0; k < l->nfiles; k++ )
+			libOf[l->files[k]->seq] = li;
+		hdr.nlibfiles += l->nfiles;
+	}
+	for ( i = 0; i < symTbl.size; i++ ) {
+		if ( (s = symTbl.slots[i].sym) && (DBC_FULL == mode || (s->flags & SYM_FLG_LIBDB)) )
+			hdr.nsyms++;
+	}
 
-	fprintf(feil,"  Objects depending on me (including indirect dependencies):\n");
+	assert( tmpn = malloc(strlen(dbname) + 20) );
+	sprintf(tmpn, "%s.tmp%u", dbname, (unsigned)getpid());
+	if ( !(feil = fopen(tmpn, "w")) ) {
+		fprintf(stderr,"Unable to create database cache '%s': %s\n", tmpn, strerror(errno));
+		goto cleanup;
+	}
 
-	arg.minDepth    = 0;
-	arg.indent      = 4;
-	arg.depthIndent = -1;
-	arg.file		= feil;
+	/* header is rewritten once the size of the string table and the sum are known */
+	if ( 1 != fwrite(&hdr, sizeof(hdr), 1, feil) )
+		goto bail;
 
-	depwalk(f, depPrint, (void*)&arg, WALK_EXPORTS | WALK_BUILD_LIST);
-	depwalkListRelease(f);
+	for ( k = 0; k < ninputs; k++ ) {
+		if ( dbcInputKey(inputs[k], &in) )
+			goto bail;
+		in.name = dbcString(&strs, &savail, &hdr.strSize, inputs[k]);
+		DBC_WRITE(&in, 1, feil);
+	}
 
-	fprintf(feil,"  Objects I depend on (including indirect dependencies):\n");
+	for ( l = libListHead; l; l = l->next ) {
+		dl.name   = dbcString(&strs, &savail, &hdr.strSize, l->name);
+		dl.nfiles = l->nfiles;
+		DBC_WRITE(&dl, 1, feil);
+	}
+	for ( l = libListHead; l; l = l->next ) {
+		for ( k = 0; k < l->nfiles; k++ ) {
+			li = DBC_OBJIDX(l->files[k], first);
+			DBC_WRITE(&li, 1, feil);
+		}
+	}
 
-	depwalk(f, depPrint, (void*)&arg, WALK_IMPORTS | WALK_BUILD_LIST);
-	depwalkListRelease(f);
-	
-	return 0;
-}
+	for ( f = &undefSymPod; f; f = (f == &undefSymPod ? first : f->next) ) {
+		dobj.name     = dbcString(&strs, &savail, &hdr.strSize, f->name);
+		dobj.lib      = libOf[f->seq];
+		dobj.nexports = f->nexports;
+		dobj.nimports = f->nimports;
+		DBC_WRITE(&dobj, 1, feil);
+	}
 
-static void
-doUnlink(ObjF f, int depth, void *closure)
-{
-Xref	imp,p,n;
-int		i;
-ObjF	*pl;
+	for ( i = 0; i < symTbl.size; i++ ) {
+		if ( !(s = symTbl.slots[i].sym) || (DBC_LIBS == mode && !(s->flags & SYM_FLG_LIBDB)) )
+			continue;
+		dsym.name         = dbcString(&strs, &savail, &hdr.strSize, s->name);
+		dsym.len          = s->len;
+		dsym.hash         = s->hash;
+		dsym.slot         = i;
+		dsym.flags        = s->flags;
+		dsym.refcnt       = s->refcnt;
+		dsym.exportedBy   = s->exportedBy   ? dbcXrefIdx(s->exportedBy,   xbase) : DBC_NONE;
+		dsym.exportedLast = s->exportedLast ? dbcXrefIdx(s->exportedLast, xbase) : DBC_NONE;
+		dsym.exportedMax  = s->exportedMax  ? dbcXrefIdx(s->exportedMax,  xbase) : DBC_NONE;
+		dsym.strongest    = s->strongest    ? dbcXrefIdx(s->strongest,    xbase) : DBC_NONE;
+		DBC_WRITE(&dsym, 1, feil);
+	}
 
-	if ( verbose & DEBUG_UNLINK ) {
-		fprintf(logf,"\n  removing object '");
-		printObjName(logf,f);
-		fprintf(logf,"'... ");
+	memset(&dx, 0, sizeof(dx));
+	for ( f = &undefSymPod; f; f = (f == &undefSymPod ? first : f->next) ) {
+		for ( k = 0; k < f->nexports + f->nimports; k++ ) {
+			r = k < f->nexports ? &f->exports[k] : &f->imports[k - f->nexports];
+			/* slot of the symbol */
+			dx.sym   = symTblProbe(&symTbl, r->sym->name, r->sym->len, r->sym->hash) - symTbl.slots;
+			dx.next  = XREF_NEXT(r) ? dbcXrefIdx(XREF_NEXT(r), xbase) : DBC_NONE;
+			dx.size  = r->size;
+			dx.xtype = r->xtype;
+			DBC_WRITE(&dx, 1, feil);
+		}
 	}
 
-	for (i=0, imp=f->imports; i<f->nimports; i++, imp++) {
-		/* remove ourself from the list of importers of that symbol */
+	DBC_WRITE(notes, notesSize, feil);
+	DBC_WRITE(strs, hdr.strSize, feil);
 
-		/* retrieve our predecessor */
-		p = imp->sym->importedFrom;
-		
-		if ( p == imp ) {
-			imp->sym->importedFrom = XREF_NEXT(imp);
-		} else {
-			while ( p && ((n=XREF_NEXT(p)) != imp) ) {
-				p = n;
-			}
-			assert( p );
-			xref_set_next(p, XREF_NEXT(imp));
-		}
-		
-		xref_set_next(imp, 0);
+	if ( fseek(feil, 0, SEEK_SET) || 1 != fwrite(&hdr, sizeof(hdr), 1, feil) )
+		goto bail;
+
+	if ( fclose(feil) ) {
+		feil = 0;
+		goto bail;
 	}
+	feil = 0;
+	if ( rename(tmpn, dbname) )
+		goto bail;
 
-	/* remove this object from its linkset */
-	for (pl = &f->link.anchor->set; *pl && (*pl != f); pl = &((*pl)->link.next) )
-		/* do nothing else */;
-	assert( *pl );
-	*pl = f->link.next;
-	f->link.next   = 0;
-	f->link.anchor = 0;
+	if ( DBC_LIBS == mode ) {
+		dbcLibSum   = hdr.sum;
+		dbcLibValid = 1;
+	}
 
-	if ( verbose & DEBUG_UNLINK )
-		fprintf(logf,"OK\n");
-}
+	hdr.magic = 0;
 
-static void
-checkSysLinkSet(ObjF f, int depth, void *closure)
-{
-ObjF *reject = closure;
-	if ( f->link.anchor == &appLinkSet ) {
-		if ( ! *reject ) {
-		  	if ( verbose & DEBUG_UNLINK ) {
-				fprintf(logf,"  --> rejected because '");
-				printObjName(logf,f);
-				fprintf(logf,"' is needed by app");
-			}
-		*reject = f;
-		}
+bail:
+	if ( hdr.magic ) {
+		fprintf(stderr,"Writing database cache '%s' failed: %s\n", dbname, strerror(errno));
+		if ( feil )
+			fclose(feil);
+		unlink(tmpn);
 	}
-}
 
-static void
-checkSanity(ObjF f, int depth, void *closure)
-{
-Xref	ex;
-int		i;
-	/* sanity check. All exported symbols' import lists must be empty
-	 * -- unless the strongest export is by another object
-	 */
-	for (i=0, ex=f->exports; i<f->nexports; i++,ex++) {
-		if ( strongestExport( ex->sym )->obj != f )
-			continue;
-		assert( ex->sym->importedFrom == 0 );
+cleanup:
+	if ( DBC_LIBS == mode ) {
+		for ( f = fileListFirst(); f != first; f = f->next ) {
+			for ( k = 0; k < f->nexports; k++ )
+				f->exports[k].sym->refcnt++;
+			for ( k = 0; k < f->nimports; k++ )
+				f->imports[k].sym->refcnt++;
+		}
 	}
+	free(strs);
+	free(tmpn);
+	free(libOf);
+	free(xbase);
+	statEnd(STAT_CACHE_WRITE);
+	return hdr.magic ? -1 : 0;
 }
 
-/* Callback to print info about an Xref (obj and symbol names) */
-static void priInfAct(Xref r, int depth, void *closure)
-{
-int  i;
-ObjF f = r->obj;
-	for ( i=0; i<depth; i++ )
-		fputc(' ', logf);
-	fprintf(logf, "%s%s (because of '%s')\n", f->name, (void*)f == closure ? " (***)": "", r->sym ? r->sym->name : "");
-}
+/* string offset 'o' is valid if the (NUL-terminated) table holds it */
+#define DBC_STR_OK(o, hdr)	((o) < (hdr)->strSize)
+/* cross-reference index 'x' (or DBC_NONE) of a reference to the symbol in 'slot' */
+#define DBC_XREF_OK(x, slot, hdr, dx) \
+	(DBC_NONE == (x) || ((x) < (hdr)->nxrefs && (slot) == (dx)[x].sym))
 
 /*
- * Remove an object and all objects depending on it
- * (i.e. the files which would trigger linkage of 'f')
- * from its link set.
- * 
- * if 'checkOnly' is nonzero, the real work is not done
- * but the return value indicates if it would succeed.
- *
- * RETURNS: 0 on success, NONZERO on failure (i.e. members
- *          of the Application link set depend on 'f').
+ * Check that all indices, counts and string offsets of a cache are in
+ * range; the symbol slots used are marked in 'bySlot' (symTblSize + 1
+ * entries, zeroed). RETURNS 0 if the cache may be restored.
  */
-ObjF
-unlinkObj(ObjF f, int checkOnly)
+static int
+dbcCheck(DbcHdr hdr, DbcInput din, DbcLib dlib, uint32_t *dfiles, DbcObj dobj,
+         DbcSym dsym, DbcXref dx, char *dnotes, char *strs, Sym *bySlot)
 {
-ObjF	reject = 0;
-int		i;
+uint64_t	n;
+uint32_t	i, k;
 
-	if ( !f->link.anchor ) {
-		fputc(' ',logf);
-		fputc(' ',logf);
-		printObjName(logf,f);
-		fprintf(logf," is currently not part of any link set.\n");
-		return 0;
-	}
+	/* the string table is terminated (our caller checked), so are the notes */
+	if ( hdr->notesSize && dnotes[hdr->notesSize - 1] )
+		return -1;
 
-	depwalk(f, 0, 0, WALK_EXPORTS | WALK_BUILD_LIST);
+	if (   hdr->nobjs < 1
+		|| hdr->nsyms > hdr->symTblSize
+		|| (hdr->symTblSize & (hdr->symTblSize - 1))
+		|| (DBC_NONE != hdr->lastApp && hdr->lastApp >= hdr->nobjs) )
+		return -1;
 
-	/* check if any of the objects is part of the
-	 * fundamental link set
-	 */
-	workListIterate(f, checkSysLinkSet, &reject);
+	for ( i = 0; i < hdr->ninputs; i++ ) {
+		if ( !DBC_STR_OK(din[i].name, hdr) )
+			return -1;
+	}
 
-	if ( !checkOnly ) {
-		if ( ! reject ) {
-			workListIterate(f, doUnlink, 0);
-			workListIterate(f, checkSanity, 0);
-		} else if ( verbose & DEBUG_UNLINK ) {
-			fprintf(logf,"\n  skipping object '");
-			printObjName(logf,f);
-			fprintf(logf,"' (");
-			printObjName(logf,reject);
-			fprintf(logf, ":");
-			for ( i = 0; i<reject->nimports; i++) {
-				if (reject->imports[i].obj == f) {
-					fprintf(logf," %s",reject->imports[i].sym->name);
-				}
-			}
-			fprintf(logf,").\n");
-			fprintf(logf, "Work list:\n");
-			workListIterateRef(f, priInfAct, reject);
+	for ( n = 0, i = 0; i < hdr->nlibs; i++ ) {
+		if ( !DBC_STR_OK(dlib[i].name, hdr) )
+			return -1;
+		for ( k = 0; k < dlib[i].nfiles && n + k < hdr->nlibfiles; k++ ) {
+			/* a member (never the undefSymPod) of this library */
+			if ( dfiles[n + k] < 1 || dfiles[n + k] >= hdr->nobjs || dobj[dfiles[n + k]].lib != i )
+				return -1;
 		}
+		n += dlib[i].nfiles;
 	}
-	depwalkListRelease(f);
-	return reject;
+	if ( n != hdr->nlibfiles )
+		return -1;
+
+	for ( n = 0, i = 0; i < hdr->nobjs; i++ ) {
+		if ( !DBC_STR_OK(dobj[i].name, hdr) || (DBC_NONE != dobj[i].lib && dobj[i].lib >= hdr->nlibs) )
+			return -1;
+		n += (uint64_t)dobj[i].nexports + dobj[i].nimports;
+	}
+	if ( n != hdr->nxrefs )
+		return -1;
+
+	for ( i = 0; i < hdr->nsyms; i++ ) {
+		if (   !DBC_STR_OK(dsym[i].name, hdr)
+			|| dsym[i].len != strlen(strs + dsym[i].name)
+			|| dsym[i].slot >= hdr->symTblSize
+			|| bySlot[dsym[i].slot]
+			|| !DBC_XREF_OK(dsym[i].exportedBy,   dsym[i].slot, hdr, dx)
+			|| !DBC_XREF_OK(dsym[i].exportedLast, dsym[i].slot, hdr, dx)
+			|| !DBC_XREF_OK(dsym[i].exportedMax,  dsym[i].slot, hdr, dx)
+			|| !DBC_XREF_OK(dsym[i].strongest,    dsym[i].slot, hdr, dx) )
+			return -1;
+		/* mark the slot as used */
+		bySlot[dsym[i].slot] = (Sym)dsym;
+	}
+
+	for ( i = 0; i < hdr->nxrefs; i++ ) {
+		if ( dx[i].sym >= hdr->symTblSize || !bySlot[dx[i].sym] || !DBC_XREF_OK(dx[i].next, dx[i].sym, hdr, dx) )
+			return -1;
+	}
+
+	return 0;
 }
 
 /*
- * Unlink all modules depending on undefined symbols;
- * 
- * (This will fail for 'application' / critical objects.
- * The reason is that some symbols still might be
- * defined by the linker script or startup files [crti.o
- * & friends] - failure of 'unlinking' critical objects
- * is tolerated.)
+ * Load the database from 'dbname' if it is valid for 'inputs' (and
+ * the current '-f' setting) and was written in 'mode'.
+ *
+ * DBC_FULL:  the database must be empty.
+ * DBC_LIBS:  the objects are appended to the file list and symbols
+ *            merged into the symbol table. No libraries must exist yet.
+ *
+ * RETURNS: 0 if the database was loaded, nonzero if the inputs
+ *          must be scanned.
  */
-int
-unlinkUndefs()
+static int
+dbcRestore(char *dbname, char **inputs, int ninputs, ObjF *plastAppObj, int mode)
 {
-int		i;
-Xref	ex,p,n;
-ObjF	q = &undefSymPod;
+int			fd;
+struct stat	st;
+char		*map, *p, *strs, *dnotes;
+DbcHdr		hdr;
+DbcInput	din;
+DbcLib		dlib;
+uint32_t	*dfiles;
+DbcObj		dobj;
+DbcSym		dsym;
+DbcXref		dx;
+DbcInputRec	key;
+ObjF		objs, f;
+Lib			libs, l;
+Sym			syms, s, *bySlot;
+Xref		slab, r;
+size_t		need;
+uint32_t	i, k, nx;
+
+	if ( (fd = open(dbname, O_RDONLY)) < 0 )
+		return -1;
+
+	if ( fstat(fd, &st) || (size_t)st.st_size < sizeof(*hdr) ) {
+		close(fd);
+		return -1;
+	}
 
-	for (i=0, ex=q->exports; i<q->nexports; i++,ex++) {
-		/* Ignore weak undefs */
-		if ( ISWEAKUNDEF(TYPE(ex)) ) {
-			if ( verbose & DEBUG_UNLINK ) {
-				fprintf(logf,"skipping weak undef symbol '%s'...\n", ex->sym->name);
-			}
-			continue;
-		}
-		if ( verbose & DEBUG_UNLINK )
-			fprintf(logf,"removing objects depending on '%s'...", ex->sym->name);
-		for ( p = ex->sym->importedFrom; p; p=XREF_NEXT(p) ) {
-			/* If any importer of this symbol rejects unlinking
-			 * we probably deal with a startup file / linker script 
-			 * symbol and just skip it...
-			 */
-			if ( unlinkObj(p->obj, 1) ) {
-				if ( verbose & DEBUG_UNLINK )
-					fprintf(logf," (probably a linker script / startfile symbol).\n");
-				goto skipped;
-			}
-		}
-		while (ex->sym->importedFrom && 0==unlinkObj(ex->sym->importedFrom->obj, 0))
-			/* nothing else to do */;
-		if (ex->sym->importedFrom) {
-			/* ex->sym.importedFrom must depend on a system module, skip to the next */
-			p = ex->sym->importedFrom;
-			do {
-				if ( verbose & DEBUG_UNLINK ) {
-					fprintf(logf,"\n  skipping application dependeny; object '");
-					printObjName(logf,p->obj);
-					fprintf(logf,"'\n");
-				}
-				while ( (n=XREF_NEXT(p)) && 0 == unlinkObj(n->obj, 0) )
-					/* nothing else to do */;
-			} while ( p = n ); /* reached a system module; skip */
-		}
-		if ( verbose & DEBUG_UNLINK )
-			fprintf(logf,"done.\n");
-	skipped:
-		continue;
+	map = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if ( MAP_FAILED == map )
+		return -1;
+
+	hdr = (DbcHdr)map;
+
+	if (   DBC_MAGIC != hdr->magic || DBC_VERSION != hdr->version
+		|| force != hdr->force || mode != hdr->mode || ninputs != hdr->ninputs )
+		goto stale;
+
+	need =   sizeof(*hdr)
+	       + hdr->ninputs    * sizeof(*din)
+	       + hdr->nlibs      * sizeof(*dlib)
+	       + hdr->nlibfiles  * sizeof(*dfiles)
+	       + hdr->nobjs      * sizeof(*dobj)
+	       + hdr->nsyms      * sizeof(*dsym)
+	       + hdr->nxrefs     * sizeof(*dx)
+	       + hdr->notesSize
+	       + hdr->strSize;
+	if ( need != (size_t)st.st_size || hdr->nobjs < 1 )
+		goto stale;
+
+	p      = map + sizeof(*hdr);
+	din    = (DbcInput)p;   p += hdr->ninputs    * sizeof(*din);
+	dlib   = (DbcLib)p;     p += hdr->nlibs      * sizeof(*dlib);
+	dfiles = (uint32_t*)p;  p += hdr->nlibfiles  * sizeof(*dfiles);
+	dobj   = (DbcObj)p;     p += hdr->nobjs      * sizeof(*dobj);
+	dsym   = (DbcSym)p;     p += hdr->nsyms      * sizeof(*dsym);
+	dx     = (DbcXref)p;    p += hdr->nxrefs     * sizeof(*dx);
+	dnotes = p;             p += hdr->notesSize;
+	strs   = p;
+
+	if ( DBC_LIBS == mode && (dobj[0].nexports || dobj[0].nimports) )
+		goto stale;
+
+	/* every string offset below 'strSize' is NUL-terminated */
+	if ( hdr->strSize && strs[hdr->strSize - 1] )
+		goto stale;
+
+	for ( i = 0; i < hdr->ninputs; i++ ) {
+		if (   !DBC_STR_OK(din[i].name, hdr)
+			|| dbcInputKey(inputs[i], &key)
+			|| strcmp(strs + din[i].name, inputs[i])
+			|| key.dev     != din[i].dev
+			|| key.ino     != din[i].ino
+			|| key.size    != din[i].size
+			|| key.mtime   != din[i].mtime
+			|| key.mtimeNs != din[i].mtimeNs )
+			goto stale;
 	}
-	return 0;
-}
 
-Xref
-objHasRedef(ObjF f)
-{
-int i;
-Xref ex, r;
+	/* the inputs match; is the cache intact? */
+	if ( dbcSum(DBC_SUM_INIT, map + sizeof(*hdr), st.st_size - sizeof(*hdr)) != hdr->sum )
+		goto stale;
 
-	/* If we export a definition of a symbol that is
-	 * also defined by an object in the same library
-	 * but which is not linked then this object
-	 * must not be linked (because a reference to
-	 * our export would be resolved by the upstream
-	 * object!
-	 */
-	for (i=0, ex=f->exports; i<f->nexports; i++,ex++) {
-		char t = TYPE(ex);
+	assert( bySlot = calloc(hdr->symTblSize + 1, sizeof(*bySlot)) );
+	if ( dbcCheck(hdr, din, dlib, dfiles, dobj, dsym, dx, dnotes, strs, bySlot) ) {
+		free(bySlot);
+		goto stale;
+	}
 
-		if ( ISUNDEF( t ) )
-			continue;
+	/* the cache is valid; rebuild the database */
+	assert( 0 == numLibs );
 
-		if ( ! f->lib ) {
-			/* Not part of a library; in this case we must not redefine */
-			for ( r = ex->sym->exportedBy; r->obj != f; r = XREF_NEXT(r) ) {
-				if ( ISSTRONG( TYPE(ex) ) && ISSTRONG( TYPE( r ) ) && !ISCOMMON( t ) && !ISCOMMON( TYPE(r) ) )
-					return r;
-			}
-		} else {
-			for ( r = ex->sym->exportedBy; r->obj != f; r = XREF_NEXT(r) ) {
-				if ( r->obj->lib == f->lib ) {
-					if ( ! r->obj->link.anchor ) {
-						if ( ! strongerXref( ex, r ) && ISSTRONG( TYPE(ex) ) )
-							return r;
-					} else {
-						if ( ! strongerXref( r, ex ) && ISSTRONG( TYPE(r) ) )
-							return r;
-					}
-				}
-			}
-		}
+	if ( hdr->nobjs > 1 )
+		assert( objs = calloc(hdr->nobjs - 1, sizeof(*objs)) );
+	else
+		objs = 0;
+	if ( hdr->nlibs )
+		assert( libs = calloc(hdr->nlibs, sizeof(*libs)) );
+	else
+		libs = 0;
+	if ( hdr->nsyms )
+		assert( syms = calloc(hdr->nsyms, sizeof(*syms)) );
+	else
+		syms = 0;
+	if ( hdr->nxrefs ) {
+		assert( slab = malloc(hdr->nxrefs * sizeof(*slab)) );
+		/* check alignment with flags */
+		assert( 0 == ((unsigned long)slab & XREF_FLAGS) );
+	} else {
+		slab = 0;
 	}
-	return 0;
-}
 
-int
-unlinkMultdefs()
-{
-ObjF f;
-Xref coll;
+	for ( i = 0; i < hdr->nlibs; i++ ) {
+		l        = &libs[i];
+		l->name  = strIntern(strs + dlib[i].name, 0);
+		l->bname = libBasename(l->name);
+		if (libListTail)
+			libListTail->next = l;
+		else
+			libListHead	= l;
+		libListTail = l;
+		numLibs++;
+		nameIdxAdd(&libIndex, l->bname, symHash(l->bname, strlen(l->bname)), l);
+	}
 
-retry:
-	for ( f = fileListFirst() ; f; f = f->next ) {
-		if ( ! f->link.anchor ) {
-			/* currently not linked */
-		} else if ( (coll = objHasRedef( f )) ) {
-			ObjF rejected;
-			fprintf(logf,"%s defines symbol(s) colliding with other (strong) definitions by other objects in same library; unlinking...\n", f->name);
-			fprintf(logf,"Colliding symbol was %s (from %s)\n", coll->sym->name, coll->obj->name);
-			if ( ! (rejected = unlinkObj( f, 0 )) ) {
-				/* file list may have changed; must start from head again */
-				goto retry;
-			} else {
-				fprintf(logf, "Unlinking rejected because %s could not be removed\n", rejected->name );
-			}
+	for ( nx = 0, i = 0; i < hdr->nobjs; i++ ) {
+		f = i ? &objs[i - 1] : &undefSymPod;
+		if ( i ) {
+			f->name            = strIntern(strs + dobj[i].name, 0);
+			f->seq             = numFiles++;
+			fileListTail->next = f;
+			fileListTail       = f;
+		} else if ( DBC_LIBS == mode ) {
+			/* the undefSymPod is empty */
+			continue;
 		}
+		f->nexports = dobj[i].nexports;
+		f->nimports = dobj[i].nimports;
+		f->exports  = f->nexports ? slab + nx : 0;
+		nx         += f->nexports;
+		f->imports  = f->nimports ? slab + nx : 0;
+		nx         += f->nimports;
+		for ( k = 0; k < f->nexports + f->nimports; k++ )
+			slab[nx - f->nexports - f->nimports + k].obj = f;
+	}
+
+	/* library members in their original order */
+	for ( k = 0, i = 0; i < hdr->nlibs; i++ ) {
+		l = &libs[i];
+		for ( nx = 0; nx < dlib[i].nfiles; nx++ )
+			libAddObj(l, &objs[dfiles[k++] - 1]);
 	}
-}
 
-static DepWalkAction	depwalkAction   = 0;
-static void				*depwalkClosure = 0;
-static int				depwalkMode     = 0;
+	symTblResize(&symTbl, symTbl.nsyms + hdr->nsyms);
+	for ( i = 0; i < hdr->nsyms; i++ ) {
+		s               = &syms[i];
+		s->name         = strs + dsym[i].name;
+		s->len          = dsym[i].len;
+		s->hash         = dsym[i].hash;
+		s->flags        = dsym[i].flags;
+		s->refcnt       = dsym[i].refcnt;
+		s->exportedBy   = DBC_NONE == dsym[i].exportedBy   ? 0 : slab + dsym[i].exportedBy;
+		s->exportedLast = DBC_NONE == dsym[i].exportedLast ? 0 : slab + dsym[i].exportedLast;
+		s->exportedMax  = DBC_NONE == dsym[i].exportedMax  ? 0 : slab + dsym[i].exportedMax;
+		s->strongest    = DBC_NONE == dsym[i].strongest    ? 0 : slab + dsym[i].strongest;
+		/* the application may already have entered this symbol */
+		if ( (bySlot[dsym[i].slot] = symTblSearch(&symTbl, s)) != s )
+			bySlot[dsym[i].slot]->refcnt += s->refcnt;
+	}
 
+	for ( i = 0; i < hdr->nxrefs; i++ ) {
+		r        = &slab[i];
+		r->sym   = bySlot[dx[i].sym];
+		r->size  = dx[i].size;
+		r->xtype = dx[i].xtype;
+		xref_set_next(r, DBC_NONE == dx[i].next ? 0 : slab + dx[i].next);
+	}
+	free(bySlot);
 
-#define BUSY 		((Xref)depwalk) /* just some address */
-#define MATCH_ANY	((Lib)depwalk)	/* just some address */
+	if ( plastAppObj ) {
+		if ( DBC_NONE == hdr->lastApp )
+			*plastAppObj = 0;
+		else
+			*plastAppObj = hdr->lastApp ? &objs[hdr->lastApp - 1] : &undefSymPod;
+	}
+
+	/* replay the diagnostics */
+	for ( p = dnotes; p < dnotes + hdr->notesSize; p += strlen(p) + 1 )
+		fputs(p + 1, 'E' == *p ? stderr : logf);
+
+	if ( DBC_LIBS == mode ) {
+		dbcLibSum   = hdr->sum;
+		dbcLibValid = 1;
+	}
+
+	/* the mapping is retained; names point into it */
+	return 0;
+
+stale:
+	munmap(map, st.st_size);
+	return -1;
+}
 
-#define DO_EXPORTS (depwalkMode & WALK_EXPORTS)
+/* dbcRestore(), timed ('--stats') */
+static int
+dbcLoad(char *dbname, char **inputs, int ninputs, ObjF *plastAppObj, int mode)
+{
+int rval;
+	statBegin(STAT_CACHE_LOAD);
+	rval = dbcRestore(dbname, inputs, ninputs, plastAppObj, mode);
+	statEnd(STAT_CACHE_LOAD);
+	return rval;
+}
 
 /*
- * Recursively walk the 'exports' or 'imports' list of an object
- * (private helper routine with few arguments to save stack space
+ * Binary trace of the link/unlink decisions ('--trace-events'). The
+ * file starts with TRACE_MAGIC and is a sequence of (native endian)
+ * records; object and string names are defined by a record followed
+ * by the name ('aux' bytes, not NUL-terminated) before they are
+ * first referenced. Objects are referenced by their 'seq', strings
+ * (symbol and link set names) by their id (0: none). '--trace-show'
+ * turns a trace into text.
  */
+#define TRACE_MAGIC		"LDEPTR01"
+
+#define TR_DEF_OBJ		1	/* obj: seq;  aux: length of the name */
+#define TR_DEF_STR		2	/* str: id;   aux: length of the string */
+#define TR_LINK			3	/* 'obj' linked because of 'str' to link set 'aux' */
+#define TR_UNLINK		4	/* 'obj' unlinked */
+#define TR_REJECT		5	/* unlinking 'obj' rejected; 'aux' (app link set) needs it */
+#define TR_WEAK			6	/* weak undefined symbol 'str' skipped */
+#define TR_UNDEF		7	/* removing the objects depending on undefined 'str' */
+#define TR_UNDEF_SKIP	8	/* not removing them; importer 'aux' is needed by the app */
+
+typedef struct TraceRecRec_ {
+	unsigned short	kind;
+	unsigned short	depth;
+	unsigned		obj;
+	unsigned		str;
+	unsigned		aux;
+} TraceRecRec, *TraceRec;
+
+typedef struct TraceStrRec_ {
+	unsigned	hash;
+	unsigned	id;			/* 0: empty slot */
+	char		*str;
+} TraceStrRec, *TraceStr;
+
+static FILE				*traceFile = 0;
+static const char		*traceFname = 0;
+static int				traceErr = 0;		/* a write failed */
+static unsigned char	*traceObjDefd = 0;	/* indexed by seq */
+static int				traceObjAvail = 0;
+static TraceStr			traceStrTbl   = 0;
+static unsigned			traceStrSize  = 0;	/* power of two */
+static unsigned			traceNStrs    = 0;
+
+/* append 'n' bytes to the trace (a failure is reported by traceClose()) */
 static void
-depwalk_rec(ObjF f, int depth)
+traceData(const void *p, size_t n)
 {
-register int	i;
-register Xref ref;
-
-	if (depwalkAction)
-		depwalkAction(f,depth,depwalkClosure);
-
-	for ( i=0; i < (DO_EXPORTS ? f->nexports : f->nimports); i++ ) {
-		if ( DO_EXPORTS && strongestExport( f->exports[i].sym )->obj != f ) {
-			/* Another module already exports this */
-			continue;
-		}
-		for (ref = (DO_EXPORTS ? f->exports[i].sym->importedFrom : strongestExport(f->imports[i].sym));
-			 ref;
-			 ref = (DO_EXPORTS ? XREF_NEXT(ref) : 0 /* use only the first definition */) ) {
-
-			/* weak undefs are on import + export list; ignore */
-			if ( ref->obj == f && ISWEAKUNDEF(TYPE(ref)) )
-				continue;
+	if ( n && 1 != fwrite(p, n, 1, traceFile) )
+		traceErr = 1;
+}
 
-			assert( ref->obj != f );
+static void
+traceWrite(int kind, int depth, unsigned obj, unsigned str, unsigned aux)
+{
+TraceRecRec r;
+	r.kind  = kind;
+	r.depth = depth > 0xffff ? 0xffff : depth;
+	r.obj   = obj;
+	r.str   = str;
+	r.aux   = aux;
+	traceData(&r, sizeof(r));
+}
 
-			if ( !ref->obj->work ) {
-				/* mark in use */
-#ifdef NWORK
-/*				fprintf(debugf,"Linking %s between %s and %s\n", ref->obj->name, f->name, f->work && f->work != BUSY ? f->work->name : "NIL");    */
-				ref->obj->work      = f->work;
-				ref->obj->workDepth = depth + 1;
-				f->work             = ref;
-				assert( 0 == checkCircWorkList(f) );
-#else
-				ref->obj->work = f;
-				if ( (depwalkMode & WALK_BUILD_LIST) ) {
-					ref->obj->work1 = f->work1;
-					f->work1	   = ref->obj;
-				}
-#endif
-				depwalk_rec(ref->obj, depth+1);
-				if ( ! (depwalkMode & WALK_BUILD_LIST) ) {
-#ifdef NWORK
-					f->work             = ref->obj->work;
-					ref->obj->work      = 0;
-					ref->obj->workDepth = 0;
-#else
-					ref->obj->work = 0;
-#endif
-				}
-			} /* else break circular dependency */
-		}
+static int
+traceOpen(const char *fname)
+{
+	if ( !(traceFile = fopen(fname, "wb")) ) {
+		fprintf(stderr, "Unable to open trace file '%s' for writing: %s\n", fname, strerror(errno));
+		return -1;
 	}
+	traceFname = fname;
+	traceErr   = 0;
+	traceData(TRACE_MAGIC, strlen(TRACE_MAGIC));
+	return 0;
 }
 
 /*
- * Recursively walk the 'exports' or 'imports' list of an object
- * and invoke a user defined action on every visited node.
- *
- * 'mode' flags define whether to walk the 'export' or 'import' list.
+ * Close the trace file and stop tracing (nothing is traced while
+ * serving).
  *
- * Another flag 'WALK_BUILD_LIST' instructs the routine to
- * build a linked list of all objects referenced (directly or indirectly)
- * by the export or import list. No action is invoked in this mode.
- * The list must be released by calling depwalkListRelease() which will
- * also cause the action to be invoked for every node on the list.
+ * RETURNS: 0 on success, -1 if writing the trace failed.
  */
-void
-depwalk(ObjF f, DepWalkAction action, void *closure, int mode)
+static int
+traceClose()
 {
-	assert(f->work == 0 );
+int err;
 
-	assert( !(depwalkMode & WALK_BUILD_LIST) );
+	if ( !traceFile )
+		return 0;
 
-	depwalkMode    = mode;
-	depwalkAction  = (depwalkMode & WALK_BUILD_LIST) ? 0 : action;
-	depwalkClosure = closure;
+	verbose &= ~DEBUG_TRACE;
 
-	f->work = BUSY;
-	depwalk_rec(f, 0);
+	err = traceErr || ferror(traceFile);
+	if ( fclose(traceFile) )
+		err = 1;
+	traceFile = 0;
 
-	if (depwalkMode & WALK_BUILD_LIST) {
-		depwalkAction = action;
-	} else {
-		f->work = 0;
+	if ( err ) {
+		fprintf(stderr, "Writing trace file '%s' failed: %s\n", traceFname, strerror(errno));
+		return -1;
 	}
+	return 0;
 }
 
-/* Clear 'f's work list */
-void
-workListRelease(ObjF f)
+/* RETURNS the trace reference of 'f' (defining it first, if necessary) */
+static unsigned
+traceObj(ObjF f)
 {
-Xref tmp;
-#ifdef NWORK
-	tmp = f->work;
-	f->work      = 0;
-	f->workDepth = 0;
-	while ( tmp != BUSY ) {
-		f = tmp->obj;
-		tmp = f->work;
-		f->work      = 0;
-		f->workDepth = 0;
+char	buf[MAXBUF+1];
+int		old = traceObjAvail;
+
+	if ( f->seq >= traceObjAvail ) {
+		traceObjDefd = stackReserve(traceObjDefd, &traceObjAvail, f->seq + 1, sizeof(*traceObjDefd));
+		memset(traceObjDefd + old, 0, traceObjAvail - old);
 	}
-#else
-	for (tmp = f; tmp; ) {
-		tmp = f->work1;
-		f->work1 = 0;
-		f->work  = 0;
-		f        = tmp;
+	if ( !traceObjDefd[f->seq] ) {
+		traceObjDefd[f->seq] = 1;
+		sprintObjName(buf, sizeof(buf), f);
+		traceWrite(TR_DEF_OBJ, 0, f->seq, 0, strlen(buf));
+		traceData(buf, strlen(buf));
 	}
-#endif
+	return f->seq;
 }
 
-/* Invoke an action for every node on the work list */
-void
-workListIterate(ObjF f, DepWalkAction action, void *closure)
+/* RETURNS the trace id of string 's' (defining it first, if necessary) */
+static unsigned
+traceStr(const char *s)
 {
-#ifdef NWORK
-	action(f, f->workDepth, closure);
-	while ( BUSY != f->work ) {
-		f = f->work->obj;
-		action(f, f->workDepth, closure);
-	}
-#else
-int   depth = 0;
-	while ( f ) {
-		action(f, depth++, closure);
-		f = f->work1;
+int			len;
+unsigned	h, i, j;
+TraceStr	t;
+
+	if ( !s )
+		return 0;
+
+	if ( 2*(traceNStrs + 1) > traceStrSize ) {
+		/* rehash */
+		t = traceStrTbl;
+		traceStrSize = traceStrSize ? 2*traceStrSize : 1024;
+		assert( traceStrTbl = calloc(traceStrSize, sizeof(*traceStrTbl)) );
+		for ( j = 0; t && j < traceStrSize/2; j++ ) {
+			if ( !t[j].id )
+				continue;
+			for ( i = t[j].hash & (traceStrSize - 1); traceStrTbl[i].id; i = (i + 1) & (traceStrSize - 1) )
+				/* nothing else to do */;
+			traceStrTbl[i] = t[j];
+		}
+		free(t);
 	}
-#endif
-}
 
-void
-workListIterateRef(ObjF f, DepWalkActionRef action, void *closure)
-{
-XrefRec r = {0};
-r.obj = f;
-	action(&r, f->workDepth, closure);
-	while ( BUSY != f->work ) {
-		action(f->work, f->workDepth, closure);
-		f = f->work->obj;
+	len = strlen(s);
+	h   = symHash(s, len);
+	for ( i = h & (traceStrSize - 1); (t = &traceStrTbl[i])->id; i = (i + 1) & (traceStrSize - 1) ) {
+		if ( t->hash == h && !strcmp(t->str, s) )
+			return t->id;
 	}
+	t->hash = h;
+	t->id   = ++traceNStrs;
+	assert( t->str = strdup(s) );
+	traceWrite(TR_DEF_STR, 0, 0, t->id, len);
+	traceData(s, len);
+	return t->id;
 }
 
-/* Release the work list of an object and invoke the action
- * passed to 'depwalk()' 
- */
-void
-depwalkListRelease(ObjF f)
+/* Record one event; 'f', 'sym' and 'other' are optional (TR_LINK records the link set of 'f') */
+static void
+traceEvent(int kind, int depth, ObjF f, const char *sym, ObjF other)
 {
-ObjF	tmp;
-int		depth = 0;
-	assert( (depwalkMode & WALK_BUILD_LIST) );
-	if (depwalkAction)
-		workListIterate(f, depwalkAction, depwalkClosure);
-	workListRelease(f);
-	depwalkMode = 0;
+unsigned o, s, a;
+	o = f ? traceObj(f) : 0;
+	s = traceStr(sym);
+	if ( TR_LINK == kind )
+		a = traceStr(f->link.anchor->name);
+	else
+		a = other ? traceObj(other) : 0;
+	traceWrite(kind, depth, o, s, a);
 }
 
-
-static void
-symTraceAct(const void *pnode, const VISIT when, const int depth)
+/* Read a name of 'len' bytes from the trace into entry 'id' of 'names' */
+static int
+traceShowName(FILE *t, char ***names, int *avail, unsigned id, unsigned len)
 {
-	if ( postorder == when || leaf == when ) {
-		trackSym(logf, *(Sym*)pnode);
+int old = *avail;
+	if ( id >= (unsigned)*avail ) {
+		*names = stackReserve(*names, avail, id + 1, sizeof(**names));
+		memset(*names + old, 0, (*avail - old) * sizeof(**names));
 	}
+	free((*names)[id]);
+	assert( (*names)[id] = malloc(len + 1) );
+	(*names)[id][len] = 0;
+	return 1 == fread((*names)[id], len, 1, t) || 0 == len ? 0 : -1;
 }
 
-/* Paranoia check */
-int checkObjPtrs()
+/* Render the trace file 'fname' as text to 'feil'; RETURNS 0 on success */
+static int
+traceShow(const char *fname, FILE *feil)
 {
-int		err=0;
-ObjF	f;
-	for (f=fileListHead; f; f=f->next) { 
-		int ii;
-		for (ii=0; ii<f->nexports; ii++) {
-			if (f->exports[ii].obj != f) {
-				fprintf(stderr,"%s %ith export obj pointer corrupted\n", f->name, ii);
-				err++;
-			}
-		}
-		for (ii=0; ii<f->nimports; ii++) {
-			if (f->imports[ii].obj != f) {
-				fprintf(stderr,"%s %ith import obj pointer corrupted\n", f->name, ii);
-				err++;
-			}
-		}
+FILE		*t;
+char		magic[sizeof(TRACE_MAGIC)];
+TraceRecRec	r;
+char		**objs  = 0, **strs  = 0;
+int			aobjs   = 0, astrs   = 0;
+int			i, rval = -1;
+size_t		got;
+
+/* references may only name defined entries */
+#define TRNAME(tbl, a, x)	((x) < (unsigned)(a) && (tbl)[x] ? (tbl)[x] : "?")
+
+	if ( !(t = fopen(fname, "rb")) ) {
+		fprintf(stderr, "Unable to open trace file '%s': %s\n", fname, strerror(errno));
+		return -1;
+	}
+	if ( 1 != fread(magic, strlen(TRACE_MAGIC), 1, t) || strncmp(magic, TRACE_MAGIC, strlen(TRACE_MAGIC)) ) {
+		fprintf(stderr, "'%s' is not a trace file (or of an incompatible version)\n", fname);
+		goto bail;
 	}
-	return err;
-}
-
-typedef struct {
-	ObjF	test;
-	int		result;
-} CheckArgRec, *CheckArg;
 
-static void circCheckAction(ObjF f, int depth, void *closure)
+	while ( sizeof(r) == (got = fread(&r, 1, sizeof(r), t)) ) {
+		switch ( r.kind ) {
+			case TR_DEF_OBJ:
+				if ( traceShowName(t, &objs, &aobjs, r.obj, r.aux) )
+					goto truncated;
+			break;
+			case TR_DEF_STR:
+				if ( traceShowName(t, &strs, &astrs, r.str, r.aux) )
+					goto truncated;
+			break;
+			case TR_LINK:
+				for ( i = 0; i < r.depth; i++ )
+					fputc(' ', feil);
+				fprintf(feil, "Linking '%s' ", TRNAME(objs, aobjs, r.obj));
+				if ( r.str )
+					fprintf(feil, "because of '%s' ", TRNAME(strs, astrs, r.str));
+				fprintf(feil, "to %s link set\n", TRNAME(strs, astrs, r.aux));
+			break;
+			case TR_UNLINK:
+				fprintf(feil, "  removing object '%s'\n", TRNAME(objs, aobjs, r.obj));
+			break;
+			case TR_REJECT:
+				fprintf(feil, "  skipping object '%s' ('%s' is needed by app)\n",
+					TRNAME(objs, aobjs, r.obj), TRNAME(objs, aobjs, r.aux));
+			break;
+			case TR_WEAK:
+				fprintf(feil, "skipping weak undef symbol '%s'\n", TRNAME(strs, astrs, r.str));
+			break;
+			case TR_UNDEF:
+				fprintf(feil, "removing objects depending on '%s'\n", TRNAME(strs, astrs, r.str));
+			break;
+			case TR_UNDEF_SKIP:
+				fprintf(feil, "not removing objects depending on '%s' ('%s' is needed by app)\n",
+					TRNAME(strs, astrs, r.str), TRNAME(objs, aobjs, r.aux));
+			break;
+			default:
+				fprintf(stderr, "Corrupt trace file '%s' (unknown event %u)\n", fname, r.kind);
+				goto bail;
+		}
+	}
+#undef TRNAME
+	if ( got || !feof(t) ) {
+truncated:
+		fprintf(stderr, "Trace file '%s' is truncated\n", fname);
+		goto bail;
+	}
+	rval = 0;
+
+bail:
+	for ( i = 0; i < aobjs; i++ )
+		free(objs[i]);
+	for ( i = 0; i < astrs; i++ )
+		free(strs[i]);
+	free(objs);
+	free(strs);
+	fclose(t);
+	return rval;
+}
+
+/*
+ * Link an object and recursively resolve all of its
+ * dependencies. Objects which are not already members
+ * of a link set become members of 'f's link set.
+ *
+ * Semantics: caller must have asserted that
+ * 'f' is not part of any linkset already
+ * (f->link.anchor == 0).
+ * Then, the caller sets f->link.anchor and
+ * calls 'link' to perform a recursive link.
+ */
+
+/* frame of the explicit stack used by linkObj() */
+typedef struct LinkFrameRec_ {
+	ObjF	f;
+	int		i;			/* next import of 'f' to process */
+} LinkFrameRec, *LinkFrame;
+
+static void
+linkLog(ObjF f, char *symname, int l)
+{
+int i;
+	if ( LOGGING(DEBUG_TRACE) )
+		traceEvent(TR_LINK, l, f, symname, 0);
+	if ( ! LOGGING(DEBUG_LINK) )
+		return;
+	for ( i=0; i<l; i++ )
+		fputc(' ', logf);
+	fprintf(logf,"Linking '"); printObjName(debugf,f); fputc('\'', debugf);
+	if (symname)
+		fprintf(logf,"because of '%s'",symname);
+	fprintf(logf," to %s link set\n", f->link.anchor->name);
+}
+
+int
+linkObj(ObjF f, char *symname, int l)
+{
+static LinkFrame	stack = 0;
+static int			avail = 0;
+int					sp;
+register LinkFrame	fr;
+register Xref		imp;
+
+	assert(f->link.anchor);
+
+
+	if (LOGGING(DEBUG_LINK | DEBUG_TRACE))
+		linkLog(f, symname, l);
+
+	/* Depth-first traversal on an explicit stack; 'f' joins the
+	 * link set after all of its dependencies (as a recursive
+	 * implementation would do it).
+	 */
+	stack = stackReserve(stack, &avail, 1, sizeof(*stack));
+	stack[0].f = f;
+	stack[0].i = 0;
+	sp         = 1;
+
+	while ( sp > 0 ) {
+		fr = &stack[sp-1];
+		f  = fr->f;
+
+		if ( fr->i >= f->nimports ) {
+			f->link.next = (f->link.anchor->set);
+			f->link.anchor->set = f;
+			sp--;
+			continue;
+		}
+
+		imp = &f->imports[fr->i++];
+		{
+		register Sym found = imp->sym;
+		assert( 0 == XREF_NEXT(imp) );
+
+		/* add ourself to the importers of that symbol */
+		xref_set_next(imp, found->importedFrom);
+		found->importedFrom = imp;
+
+		if ( ! found->exportedBy ) {
+			if (warn & WARN_UNDEFINED_SYMS) {
+				fprintf(stderr,
+					"Warning: symbol %s:%s undefined\n",
+					f->name, imp->sym->name);
+			}
+		} else {
+			ObjF	dep= strongestExport(found)->obj;
+			if ( f->link.anchor && !dep->link.anchor ) {
+				dep->link.anchor = f->link.anchor;
+				if (LOGGING(DEBUG_LINK | DEBUG_TRACE))
+					linkLog(dep, found->name, l + sp);
+				stack = stackReserve(stack, &avail, sp + 1, sizeof(*stack));
+				stack[sp].f = dep;
+				stack[sp].i = 0;
+				sp++;
+			}
+		}
+		}
+	}
+
+	return 0;
+}
+
+/* Dump info about a symbol to 'feil' */
+void
+trackSym(FILE *feil, Sym s)
+{
+Xref 			ex;
+Xref			imp;
+DepPrintArgRec	arg;
+
+	arg.depthIndent = -2;
+	arg.file		= feil;
+
+	fprintf(feil,"What I know about Symbol '%s':\n", s->name);
+	fprintf(feil,"  Defined in object: ");
+	if ( ! (ex = s->exportedBy) ) {
+		fprintf(feil," NOWHERE!!!\n");
+	} else {
+		printObjName(feil, ex->obj);
+		fprintf(feil,"%s\n", XREF_WEAK(ex) ? " (WEAK)" : "");
+		while ( ex=XREF_NEXT(ex) ) {
+			fprintf(feil,"      AND in object: ");
+			printObjName(feil, ex->obj);
+			fprintf(feil,"%s\n", XREF_WEAK(ex) ? " (WEAK)" : "");
+		}
+	}
+
+	if ( (ex=s->exportedBy) ) {
+		fprintf(feil,"  Depending on objects (triggers linkage of):");
+		if (0 == ex->obj->nimports) {
+			fprintf(feil," NONE\n");
+		} else {
+			fprintf(feil,"\n");
+			arg.minDepth    = 1;
+			arg.indent      = 0;
+			depwalk(&depwalkMain, ex->obj, depPrint, (void*)&arg, WALK_IMPORTS | WALK_BUILD_LIST);
+			depwalkListRelease(&depwalkMain, ex->obj);
+		}
+	}
+
+	fprintf(feil,"  Objects depending (maybe indirectly) on this symbol:\n");
+    fprintf(feil,"  Note: the host object may depend on yet more objects due to other symbols...\n");
+
+	imp = s->importedFrom;
+
+	if ( imp ) {
+		fprintf(feil,"\n");
+		arg.minDepth    = 0;
+		arg.indent      = 4;
+		do {
+			depwalk(&depwalkMain, imp->obj, depPrint, (void*)&arg, WALK_EXPORTS | WALK_BUILD_LIST);
+			depwalkListRelease(&depwalkMain, imp->obj);
+		} while ( imp = XREF_NEXT(imp) );
+	} else {
+		fprintf(feil," NONE\n");
+	}
+}
+
+/* Dump info about an object to 'feil' */
+int
+trackObj(FILE *feil, ObjF f)
+{
+int				i;
+DepPrintArgRec	arg;
+
+	fprintf(feil,"What I know about object '");
+	printObjName(feil,f);
+	fprintf(feil,"':\n");
+
+	fprintf(feil,"  Exported symbols:\n");
+
+	for ( i=0; i<f->nexports; i++)
+		fprintf(feil,"    %s\n",f->exports[i].sym->name);
+
+	fprintf(feil,"  Imported symbols:\n");
+
+	for ( i=0; i<f->nimports; i++)
+		fprintf(feil,"    %s\n",f->imports[i].sym->name);
+
+	fprintf(feil,"  Objects depending on me (including indirect dependencies):\n");
+
+	arg.minDepth    = 0;
+	arg.indent      = 4;
+	arg.depthIndent = -1;
+	arg.file		= feil;
+
+	depwalk(&depwalkMain, f, depPrint, (void*)&arg, WALK_EXPORTS | WALK_BUILD_LIST);
+	depwalkListRelease(&depwalkMain, f);
+
+	fprintf(feil,"  Objects I depend on (including indirect dependencies):\n");
+
+	depwalk(&depwalkMain, f, depPrint, (void*)&arg, WALK_IMPORTS | WALK_BUILD_LIST);
+	depwalkListRelease(&depwalkMain, f);
+	
+	return 0;
+}
+
+static void
+doUnlink(ObjF f, int depth, void *closure)
+{
+Xref	imp,p,n;
+int		i;
+ObjF	*pl;
+
+	if ( LOGGING(DEBUG_TRACE) )
+		traceEvent(TR_UNLINK, 0, f, 0, 0);
+	if ( LOGGING(DEBUG_UNLINK) ) {
+		fprintf(logf,"\n  removing object '");
+		printObjName(logf,f);
+		fprintf(logf,"'... ");
+	}
+
+	for (i=0, imp=f->imports; i<f->nimports; i++, imp++) {
+		/* remove ourself from the list of importers of that symbol */
+
+		/* retrieve our predecessor */
+		p = imp->sym->importedFrom;
+		
+		if ( p == imp ) {
+			imp->sym->importedFrom = XREF_NEXT(imp);
+		} else {
+			while ( p && ((n=XREF_NEXT(p)) != imp) ) {
+				p = n;
+			}
+			assert( p );
+			xref_set_next(p, XREF_NEXT(imp));
+		}
+		
+		xref_set_next(imp, 0);
+	}
+
+	/* remove this object from its linkset */
+	for (pl = &f->link.anchor->set; *pl && (*pl != f); pl = &((*pl)->link.next) )
+		/* do nothing else */;
+	assert( *pl );
+	*pl = f->link.next;
+	f->link.next   = 0;
+	f->link.anchor = 0;
+
+	if ( LOGGING(DEBUG_UNLINK) )
+		fprintf(logf,"OK\n");
+}
+
+static void
+checkSysLinkSet(ObjF f, int depth, void *closure)
+{
+ObjF *reject = closure;
+	if ( f->link.anchor == &appLinkSet ) {
+		if ( ! *reject ) {
+		  	if ( LOGGING(DEBUG_UNLINK) ) {
+				fprintf(logf,"  --> rejected because '");
+				printObjName(logf,f);
+				fprintf(logf,"' is needed by app");
+			}
+		*reject = f;
+		}
+	}
+}
+
+static void
+checkSanity(ObjF f, int depth, void *closure)
+{
+Xref	ex;
+int		i;
+	/* sanity check. All exported symbols' import lists must be empty
+	 * -- unless the strongest export is by another object
+	 */
+	for (i=0, ex=f->exports; i<f->nexports; i++,ex++) {
+		if ( strongestExport( ex->sym )->obj != f )
+			continue;
+		assert( ex->sym->importedFrom == 0 );
+	}
+}
+
+/* Callback to print info about an Xref (obj and symbol names) */
+static void priInfAct(Xref r, int depth, void *closure)
+{
+int  i;
+ObjF f = r->obj;
+	for ( i=0; i<depth; i++ )
+		fputc(' ', logf);
+	fprintf(logf, "%s%s (because of '%s')\n", f->name, (void*)f == closure ? " (***)": "", r->sym ? r->sym->name : "");
+}
+
+/* Log that unlinking 'f' is rejected because 'reject' needs it (the work list follows) */
+static void
+logUnlinkSkip(ObjF f, ObjF reject)
+{
+int i;
+	fprintf(logf,"\n  skipping object '");
+	printObjName(logf,f);
+	fprintf(logf,"' (");
+	printObjName(logf,reject);
+	fprintf(logf, ":");
+	for ( i = 0; i<reject->nimports; i++) {
+		if (reject->imports[i].obj == f) {
+			fprintf(logf," %s",reject->imports[i].sym->name);
+		}
+	}
+	fprintf(logf,").\n");
+	fprintf(logf, "Work list:\n");
+}
+
+/*
+ * Remove an object and all objects depending on it
+ * (i.e. the files which would trigger linkage of 'f')
+ * from its link set.
+ * 
+ * if 'checkOnly' is nonzero, the real work is not done
+ * but the return value indicates if it would succeed.
+ *
+ * RETURNS: 0 on success, NONZERO on failure (i.e. members
+ *          of the Application link set depend on 'f').
+ */
+static ObjF
+unlinkObjNotify(ObjF f, int checkOnly, DepWalkAction notify, void *closure);
+
+ObjF
+unlinkObj(ObjF f, int checkOnly)
+{
+	return unlinkObjNotify(f, checkOnly, 0, 0);
+}
+
+/*
+ * Like unlinkObj() but the action 'notify' is invoked for every
+ * object removed (after all of them have been removed).
+ */
+static ObjF
+unlinkObjNotify(ObjF f, int checkOnly, DepWalkAction notify, void *closure)
+{
+ObjF	reject = 0;
+
+	stats.unlinkCalls++;
+
+	if ( !f->link.anchor ) {
+		fputc(' ',logf);
+		fputc(' ',logf);
+		printObjName(logf,f);
+		fprintf(logf," is currently not part of any link set.\n");
+		return 0;
+	}
+
+	depwalk(&depwalkMain, f, 0, 0, WALK_EXPORTS | WALK_BUILD_LIST);
+
+	/* check if any of the objects is part of the
+	 * fundamental link set
+	 */
+	workListIterate(&depwalkMain, f, checkSysLinkSet, &reject);
+
+	if ( !checkOnly ) {
+		if ( ! reject ) {
+			workListIterate(&depwalkMain, f, doUnlink, 0);
+			workListIterate(&depwalkMain, f, checkSanity, 0);
+			if ( notify )
+				workListIterate(&depwalkMain, f, notify, closure);
+		} else {
+			if ( LOGGING(DEBUG_TRACE) )
+				traceEvent(TR_REJECT, 0, f, 0, reject);
+			if ( LOGGING(DEBUG_UNLINK) ) {
+				logUnlinkSkip(f, reject);
+				workListIterateRef(&depwalkMain, f, priInfAct, reject);
+			}
+		}
+	}
+	depwalkListRelease(&depwalkMain, f);
+	return reject;
+}
+
+/*
+ * Unlink all modules depending on undefined symbols;
+ * 
+ * (This will fail for 'application' / critical objects.
+ * The reason is that some symbols still might be
+ * defined by the linker script or startup files [crti.o
+ * & friends] - failure of 'unlinking' critical objects
+ * is tolerated.)
+ */
+int
+unlinkUndefs()
+{
+int		i;
+Xref	ex,p,n;
+ObjF	q = &undefSymPod;
+
+	for (i=0, ex=q->exports; i<q->nexports; i++,ex++) {
+		/* Ignore weak undefs */
+		if ( ISWEAKUNDEF(TYPE(ex)) ) {
+			if ( LOGGING(DEBUG_TRACE) )
+				traceEvent(TR_WEAK, 0, 0, ex->sym->name, 0);
+			if ( LOGGING(DEBUG_UNLINK) ) {
+				fprintf(logf,"skipping weak undef symbol '%s'...\n", ex->sym->name);
+			}
+			continue;
+		}
+		if ( LOGGING(DEBUG_UNLINK) )
+			fprintf(logf,"removing objects depending on '%s'...", ex->sym->name);
+		for ( p = ex->sym->importedFrom; p; p=XREF_NEXT(p) ) {
+			/* If any importer of this symbol rejects unlinking
+			 * we probably deal with a startup file / linker script 
+			 * symbol and just skip it...
+			 */
+			if ( unlinkObj(p->obj, 1) ) {
+				if ( LOGGING(DEBUG_TRACE) )
+					traceEvent(TR_UNDEF_SKIP, 0, 0, ex->sym->name, p->obj);
+				if ( LOGGING(DEBUG_UNLINK) )
+					fprintf(logf," (probably a linker script / startfile symbol).\n");
+				goto skipped;
+			}
+		}
+		if ( LOGGING(DEBUG_TRACE) )
+			traceEvent(TR_UNDEF, 0, 0, ex->sym->name, 0);
+		while (ex->sym->importedFrom && 0==unlinkObj(ex->sym->importedFrom->obj, 0))
+			/* nothing else to do */;
+		if (ex->sym->importedFrom) {
+			/* ex->sym.importedFrom must depend on a system module, skip to the next */
+			p = ex->sym->importedFrom;
+			do {
+				if ( LOGGING(DEBUG_UNLINK) ) {
+					fprintf(logf,"\n  skipping application dependeny; object '");
+					printObjName(logf,p->obj);
+					fprintf(logf,"'\n");
+				}
+				while ( (n=XREF_NEXT(p)) && 0 == unlinkObj(n->obj, 0) )
+					/* nothing else to do */;
+			} while ( p = n ); /* reached a system module; skip */
+		}
+		if ( LOGGING(DEBUG_UNLINK) )
+			fprintf(logf,"done.\n");
+	skipped:
+		continue;
+	}
+	return 0;
+}
+
+Xref
+objHasRedef(ObjF f)
+{
+int i;
+Xref ex, r;
+
+	/* If we export a definition of a symbol that is
+	 * also defined by an object in the same library
+	 * but which is not linked then this object
+	 * must not be linked (because a reference to
+	 * our export would be resolved by the upstream
+	 * object!
+	 */
+	for (i=0, ex=f->exports; i<f->nexports; i++,ex++) {
+		char t = TYPE(ex);
+
+		if ( ISUNDEF( t ) )
+			continue;
+
+		if ( ! f->lib ) {
+			/* Not part of a library; in this case we must not redefine */
+			for ( r = ex->sym->exportedBy; r->obj != f; r = XREF_NEXT(r) ) {
+				if ( ISSTRONG( TYPE(ex) ) && ISSTRONG( TYPE( r ) ) && !ISCOMMON( t ) && !ISCOMMON( TYPE(r) ) )
+					return r;
+			}
+		} else {
+			for ( r = ex->sym->exportedBy; r->obj != f; r = XREF_NEXT(r) ) {
+				if ( r->obj->lib == f->lib ) {
+					if ( ! r->obj->link.anchor ) {
+						if ( ! strongerXref( ex, r ) && ISSTRONG( TYPE(ex) ) )
+							return r;
+					} else {
+						if ( ! strongerXref( r, ex ) && ISSTRONG( TYPE(r) ) )
+							return r;
+					}
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/* a growable list of objects */
+typedef struct ObjListRec_ {
+	ObjF	*objs;
+	int		n;
+	int		avail;
+} ObjListRec, *ObjList;
+
+static void
+objListAdd(ObjF f, int depth, void *closure)
+{
+ObjList l = closure;
+	l->objs = stackReserve(l->objs, &l->avail, l->n + 1, sizeof(*l->objs));
+	l->objs[l->n++] = f;
+}
+
+#define BITS_PER_LONG	(8*sizeof(unsigned long))
+
+/* RETURNS: index of the first bit set at or after 'i' or -1 if there is none */
+static int
+bitmapNext(unsigned long *map, int nbits, int i)
+{
+unsigned long w;
+	while ( i < nbits ) {
+		if ( ! (w = map[i/BITS_PER_LONG] >> (i % BITS_PER_LONG)) ) {
+			/* skip to the next word */
+			i = (i/BITS_PER_LONG + 1) * BITS_PER_LONG;
+			continue;
+		}
+		while ( ! (w & 1) ) {
+			w >>= 1;
+			i++;
+		}
+		return i < nbits ? i : -1;
+	}
+	return -1;
+}
+
+/* re-evaluate objHasRedef() for 'f' and record the result */
+static void
+multdefUpdate(ObjF f, unsigned long *colliding, Xref *collision)
+{
+Xref coll = f->link.anchor ? objHasRedef( f ) : 0;
+
+	collision[f->seq] = coll;
+	if ( coll )
+		colliding[f->seq/BITS_PER_LONG] |=  (1UL << (f->seq % BITS_PER_LONG));
+	else
+		colliding[f->seq/BITS_PER_LONG] &= ~(1UL << (f->seq % BITS_PER_LONG));
+}
+
+/*
+ * Unlink all objects with definitions colliding with definitions
+ * by other objects (see objHasRedef()).
+ *
+ * Objects are processed in the order of the file list and after every
+ * successful unlink we start over at the head of the list (rejected
+ * objects are thus reported again). Rather than re-evaluating every
+ * object, the colliding ones are kept in a bitmap; unlinking an object
+ * can only affect objects in the same library which define a symbol
+ * the removed object also defines - only these are re-checked.
+ */
+int
+unlinkMultdefs()
+{
+ObjF			f, g, u;
+Xref			coll, ex, r;
+ObjF			*bySeq;
+Xref			*collision;
+ObjF			*rejectedBy;
+unsigned long	*colliding;
+ObjListRec		removed = { 0 };
+int				seq, k, i;
+
+	assert( bySeq      = calloc(numFiles, sizeof(*bySeq)) );
+	assert( collision  = calloc(numFiles, sizeof(*collision)) );
+	assert( rejectedBy = calloc(numFiles, sizeof(*rejectedBy)) );
+	assert( colliding  = calloc((numFiles + BITS_PER_LONG - 1)/BITS_PER_LONG, sizeof(*colliding)) );
+
+	for ( f = fileListFirst() ; f; f = f->next ) {
+		bySeq[f->seq] = f;
+		multdefUpdate(f, colliding, collision);
+	}
+
+	for ( seq = 0; (seq = bitmapNext(colliding, numFiles, seq)) >= 0; ) {
+		f    = bySeq[seq];
+		coll = collision[seq];
+		fprintf(logf,"%s defines symbol(s) colliding with other (strong) definitions by other objects in same library; unlinking...\n", f->name);
+		fprintf(logf,"Colliding symbol was %s (from %s)\n", coll->sym->name, coll->obj->name);
+
+		/* rejection never changes (unlinking an object the application
+		 * doesn't need can't make another one needed) but if we log
+		 * then unlinkObj() must reproduce its messages.
+		 */
+		if ( ! rejectedBy[seq] || LOGGING(DEBUG_UNLINK | DEBUG_TRACE) ) {
+			removed.n = 0;
+			rejectedBy[seq] = unlinkObjNotify( f, 0, objListAdd, &removed );
+		}
+
+		if ( rejectedBy[seq] ) {
+			fprintf(logf, "Unlinking rejected because %s could not be removed\n", rejectedBy[seq]->name );
+			seq++;
+			continue;
+		}
+
+		for ( k=0; k<removed.n; k++ )
+			multdefUpdate(removed.objs[k], colliding, collision);
+
+		for ( k=0; k<removed.n; k++ ) {
+			u = removed.objs[k];
+			if ( ! u->lib )
+				continue;
+			for ( i=0, ex=u->exports; i<u->nexports; i++, ex++ ) {
+				for ( r = ex->sym->exportedBy; r; r = XREF_NEXT(r) ) {
+					g = r->obj;
+					if ( g != u && g->lib == u->lib && g->link.anchor )
+						multdefUpdate(g, colliding, collision);
+				}
+			}
+		}
+
+		/* file list may have changed; must start from head again */
+		seq = 0;
+	}
+
+	free(removed.objs);
+	free(colliding);
+	free(rejectedBy);
+	free(collision);
+	free(bySeq);
+	return 0;
+}
+
+#define BUSY 		((Xref)depwalk) /* just some address */
+#define MATCH_ANY	((Lib)depwalk)	/* just some address */
+
+#define DO_EXPORTS(c) ((c)->mode & WALK_EXPORTS)
+
+/* make sure the arrays of a context cover all objects */
+static void
+depwalkCtxReserve(DepWalkCtx c)
+{
+	if ( c->size < numFiles ) {
+		assert( c->mark  = realloc(c->mark,  numFiles * sizeof(*c->mark))  );
+		assert( c->work  = realloc(c->work,  numFiles * sizeof(*c->work))  );
+		assert( c->depth = realloc(c->depth, numFiles * sizeof(*c->depth)) );
+		memset(c->mark  + c->size, 0, (numFiles - c->size) * sizeof(*c->mark));
+		memset(c->work  + c->size, 0, (numFiles - c->size) * sizeof(*c->work));
+		memset(c->depth + c->size, 0, (numFiles - c->size) * sizeof(*c->depth));
+		c->size = numFiles;
+	}
+}
+
+static void
+depwalkCtxFree(DepWalkCtx c)
+{
+	free(c->mark);
+	free(c->work);
+	free(c->depth);
+	free(c->stack);
+	memset(c, 0, sizeof(*c));
+}
+
+/* add the counters of a context to the statistics */
+static void
+depwalkCtxStats(DepWalkCtx c)
+{
+	stats.walkNodes += c->nodes;
+	stats.walkEdges += c->edges;
+	c->nodes = c->edges = 0;
+}
+
+/* mark 'ref->obj' as in use (reached from 'f') */
+static INLINE void
+workMark(DepWalkCtx c, ObjF f, Xref ref, int depth)
+{
+int s = ref->obj->seq;
+
+/*	fprintf(debugf,"Linking %s after %s\n", ref->obj->name, f->name);    */
+	/* an object not visited by this walk must not be on any work list */
+	assert( 0 == c->work[s] );
+	c->work[s]      = c->work[f->seq];
+	c->depth[s]     = depth + 1;
+	c->work[f->seq] = ref;
+	c->mark[s]      = c->gen;
+	if ( paranoid )
+		assert( 0 == checkCircWorkList(c, f) );
+}
+
+/* undo workMark() (when not building a list) */
+static INLINE void
+workUnmark(DepWalkCtx c, ObjF f, Xref ref)
+{
+int s = ref->obj->seq;
+
+	c->mark[s]      = 0;
+	c->work[f->seq] = c->work[s];
+	c->work[s]      = 0;
+	c->depth[s]     = 0;
+}
+
+/*
+ * Walk the 'exports' or 'imports' list of an object depth-first
+ * (private helper routine). The traversal uses an explicit stack
+ * on the heap; nodes are visited in the same order a recursive
+ * implementation would visit them.
+ */
+static void
+depwalk_rec(DepWalkCtx c, ObjF f, int depth)
+{
+int					sp;
+register DepWalkFrame fr;
+register Xref		ref;
+
+	if (c->action)
+		c->action(f,depth,c->closure);
+
+	c->stack  = stackReserve(c->stack, &c->avail, 1, sizeof(*c->stack));
+	fr        = &c->stack[0];
+	fr->f     = f;
+	fr->depth = depth;
+	fr->i     = -1;
+	fr->ref   = 0;
+	fr->child = 0;
+	sp        = 1;
+
+	while ( sp > 0 ) {
+		fr    = &c->stack[sp-1];
+		f     = fr->f;
+		depth = fr->depth;
+
+		if ( (ref = fr->child) ) {
+			/* returned from a descent */
+			fr->child = 0;
+			if ( ! (c->mode & WALK_BUILD_LIST) )
+				workUnmark(c, f, ref);
+			fr->ref = DO_EXPORTS(c) ? XREF_NEXT(ref) : 0 /* use only the first definition */;
+		}
+
+		/* imports: only the first definition (strongest export) counts */
+		while ( ! DO_EXPORTS(c) ) {
+			if ( ++fr->i >= f->nimports )
+				break;
+			ref = strongestExport(f->imports[fr->i].sym);
+			c->edges++;
+			/* undefined or a weak undef (on import + export list); ignore */
+			if ( ! ref || ref->obj == f ) {
+				assert( ! ref || ISWEAKUNDEF(TYPE(ref)) );
+				continue;
+			}
+			if ( c->mark[ref->obj->seq] != c->gen ) {
+				/* mark in use and descend */
+				workMark(c, f, ref, depth);
+				fr->child = ref;
+				break;
+			} /* else break circular dependency */
+		}
+
+		/* exports: all (current) importers */
+		while ( DO_EXPORTS(c) ) {
+			if ( ! (ref = fr->ref) ) {
+				if ( ++fr->i >= f->nexports )
+					break;
+				if ( strongestExport( f->exports[fr->i].sym )->obj != f ) {
+					/* Another module already exports this */
+					continue;
+				}
+				fr->ref = f->exports[fr->i].sym->importedFrom;
+				continue;
+			}
+
+			c->edges++;
+			/* weak undefs are on import + export list; ignore */
+			if ( ref->obj == f && ISWEAKUNDEF(TYPE(ref)) ) {
+				fr->ref = XREF_NEXT(ref);
+				continue;
+			}
+
+			assert( ref->obj != f );
+
+			if ( c->mark[ref->obj->seq] != c->gen ) {
+				/* mark in use and descend */
+				workMark(c, f, ref, depth);
+				fr->child = ref;
+				break;
+			} /* else break circular dependency */
+
+			fr->ref = XREF_NEXT(ref);
+		}
+
+		if ( (ref = fr->child) ) {
+			c->nodes++;
+			if (c->action)
+				c->action(ref->obj,depth+1,c->closure);
+			c->stack  = stackReserve(c->stack, &c->avail, sp + 1, sizeof(*c->stack));
+			fr        = &c->stack[sp++];
+			fr->f     = ref->obj;
+			fr->depth = depth + 1;
+			fr->i     = -1;
+			fr->ref   = 0;
+			fr->child = 0;
+		} else {
+			/* done with 'f' */
+			sp--;
+		}
+	}
+}
+
+/*
+ * Recursively walk the 'exports' or 'imports' list of an object
+ * and invoke a user defined action on every visited node.
+ *
+ * 'mode' flags define whether to walk the 'export' or 'import' list.
+ *
+ * Another flag 'WALK_BUILD_LIST' instructs the routine to
+ * build a linked list of all objects referenced (directly or indirectly)
+ * by the export or import list. No action is invoked in this mode.
+ * The list must be released by calling depwalkListRelease() which will
+ * also cause the action to be invoked for every node on the list.
+ *
+ * All state is kept in the context 'c' (the main thread uses
+ * 'depwalkMain').
+ */
+void
+depwalk(DepWalkCtx c, ObjF f, DepWalkAction action, void *closure, int mode)
+{
+	depwalkCtxReserve(c);
+
+	assert( 0 == c->work[f->seq] );
+
+	assert( !(c->mode & WALK_BUILD_LIST) );
+
+	c->mode    = mode;
+	c->action  = (c->mode & WALK_BUILD_LIST) ? 0 : action;
+	c->closure = closure;
+
+	if ( 0 == ++c->gen ) {
+		/* wrapped around; forget all stale generations */
+		memset(c->mark, 0, c->size * sizeof(*c->mark));
+		c->gen = 1;
+	}
+
+	c->work[f->seq]  = BUSY;
+	c->depth[f->seq] = 0;
+	c->mark[f->seq]  = c->gen;
+	c->nodes++;
+	depwalk_rec(c, f, 0);
+
+	if (c->mode & WALK_BUILD_LIST) {
+		c->action = action;
+	} else {
+		c->work[f->seq] = 0;
+	}
+
+	if ( c == &depwalkMain )
+		depwalkCtxStats(c);
+}
+
+/* Clear 'f's work list */
+static void
+workListRelease(DepWalkCtx c, ObjF f)
+{
+Xref tmp;
+
+	tmp = c->work[f->seq];
+	c->work[f->seq]  = 0;
+	c->depth[f->seq] = 0;
+	while ( tmp != BUSY ) {
+		f = tmp->obj;
+		tmp = c->work[f->seq];
+		c->work[f->seq]  = 0;
+		c->depth[f->seq] = 0;
+	}
+}
+
+/* Invoke an action for every node on the work list */
+void
+workListIterate(DepWalkCtx c, ObjF f, DepWalkAction action, void *closure)
+{
+	action(f, c->depth[f->seq], closure);
+	while ( BUSY != c->work[f->seq] ) {
+		f = c->work[f->seq]->obj;
+		action(f, c->depth[f->seq], closure);
+	}
+}
+
+void
+workListIterateRef(DepWalkCtx c, ObjF f, DepWalkActionRef action, void *closure)
+{
+XrefRec r = {0};
+r.obj = f;
+	action(&r, c->depth[f->seq], closure);
+	while ( BUSY != c->work[f->seq] ) {
+		action(c->work[f->seq], c->depth[f->seq], closure);
+		f = c->work[f->seq]->obj;
+	}
+}
+
+/* Release the work list of an object and invoke the action
+ * passed to 'depwalk()' 
+ */
+void
+depwalkListRelease(DepWalkCtx c, ObjF f)
+{
+	assert( (c->mode & WALK_BUILD_LIST) );
+	if (c->action)
+		workListIterate(c, f, c->action, c->closure);
+	workListRelease(c, f);
+	c->mode = 0;
+}
+
+/*
+ * Multi-source walks (batch unlink engine).
+ *
+ * Instead of running one depwalk() per root, all roots are added to a
+ * 'walk set' which is then closed under the export edges (objects that
+ * depend on members) or import edges (objects members depend on) in
+ * a single breadth-first pass. Membership is recorded in arrays indexed
+ * by ObjFRec.seq (stamped with the generation of the walk set); every
+ * member records the edge it was reached along.
+ */
+
+/* member of a walk set */
+typedef struct WalkNodeRec_ {
+	ObjF	obj;
+	Xref	via;		/* edge we got here along (NULL for roots) */
+	int		from;		/* index of the node we got here from (-1 for roots) */
+} WalkNodeRec, *WalkNode;
+
+/* must be zero-initialized before the first walkSetInit() */
+typedef struct WalkSetRec_ {
+	WalkNode	nodes;
+	int			n;
+	int			avail;
+	unsigned	gen;	/* members have mark[seq] == gen */
+	unsigned	*mark;
+	int			*idx;	/* position of a member in 'nodes' (by seq) */
+	int			size;	/* number of elements of 'mark' and 'idx' */
+} WalkSetRec, *WalkSet;
+
+static void
+walkSetInit(WalkSet s)
+{
+	if ( s->size < numFiles ) {
+		assert( s->mark = realloc(s->mark, numFiles * sizeof(*s->mark)) );
+		assert( s->idx  = realloc(s->idx,  numFiles * sizeof(*s->idx))  );
+		memset(s->mark + s->size, 0, (numFiles - s->size) * sizeof(*s->mark));
+		s->size = numFiles;
+	}
+	s->n   = 0;
+	if ( 0 == ++s->gen ) {
+		memset(s->mark, 0, s->size * sizeof(*s->mark));
+		s->gen = 1;
+	}
+}
+
+static void
+walkSetFree(WalkSet s)
+{
+	free(s->nodes);
+	free(s->mark);
+	free(s->idx);
+	memset(s, 0, sizeof(*s));
+}
+
+static INLINE int
+walkSetHas(WalkSet s, ObjF f)
+{
+	return s->mark[f->seq] == s->gen;
+}
+
+static void
+walkSetAdd(WalkSet s, ObjF f, Xref via, int from)
+{
+WalkNode nd;
+
+	if ( walkSetHas(s, f) )
+		return;
+
+	s->nodes = stackReserve(s->nodes, &s->avail, s->n + 1, sizeof(*s->nodes));
+	s->mark[f->seq] = s->gen;
+	s->idx[f->seq]  = s->n;
+	nd          = &s->nodes[s->n++];
+	nd->obj     = f;
+	nd->via     = via;
+	nd->from    = from;
+}
+
+/*
+ * Close a walk set under export edges (WALK_EXPORTS) or import edges
+ * (WALK_IMPORTS); the edges are the ones depwalk_rec() follows.
+ * Nodes with index < 'start' are assumed to be expanded already, so
+ * a set can be grown incrementally by adding roots and closing again.
+ */
+static void
+walkSetClose(WalkSet s, int start, int mode)
+{
+int		k, i;
+ObjF	f;
+Xref	ref;
+
+	for ( k = start; k < s->n; k++ ) {
+		f = s->nodes[k].obj;
+		if ( mode & WALK_EXPORTS ) {
+			for ( i=0; i<f->nexports; i++ ) {
+				if ( strongestExport( f->exports[i].sym )->obj != f )
+					continue;
+				for ( ref = f->exports[i].sym->importedFrom; ref; ref = XREF_NEXT(ref) ) {
+					/* weak undefs are on import + export list; ignore */
+					if ( ref->obj == f && ISWEAKUNDEF(TYPE(ref)) )
+						continue;
+					assert( ref->obj != f );
+					walkSetAdd(s, ref->obj, ref, k);
+				}
+			}
+		} else {
+			for ( i=0; i<f->nimports; i++ ) {
+				ref = strongestExport( f->imports[i].sym );
+				if ( ref->obj == f && ISWEAKUNDEF(TYPE(ref)) )
+					continue;
+				assert( ref->obj != f );
+				walkSetAdd(s, ref->obj, &f->imports[i], k);
+			}
+		}
+	}
+}
+
+/*
+ * Compute the set of all objects the application link set depends
+ * on (directly or indirectly). Removing any of them (or anything
+ * they export to) would be rejected by unlinkObj().
+ */
+static void
+appClosure(WalkSet s)
+{
+ObjF f;
+	walkSetInit(s);
+	for ( f = appLinkSet.set; f; f = f->link.next )
+		walkSetAdd(s, f, 0, -1);
+	walkSetClose(s, 0, WALK_IMPORTS);
+}
+
+/* Log why 'f' (a member of the application closure 's') can't be removed */
+static void
+logAppDependency(FILE *feil, WalkSet s, ObjF f)
+{
+int k = s->idx[f->seq];
+
+	fprintf(feil," -- needed by application:\n    ");
+	printObjName(feil, f);
+	fputc('\n', feil);
+	for ( ; s->nodes[k].from >= 0; k = s->nodes[k].from ) {
+		fprintf(feil,"    <- ");
+		printObjName(feil, s->nodes[s->nodes[k].from].obj);
+		fprintf(feil," (because of '%s')\n", s->nodes[k].via->sym->name);
+	}
+}
+
+/* RETURNS the application member at the end of the chain logAppDependency() prints for 'f' */
+static ObjF
+walkSetRoot(WalkSet s, ObjF f)
+{
+int k = s->idx[f->seq];
+
+	while ( s->nodes[k].from >= 0 )
+		k = s->nodes[k].from;
+	return s->nodes[k].obj;
+}
+
+/* Remove all members of a walk set from their link sets */
+static void
+walkSetUnlink(WalkSet s)
+{
+int k;
+	for ( k=0; k<s->n; k++ ) {
+		assert( s->nodes[k].obj->link.anchor && s->nodes[k].obj->link.anchor != &appLinkSet );
+		doUnlink(s->nodes[k].obj, 0, 0);
+	}
+	for ( k=0; k<s->n; k++ )
+		checkSanity(s->nodes[k].obj, 0, 0);
+}
+
+/*
+ * Batch version of unlinkUndefs(): a symbol is skipped if any
+ * of its importers is needed by the application (probably a
+ * linker script / startfile symbol); all objects depending on
+ * the remaining strong undefined symbols are removed at once.
+ *
+ * The result is identical to unlinkUndefs(): removing an object
+ * which is not needed by the application never changes whether
+ * another object is.
+ */
+int
+unlinkUndefsBatch()
+{
+WalkSetRec	app  = { 0 };
+WalkSetRec	rem  = { 0 };
+int			i, nrej = 0;
+Xref		ex, p;
+ObjF		q = &undefSymPod;
+
+	appClosure(&app);
+
+	walkSetInit(&rem);
+	for (i=0, ex=q->exports; i<q->nexports; i++,ex++) {
+		/* Ignore weak undefs */
+		if ( ISWEAKUNDEF(TYPE(ex)) ) {
+			if ( LOGGING(DEBUG_TRACE) )
+				traceEvent(TR_WEAK, 0, 0, ex->sym->name, 0);
+			if ( LOGGING(DEBUG_UNLINK) ) {
+				fprintf(logf,"skipping weak undef symbol '%s'...\n", ex->sym->name);
+			}
+			continue;
+		}
+		for ( p = ex->sym->importedFrom; p; p=XREF_NEXT(p) ) {
+			if ( walkSetHas(&app, p->obj) )
+				break;
+		}
+		if ( p ) {
+			nrej++;
+			if ( LOGGING(DEBUG_TRACE) )
+				traceEvent(TR_UNDEF_SKIP, 0, 0, ex->sym->name, p->obj);
+			if ( LOGGING(DEBUG_UNLINK) ) {
+				fprintf(logf,"not removing objects depending on '%s' (probably a linker script / startfile symbol)", ex->sym->name);
+				logAppDependency(logf, &app, p->obj);
+			}
+			continue;
+		}
+		if ( LOGGING(DEBUG_TRACE) )
+			traceEvent(TR_UNDEF, 0, 0, ex->sym->name, 0);
+		if ( LOGGING(DEBUG_UNLINK) )
+			fprintf(logf,"removing objects depending on '%s'\n", ex->sym->name);
+		for ( p = ex->sym->importedFrom; p; p=XREF_NEXT(p) )
+			walkSetAdd(&rem, p->obj, 0, -1);
+	}
+
+	walkSetClose(&rem, 0, WALK_EXPORTS);
+	walkSetUnlink(&rem);
+
+	if ( LOGGING(DEBUG_UNLINK) )
+		fprintf(logf,"done (%i objects removed, %i undefined symbols skipped).\n", rem.n, nrej);
+
+	walkSetFree(&rem);
+	walkSetFree(&app);
+	return 0;
+}
+
+/*
+ * Incremental relink ('-I' with '-c'). The outcome of removing the
+ * objects depending on undefined symbols is saved in '<db_file>.state'
+ * and reused by the next run if the changes of the application leave
+ * it intact, i.e., if
+ *
+ *  - the library database is the same (checksum of the cache),
+ *  - the application resolves the same library symbols (so the
+ *    dependencies among library objects are the same),
+ *  - the objects the '-x' lists removed are removed again,
+ *  - every undefined symbol which removed objects still does (none
+ *    of its importers is needed by the application now) and
+ *  - the application needs none of the objects removed then.
+ *
+ * The objects removed by the previous run are then unlinked without
+ * walking their dependents again; only the dependents of newly
+ * undefined symbols and application objects importing from removed
+ * objects (or undefined symbols) are walked. The result is the same
+ * as unlinkUndefs()'s. Only a single configuration without '-o' lists
+ * qualifies (every object is linked when the lists are processed).
+ */
+#define RELINK_MAGIC	0x6c64726c	/* 'ldrl' */
+#define RELINK_VERSION	1
+
+/* what removed a library object */
+#define RELINK_KEPT		0
+#define RELINK_LISTS	1	/* the '-x' lists */
+#define RELINK_UNDEFS	2	/* undefined symbols */
+
+typedef struct RelinkHdrRec_ {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	libSum;		/* dbcLibSum */
+	uint32_t	nobjs;		/* library objects; one RELINK_xxx byte each follows */
+	uint32_t	nundefs;	/* number of names of undefined symbols which removed objects */
+	uint32_t	nresolved;	/* followed by the library symbols resolved by the application */
+	uint32_t	strSize;	/* size of the (NUL-terminated) names */
+	uint32_t	sum;		/* dbcSum() of the payload */
+} RelinkHdrRec, *RelinkHdr;
+
+typedef struct RelinkRec_ {
+	char			*name;		/* state file; 0 if not relinking incrementally */
+	ObjF			lastApp;	/* the library objects follow */
+	unsigned char	*linked;	/* (by seq) linked before removing undefined symbols */
+	Sym				*undefs;	/* undefined symbols which remove objects */
+	int				nundefs;
+	Sym				*resolved;	/* library symbols resolved by the application */
+	int				nresolved;
+} RelinkRec, *Relink;
+
+#define RELINK_LIB(r, f)	((f)->seq > (r)->lastApp->seq)
+
+/* RETURNS nonzero if undefined 's' removes its importers (see unlinkUndefsBatch()) */
+static int
+relinkRemoves(Sym s, WalkSet app)
+{
+Xref ex = strongestExport(s), p;
+
+	if ( !ex || ex->obj != &undefSymPod || ISWEAKUNDEF(TYPE(ex)) )
+		return 0;
+	for ( p = s->importedFrom; p; p = XREF_NEXT(p) ) {
+		if ( walkSetHas(app, p->obj) )
+			return 0;
+	}
+	return 1;
+}
+
+/* RETURNS nonzero if library symbol 's' is resolved by the application */
+static int
+relinkResolved(Relink r, Sym s)
+{
+Xref ex;
+	return    (s->flags & SYM_FLG_LIBDB)
+	       && (ex = strongestExport(s))
+	       && ex->obj != &undefSymPod
+	       && !RELINK_LIB(r, ex->obj);
+}
+
+/* record the current state (before removing undefined symbols) */
+static void
+relinkCurrent(Relink r, WalkSet app)
+{
+int			i, avail;
+unsigned	k;
+ObjF		f;
+Xref		ex;
+Sym			s;
+
+	assert( r->linked = calloc(numFiles, 1) );
+	for ( f = fileListFirst(); f; f = f->next )
+		r->linked[f->seq] = !!f->link.anchor;
+
+	for ( avail = 0, i = 0, ex = undefSymPod.exports; i < undefSymPod.nexports; i++, ex++ ) {
+		if ( relinkRemoves(ex->sym, app) ) {
+			r->undefs = stackReserve(r->undefs, &avail, r->nundefs + 1, sizeof(*r->undefs));
+			r->undefs[r->nundefs++] = ex->sym;
+		}
+	}
+
+	for ( avail = 0, k = 0; k < symTbl.size; k++ ) {
+		if ( (s = symTbl.slots[k].sym) && relinkResolved(r, s) ) {
+			r->resolved = stackReserve(r->resolved, &avail, r->nresolved + 1, sizeof(*r->resolved));
+			r->resolved[r->nresolved++] = s;
+		}
+	}
+}
+
+/*
+ * Load the previous run's state and check that it can be reused; the
+ * undefined symbols which removed objects are tagged SYM_FLG_MARK and
+ * '*premoved' is set to what removed each library object.
+ *
+ * RETURNS: 0 if the state can be reused, otherwise why not ("" if
+ *          there is no state).
+ */
+static const char *
+relinkLoad(Relink r, WalkSet app, unsigned char **premoved)
+{
+FILE			*feil;
+struct stat		st;
+RelinkHdrRec	hdr;
+char			*buf, *strs, *p;
+unsigned char	*removed;
+const char		*why = "the state doesn't match the library database";
+uint32_t		i, n, nobjs = numFiles - r->lastApp->seq - 1;
+ObjF			f;
+Sym				s;
+
+	*premoved = 0;
+
+	if ( !(feil = fopen(r->name, "r")) )
+		return "";
+
+	if (   fstat(fileno(feil), &st)
+		|| 1 != fread(&hdr, sizeof(hdr), 1, feil)
+		|| RELINK_MAGIC != hdr.magic || RELINK_VERSION != hdr.version
+		|| !dbcLibValid || dbcLibSum != hdr.libSum || nobjs != hdr.nobjs
+		|| (uint64_t)st.st_size != sizeof(hdr) + (uint64_t)hdr.nobjs + hdr.strSize ) {
+		fclose(feil);
+		return why;
+	}
+
+	/* library objects first, then the names */
+	assert( buf = malloc(hdr.nobjs + hdr.strSize + 1) );
+	n = hdr.nobjs + hdr.strSize;
+	if (   (n && 1 != fread(buf, n, 1, feil))
+		|| dbcSum(DBC_SUM_INIT, buf, n) != hdr.sum
+		|| (hdr.strSize && buf[n - 1]) ) {
+		fclose(feil);
+		free(buf);
+		return why;
+	}
+	fclose(feil);
+
+	removed = (unsigned char*)buf;
+	strs    = buf + hdr.nobjs;
+	for ( i = 0, f = r->lastApp->next; f; f = f->next, i++ ) {
+		switch ( removed[i] ) {
+			case RELINK_KEPT:
+			break;
+			case RELINK_LISTS:
+				if ( r->linked[f->seq] ) {
+					why = "the '-x' lists keep an object they removed then";
+					goto bail;
+				}
+			break;
+			case RELINK_UNDEFS:
+				if ( walkSetHas(app, f) ) {
+					why = "the application needs an object removed then";
+					goto bail;
+				}
+			break;
+			default:
+			goto bail;
+		}
+	}
+
+	for ( n = 0, p = strs; p < strs + hdr.strSize; p += strlen(p) + 1, n++ ) {
+		s = symTblFind(&symTbl, p);
+		if ( n < hdr.nundefs ) {
+			if ( !s || !relinkRemoves(s, app) ) {
+				why = "a symbol which removed objects then doesn't now";
+				goto bail;
+			}
+			s->flags |= SYM_FLG_MARK;
+		} else if ( !s || !relinkResolved(r, s) ) {
+			why = "the application resolves other library symbols";
+			goto bail;
+		}
+	}
+	if ( n != hdr.nundefs + hdr.nresolved )
+		goto bail;
+	if ( hdr.nresolved != r->nresolved ) {
+		why = "the application resolves other library symbols";
+		goto bail;
+	}
+
+	/* 'removed' is (the start of) 'buf' */
+	*premoved = removed;
+	return 0;
+
+bail:
+	free(buf);
+	return why;
+}
+
+/* clear the SYM_FLG_MARK relinkLoad() has set */
+static void
+relinkUnmark(Relink r)
+{
+int i;
+	for ( i = 0; i < r->nundefs; i++ )
+		r->undefs[i]->flags &= ~SYM_FLG_MARK;
+}
+
+/*
+ * Remove the objects depending on undefined symbols, reusing the
+ * previous run's removals if possible (see above). The current state
+ * is recorded for relinkSave() in any case.
+ *
+ * RETURNS: 0 if done, nonzero if the caller must remove the objects
+ *          (unlinkUndefs()).
+ */
+static int
+relinkUndefs(Relink r)
+{
+WalkSetRec		app = { 0 };
+WalkSetRec		rem = { 0 };
+unsigned char	*removed;
+const char		*why;
+int				i, nold, nnew = 0;
+ObjF			f;
+Xref			ex, p;
+Sym				s;
+
+	appClosure(&app);
+	relinkCurrent(r, &app);
+
+	if ( (why = relinkLoad(r, &app, &removed)) ) {
+		relinkUnmark(r);
+		if ( *why )
+			fprintf(logf,"Incremental relink: previous state not reused (%s)\n", why);
+		walkSetFree(&app);
+		return -1;
+	}
+
+	/* the objects removed then; all their dependents were removed too */
+	walkSetInit(&rem);
+	for ( i = 0, f = r->lastApp->next; f; f = f->next, i++ ) {
+		if ( RELINK_UNDEFS == removed[i] && f->link.anchor )
+			walkSetAdd(&rem, f, 0, -1);
+	}
+	nold = rem.n;
+
+	/* ... except for application objects (not needed by the application) */
+	for ( f = fileListFirst(); f && !RELINK_LIB(r, f); f = f->next ) {
+		if ( !f->link.anchor || walkSetHas(&app, f) )
+			continue;
+		for ( i = 0; i < f->nimports; i++ ) {
+			ex = strongestExport(f->imports[i].sym);
+			if ( ex->obj == f )
+				continue;
+			if ( walkSetHas(&rem, ex->obj) || (ex->obj == &undefSymPod && (ex->sym->flags & SYM_FLG_MARK)) ) {
+				walkSetAdd(&rem, f, 0, -1);
+				break;
+			}
+		}
+	}
+
+	/* and the importers of newly undefined symbols */
+	for ( i = 0; i < r->nundefs; i++ ) {
+		if ( (s = r->undefs[i])->flags & SYM_FLG_MARK )
+			continue;
+		nnew++;
+		if ( LOGGING(DEBUG_TRACE) )
+			traceEvent(TR_UNDEF, 0, 0, s->name, 0);
+		if ( LOGGING(DEBUG_UNLINK) )
+			fprintf(logf,"removing objects depending on '%s'\n", s->name);
+		for ( p = s->importedFrom; p; p = XREF_NEXT(p) )
+			walkSetAdd(&rem, p->obj, 0, -1);
+	}
+	relinkUnmark(r);
+
+	walkSetClose(&rem, nold, WALK_EXPORTS);
+	walkSetUnlink(&rem);
+
+	fprintf(logf,"Incremental relink: previous state reused (%i objects removed again, %i more for %i newly undefined symbols)\n",
+		nold, rem.n - nold, nnew);
+
+	free(removed);
+	walkSetFree(&rem);
+	walkSetFree(&app);
+	return 0;
+}
+
+/*
+ * Save the state after removing the undefined symbols and release the
+ * recorded one. RETURNS 0 on success.
+ */
+static int
+relinkSave(Relink r)
+{
+RelinkHdrRec	hdr;
+char			*tmpn;
+FILE			*feil = 0;
+unsigned char	what;
+int				i, rval = -1;
+ObjF			f;
+Sym				s;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic     = RELINK_MAGIC;
+	hdr.version   = RELINK_VERSION;
+	hdr.libSum    = dbcLibSum;
+	hdr.nobjs     = numFiles - r->lastApp->seq - 1;
+	hdr.nundefs   = r->nundefs;
+	hdr.nresolved = r->nresolved;
+	hdr.sum       = DBC_SUM_INIT;
+
+	assert( tmpn = malloc(strlen(r->name) + 20) );
+	sprintf(tmpn, "%s.tmp%u", r->name, (unsigned)getpid());
+
+	/* only library objects are identified across runs */
+	for ( f = fileListFirst(); f && !RELINK_LIB(r, f); f = f->next ) {
+		if ( !r->linked[f->seq] || !f->link.anchor )
+			goto drop;
+	}
+
+	if ( !(feil = fopen(tmpn, "w")) || 1 != fwrite(&hdr, sizeof(hdr), 1, feil) )
+		goto bail;
+
+	for ( ; f; f = f->next ) {
+		if ( !r->linked[f->seq] )
+			what = RELINK_LISTS;
+		else
+			what = f->link.anchor ? RELINK_KEPT : RELINK_UNDEFS;
+		if ( EOF == fputc(what, feil) )
+			goto bail;
+		hdr.sum = dbcSum(hdr.sum, &what, 1);
+	}
+	for ( i = 0; i < r->nundefs + r->nresolved; i++ ) {
+		s = i < r->nundefs ? r->undefs[i] : r->resolved[i - r->nundefs];
+		if ( 1 != fwrite(s->name, s->len + 1, 1, feil) )
+			goto bail;
+		hdr.sum      = dbcSum(hdr.sum, s->name, s->len + 1);
+		hdr.strSize += s->len + 1;
+	}
+
+	if ( fseek(feil, 0, SEEK_SET) || 1 != fwrite(&hdr, sizeof(hdr), 1, feil) )
+		goto bail;
+	i    = fclose(feil);
+	feil = 0;
+	if ( i || rename(tmpn, r->name) )
+		goto bail;
+
+	rval = 0;
+	goto cleanup;
+
+bail:
+	fprintf(stderr,"Writing incremental state '%s' failed: %s\n", r->name, strerror(errno));
+	if ( feil )
+		fclose(feil);
+	unlink(tmpn);
+drop:
+	/* a stale state must not be reused */
+	unlink(r->name);
+cleanup:
+	free(tmpn);
+	free(r->linked);
+	free(r->undefs);
+	free(r->resolved);
+	r->linked   = 0;
+	r->undefs   = 0;
+	r->resolved = 0;
+	r->nundefs  = r->nresolved = 0;
+	return rval;
+}
+
+/*
+ * Compact all-pairs dependency report ('-D').
+ *
+ * The objects requiring 'f' are the objects a depwalk(c, f, ..., WALK_EXPORTS)
+ * visits. Instead of walking from every object we collapse the strongly
+ * connected components (Tarjan) of that graph and propagate reachability
+ * over the resulting DAG once, keeping a bitset (indexed by component)
+ * per component. Components of equal height in the DAG don't depend on
+ * each other and are processed by up to 'nThreads' threads ('-j').
+ */
+typedef struct DepGraphRec_ {
+	int				n;		/* nodes; indexed by ObjFRec.seq (0 is the undefSymPod) */
+	int				*first;	/* successors of node v: succ[first[v]] .. succ[first[v+1]-1] */
+	int				*succ;
+	int				*comp;	/* component of each node */
+	int				ncomp;	/* components are numbered in file list order */
+	int				*mfirst;/* members of component c: memb[mfirst[c]] .. memb[mfirst[c+1]-1] */
+	int				*memb;
+	int				*cfirst;/* successors of component c in the DAG */
+	int				*csucc;
+	int				*torder;/* components in the order Tarjan found them (successors first) */
+	int				nw;		/* words per bitset */
+	unsigned long	*reach;	/* components requiring c (including c): reach + c*nw */
+} DepGraphRec, *DepGraph;
+
+#define DEP_REACH(g, c)	((g)->reach + (size_t)(c) * (g)->nw)
+
+/* minimal number of components on a level for using threads */
+#define DEP_MT_MIN		64
+
+/* store the objects importing from 'f' in 'succ' (if nonzero); RETURNS their number */
+static int
+depGraphEdges(ObjF f, int *succ)
+{
+int		i, n = 0;
+Xref	ref;
+	for ( i=0; i<f->nexports; i++ ) {
+		if ( strongestExport( f->exports[i].sym )->obj != f )
+			continue;
+		for ( ref = f->exports[i].sym->importedFrom; ref; ref = XREF_NEXT(ref) ) {
+			/* weak undefs are on import + export list; ignore */
+			if ( ref->obj == f && ISWEAKUNDEF(TYPE(ref)) )
+				continue;
+			assert( ref->obj != f );
+			if ( succ )
+				succ[n] = ref->obj->seq;
+			n++;
+		}
+	}
+	return n;
+}
+
+/* Tarjan's algorithm (iterative); RETURNS components numbered in the order found */
+static int
+depGraphTarjan(DepGraph g)
+{
+int	*idx, *low, *edge, *stk, *call;
+int	sp = 0, csp = 0, cnt = 0, ncomp = 0;
+int	r, v, w;
+
+	assert( idx  = malloc(g->n * sizeof(*idx)) );
+	assert( low  = malloc(g->n * sizeof(*low)) );
+	assert( edge = malloc(g->n * sizeof(*edge)) );
+	assert( stk  = malloc(g->n * sizeof(*stk)) );
+	assert( call = malloc(g->n * sizeof(*call)) );
+
+	for ( v = 0; v < g->n; v++ ) {
+		idx[v]     = -1;
+		g->comp[v] = -1;
+	}
+
+	for ( r = 1; r < g->n; r++ ) {
+		if ( idx[r] >= 0 )
+			continue;
+		idx[r] = low[r] = cnt++;
+		edge[r]        = g->first[r];
+		stk[sp++]      = r;
+		call[csp++]    = r;
+
+		while ( csp > 0 ) {
+			v = call[csp-1];
+			if ( edge[v] < g->first[v+1] ) {
+				w = g->succ[edge[v]++];
+				if ( idx[w] < 0 ) {
+					/* descend */
+					idx[w] = low[w] = cnt++;
+					edge[w]        = g->first[w];
+					stk[sp++]      = w;
+					call[csp++]    = w;
+				} else if ( g->comp[w] < 0 && idx[w] < low[v] ) {
+					/* 'w' is still on the stack */
+					low[v] = idx[w];
+				}
+				continue;
+			}
+			csp--;
+			if ( low[v] == idx[v] ) {
+				do {
+					w = stk[--sp];
+					g->comp[w] = ncomp;
+				} while ( w != v );
+				ncomp++;
+			}
+			if ( csp > 0 && low[v] < low[call[csp-1]] )
+				low[call[csp-1]] = low[v];
+		}
+	}
+
+	free(call);
+	free(stk);
+	free(edge);
+	free(low);
+	free(idx);
+	return ncomp;
+}
+
+/* build the graph, its components and the component DAG */
+static void
+depGraphBuild(DepGraph g)
+{
+ObjF	f;
+int		*map, *stamp;
+int		c, k, i, v, d, n, avail;
+
+	memset(g, 0, sizeof(*g));
+	g->n = numFiles;
+
+	assert( g->first = calloc(g->n + 1, sizeof(*g->first)) );
+	for ( f = fileListFirst(); f; f = f->next )
+		g->first[f->seq + 1] = depGraphEdges(f, 0);
+	for ( v = 0; v < g->n; v++ )
+		g->first[v + 1] += g->first[v];
+	assert( g->succ = malloc((g->first[g->n] + 1) * sizeof(*g->succ)) );
+	for ( f = fileListFirst(); f; f = f->next )
+		depGraphEdges(f, g->succ + g->first[f->seq]);
+
+	assert( g->comp = malloc(g->n * sizeof(*g->comp)) );
+	g->ncomp = depGraphTarjan(g);
+
+	/* renumber components in file list order (independent of the walk) */
+	assert( map       = malloc((g->ncomp + 1) * sizeof(*map)) );
+	assert( g->torder = malloc((g->ncomp + 1) * sizeof(*g->torder)) );
+	for ( c = 0; c < g->ncomp; c++ )
+		map[c] = -1;
+	for ( c = 0, f = fileListFirst(); f; f = f->next ) {
+		if ( map[g->comp[f->seq]] < 0 ) {
+			g->torder[g->comp[f->seq]] = c;
+			map[g->comp[f->seq]]       = c++;
+		}
+	}
+	for ( f = fileListFirst(); f; f = f->next )
+		g->comp[f->seq] = map[g->comp[f->seq]];
+	free(map);
+
+	/* members, in file list order */
+	assert( g->mfirst = calloc(g->ncomp + 1, sizeof(*g->mfirst)) );
+	assert( g->memb   = malloc(g->n * sizeof(*g->memb)) );
+	for ( f = fileListFirst(); f; f = f->next )
+		g->mfirst[g->comp[f->seq] + 1]++;
+	for ( c = 0; c < g->ncomp; c++ )
+		g->mfirst[c + 1] += g->mfirst[c];
+	for ( f = fileListFirst(); f; f = f->next )
+		g->memb[g->mfirst[g->comp[f->seq]]++] = f->seq;
+	/* the fill advanced each start to the next component's start */
+	for ( c = g->ncomp; c > 0; c-- )
+		g->mfirst[c] = g->mfirst[c - 1];
+	g->mfirst[0] = 0;
+
+	/* DAG edges without duplicates */
+	assert( stamp     = malloc((g->ncomp + 1) * sizeof(*stamp)) );
+	assert( g->cfirst = malloc((g->ncomp + 1) * sizeof(*g->cfirst)) );
+	for ( c = 0; c < g->ncomp; c++ )
+		stamp[c] = -1;
+	g->csucc = 0;
+	avail    = 0;
+	for ( n = c = 0; c < g->ncomp; c++ ) {
+		g->cfirst[c] = n;
+		for ( k = g->mfirst[c]; k < g->mfirst[c + 1]; k++ ) {
+			v = g->memb[k];
+			for ( i = g->first[v]; i < g->first[v + 1]; i++ ) {
+				d = g->comp[g->succ[i]];
+				if ( d == c || stamp[d] == c )
+					continue;
+				stamp[d] = c;
+				g->csucc = stackReserve(g->csucc, &avail, n + 1, sizeof(*g->csucc));
+				g->csucc[n++] = d;
+			}
+		}
+	}
+	g->cfirst[c] = n;
+	free(stamp);
+}
+
+static void
+depGraphFree(DepGraph g)
+{
+	free(g->reach);
+	free(g->torder);
+	free(g->csucc);
+	free(g->cfirst);
+	free(g->memb);
+	free(g->mfirst);
+	free(g->comp);
+	free(g->succ);
+	free(g->first);
+}
+
+/* compute the bitset of component 'c' (all of its successors are done) */
+static void
+depReachComp(DepGraph g, int c)
+{
+unsigned long	*row = DEP_REACH(g, c);
+unsigned long	*src;
+int				i, k;
+
+	row[c/BITS_PER_LONG] |= 1UL << (c % BITS_PER_LONG);
+	for ( i = g->cfirst[c]; i < g->cfirst[c + 1]; i++ ) {
+		src = DEP_REACH(g, g->csucc[i]);
+		for ( k = 0; k < g->nw; k++ )
+			row[k] |= src[k];
+	}
+}
+
+#ifdef HAVE_PTHREAD_H
+typedef struct DepReachJobRec_ {
+	DepGraph	g;
+	int			*comps;
+	int			n;
+	int			off;
+	int			stride;
+} DepReachJobRec, *DepReachJob;
+
+static void *
+depReachWorker(void *arg)
+{
+DepReachJob	job = arg;
+int			k;
+	for ( k = job->off; k < job->n; k += job->stride )
+		depReachComp(job->g, job->comps[k]);
+	return 0;
+}
+#endif
+
+/* process a level of 'n' mutually independent components */
+static void
+depReachLevel(DepGraph g, int *comps, int n)
+{
+int	k;
+#ifdef HAVE_PTHREAD_H
+	if ( nThreads > 1 && n >= DEP_MT_MIN ) {
+	pthread_t		*tids;
+	DepReachJobRec	*jobs;
+		assert( tids = malloc(nThreads * sizeof(*tids)) );
+		assert( jobs = malloc(nThreads * sizeof(*jobs)) );
+		for ( k = 0; k < nThreads; k++ ) {
+			jobs[k].g      = g;
+			jobs[k].comps  = comps;
+			jobs[k].n      = n;
+			jobs[k].off    = k;
+			jobs[k].stride = nThreads;
+			assert( 0 == pthread_create(&tids[k], 0, depReachWorker, &jobs[k]) );
+		}
+		for ( k = 0; k < nThreads; k++ )
+			pthread_join(tids[k], 0);
+		free(jobs);
+		free(tids);
+		return;
+	}
+#endif
+	for ( k = 0; k < n; k++ )
+		depReachComp(g, comps[k]);
+}
+
+/* compute the reachability bitsets level by level */
+static void
+depGraphReach(DepGraph g)
+{
+int		*height, *lfirst, *byLevel;
+int		t, c, i, h, nlev = 0;
+
+	g->nw = (g->ncomp + BITS_PER_LONG - 1) / BITS_PER_LONG;
+	assert( g->reach = calloc((size_t)g->ncomp * g->nw + 1, sizeof(*g->reach)) );
+
+	/* height (longest path to a sink); Tarjan found successors first */
+	assert( height = calloc(g->ncomp + 1, sizeof(*height)) );
+	for ( t = 0; t < g->ncomp; t++ ) {
+		c = g->torder[t];
+		for ( i = g->cfirst[c]; i < g->cfirst[c + 1]; i++ ) {
+			if ( height[g->csucc[i]] + 1 > height[c] )
+				height[c] = height[g->csucc[i]] + 1;
+		}
+		if ( height[c] + 1 > nlev )
+			nlev = height[c] + 1;
+	}
+
+	assert( lfirst  = calloc(nlev + 1, sizeof(*lfirst)) );
+	assert( byLevel = malloc((g->ncomp + 1) * sizeof(*byLevel)) );
+	for ( c = 0; c < g->ncomp; c++ )
+		lfirst[height[c] + 1]++;
+	for ( h = 0; h < nlev; h++ )
+		lfirst[h + 1] += lfirst[h];
+	for ( c = 0; c < g->ncomp; c++ )
+		byLevel[lfirst[height[c]]++] = c;
+	for ( h = nlev; h > 0; h-- )
+		lfirst[h] = lfirst[h - 1];
+	lfirst[0] = 0;
+
+	for ( h = 0; h < nlev; h++ )
+		depReachLevel(g, byLevel + lfirst[h], lfirst[h + 1] - lfirst[h]);
+
+	free(byLevel);
+	free(lfirst);
+	free(height);
+}
+
+/*
+ * Print the dependencies of all objects: the components (objects in
+ * a component require each other) and for every component the list
+ * of other components requiring it (directly or indirectly). Together
+ * this is what the '-d' flat dependency lists contain.
+ */
+void
+showDepsCompact(FILE *feil)
+{
+DepGraphRec	g;
+ObjF		*bySeq;
+ObjF		f;
+int			c, d, k;
+
+	depGraphBuild(&g);
+	depGraphReach(&g);
+
+	assert( bySeq = calloc(g.n, sizeof(*bySeq)) );
+	for ( f = fileListFirst(); f; f = f->next )
+		bySeq[f->seq] = f;
+
+	fprintf(feil,"\nDependency components (objects in a component require each other):\n");
+	for ( c = 0; c < g.ncomp; c++ ) {
+		fprintf(feil,"C%i:", c);
+		for ( k = g.mfirst[c]; k < g.mfirst[c + 1]; k++ ) {
+			fputc(' ', feil);
+			printObjName(feil, bySeq[g.memb[k]]);
+		}
+		fputc('\n', feil);
+	}
+
+	fprintf(feil,"\nFlat dependency list for components requiring:\n");
+	for ( c = 0; c < g.ncomp; c++ ) {
+		fprintf(feil,"C%i:", c);
+		for ( d = 0; (d = bitmapNext(DEP_REACH(&g, c), g.ncomp, d)) >= 0; d++ ) {
+			if ( d != c )
+				fprintf(feil," C%i", d);
+		}
+		fputc('\n', feil);
+	}
+
+	free(bySeq);
+	depGraphFree(&g);
+}
+
+/*
+ * Batch counterpart of unlinkObj(f, 0): 'f' and everything depending
+ * on it is merely added to the removal set 'rem' (which is closed right
+ * away so that later roots see the effect); walkSetUnlink() does the
+ * real work. 'app' is the application closure.
+ *
+ * RETURNS: 0 on success, NONZERO if 'f' is needed by the application.
+ */
+static ObjF
+batchUnlinkAdd(WalkSet app, WalkSet rem, ObjF f)
+{
+int start = rem->n;
+
+	if ( !f->link.anchor || walkSetHas(rem, f) ) {
+		fputc(' ',logf);
+		fputc(' ',logf);
+		printObjName(logf,f);
+		fprintf(logf," is currently not part of any link set.\n");
+		return 0;
+	}
+
+	if ( walkSetHas(app, f) ) {
+		if ( LOGGING(DEBUG_TRACE) )
+			traceEvent(TR_REJECT, 0, f, 0, walkSetRoot(app, f));
+		if ( LOGGING(DEBUG_UNLINK) ) {
+			fprintf(logf,"\n  skipping object '");
+			printObjName(logf,f);
+			fprintf(logf,"'");
+			logAppDependency(logf, app, f);
+		}
+		return f;
+	}
+
+	walkSetAdd(rem, f, 0, -1);
+	walkSetClose(rem, start, WALK_EXPORTS);
+	return 0;
+}
+
+
+static void
+symTraceAct(Sym s, void *closure)
+{
+	trackSym(logf, s);
+}
+
+/* Paranoia check */
+int checkObjPtrs()
+{
+int		err=0;
+ObjF	f;
+	for (f=fileListHead; f; f=f->next) { 
+		int ii;
+		for (ii=0; ii<f->nexports; ii++) {
+			if (f->exports[ii].obj != f) {
+				fprintf(stderr,"%s %ith export obj pointer corrupted\n", f->name, ii);
+				err++;
+			}
+		}
+		for (ii=0; ii<f->nimports; ii++) {
+			if (f->imports[ii].obj != f) {
+				fprintf(stderr,"%s %ith import obj pointer corrupted\n", f->name, ii);
+				err++;
+			}
+		}
+	}
+	return err;
+}
+
+typedef struct {
+	DepWalkCtx	ctx;
+	ObjF		test;
+	int			result;
+} CheckArgRec, *CheckArg;
+
+static void circCheckAction(ObjF f, int depth, void *closure)
+{
+CheckArg arg  = closure;
+	if (depth > arg->ctx->depth[f->seq] && f == arg->test)
+		arg->result = -1;
+}
+
+int checkCircWorkList(DepWalkCtx c, ObjF f)
+{
+CheckArgRec arg;
+	arg.ctx    = c;
+	arg.test   = f;
+	arg.result = 0;
+	workListIterate(c, f, circCheckAction, &arg);
+	return arg.result;
+}
+
+/* Depwalk action for printing node info */
+void
+depPrint(ObjF f, int d, void *closure)
+{
+DepPrintArg  arg  = (DepPrintArg)closure;
+FILE		*feil = arg->file;
+
+	if (d < arg->minDepth)
+		return;
+
+	if (!feil)
+		feil = logf;
+
+	if (arg->depthIndent >= 0)
+		d <<= arg->depthIndent;
+	else
+		d = 0;
+	d += arg->indent;
+	while (d-- > 0)
+		fputc(' ', feil);
+	printObjName(feil, f);
+	fputc('\n', feil);
+}
+
+/*
+ * Compare two objects by name. If the names match,
+ * the library names are compared unless any of the
+ * library pointers has the special value 'MATCH_ANY'
+ */
+static int
+objcmp(const void *a, const void *b)
+{
+ObjF	obja=*(ObjF*)a;
+ObjF	objb=*(ObjF*)b;
+int		rval;
+
+	/* names are interned */
+	if ( obja->name != objb->name )
+		return strcmp(obja->name, objb->name);
+
+	if (MATCH_ANY == obja->lib  || MATCH_ANY == objb->lib)
+		return 0;
+
+	/* matching object names; compare libraries (unique by basename) */
+	if (obja->lib) {
+		if (objb->lib) {
+			return obja->lib == objb->lib ? 0 : strcmp(obja->lib->bname, objb->lib->bname);
+		} else
+			return 1; /* a has library name, b has not b<a */
+	}
+	rval = objb->lib ? -1 : 0;
+
+	return rval;
+}
+
+/* Build a sorted index of all objects */
+ObjF *
+fileListBuildIndex()
+{
+ObjF *rval;
+ObjF f;
+int  i;
+
+	assert( rval = malloc(numFiles * sizeof(*rval)) );
+	for ( i=0, f = fileListHead; f; i++, f=f->next) {
+		rval[i] = f;
+	}
+	qsort(rval, numFiles, sizeof(*rval), objcmp);
+	return rval;
+}
+
+/*
+ * Find an object with 'name' in the index of all objects.
+ *
+ * Return the number of matches found.
+ * A pointer to the first match in the index
+ * array is returned in *pfound.
+ *
+ * 'name' is temporarily edited.
+ */
+int
+fileListFind(char *name, ObjF **pfound)
+{
+char	*objn, *po, *pc;
+ObjFRec	frec = {0};
+ObjF	f    = &frec;
+Lib		l;
+ObjF	*found, *end;
+int		rval = 0;
+
+	if ( ! (objn=splitName(name,&po,&pc)) ) {
+		return 0; /* ill-formed name */
+	}
+
+	/* no object has this name unless it's interned */
+	if ( ! (f->name = strInterned(objn)) )
+		goto cleanup;
+
+	if (po && *name) {
+		if ( !(l = libFind(name, 0)) ) {
+			goto cleanup;
+		}
+		f->lib = l;
+	} else  {
+		f->lib = MATCH_ANY;
+	}
+
+	if ( ! (found = bsearch(&f, fileListIndex, numFiles, sizeof(f), objcmp)) )
+		goto cleanup;
+
+	/* find all matches */
+	end = found;
+	while ( ++end < fileListIndex + numFiles && !objcmp(&f,end) )
+		/* nothing else to do */;
+
+	while (--found >= fileListIndex && !objcmp(&f, found))
+		/* nothing else to do */;
+
+	found++;
+
+	if (pfound)
+		*pfound = found;
+
+	rval = end-found;
+
+cleanup:
+	if (po) {
+		*po = '[';
+		*pc = ']';
+	}
+	return rval;
+}
+
+/*
+ * Wildcard searches: '*' matches any string and '?' any character
+ * (there are no character classes; '[' and ']' delimit library members).
+ *
+ * Symbols are kept in an array sorted by name; a literal prefix of the
+ * pattern ('pthread_*') selects a range of it by binary search. Within
+ * a large range the literal runs of three or more characters pick the
+ * shortest posting list of a trigram index (every symbol is listed under
+ * the - hashed - trigrams of its name) and only the candidates on it are
+ * matched against the pattern. Both are built on first use.
+ *
+ * Objects ('lib[member]', '[member]' or 'member'; the library part is
+ * matched against the basename of a library) are much fewer; they are
+ * matched in file list order, which is also the order in which '-o'/'-x'
+ * lists process them.
+ */
+#define TRI_BITS		16
+#define TRI_BUCKETS		(1<<TRI_BITS)
+#define TRI_MIN_RANGE	1024	/* smaller ranges are just scanned */
+
+typedef struct SymSearchRec_ {
+	Sym			*syms;		/* all symbols sorted by name */
+	int			n;
+	int			*tfirst;	/* bucket b lists syms[post[tfirst[b]]] .. syms[post[tfirst[b+1]-1]] */
+	int			*post;		/* indices into 'syms' (ascending per bucket) */
+	Sym			*res;		/* result of the last symSearch() */
+	int			ares;
+} SymSearchRec, *SymSearch;
+
+static SymSearchRec symSearchIdx = { 0 };
+
+/* RETURNS nonzero if 'str' contains a wildcard */
+static INLINE int
+hasWildcard(const char *str)
+{
+	return 0 != strpbrk(str, "*?");
+}
+
+/* RETURNS nonzero if 'str' matches the pattern 'pat' */
+static int
+globMatch(const char *pat, const char *str)
+{
+const char *star = 0, *resume = 0;
+
+	while ( *str ) {
+		if ( '*' == *pat ) {
+			star   = ++pat;
+			resume = str;
+		} else if ( *pat && ('?' == *pat || *pat == *str) ) {
+			pat++;
+			str++;
+		} else if ( star ) {
+			/* let the last '*' absorb one more character */
+			pat = star;
+			str = ++resume;
+		} else {
+			return 0;
+		}
+	}
+	while ( '*' == *pat )
+		pat++;
+	return !*pat;
+}
+
+static INLINE unsigned
+triBucket(const char *s)
+{
+unsigned t = (unsigned char)s[0] << 16 | (unsigned char)s[1] << 8 | (unsigned char)s[2];
+	return (t * 2654435761U) >> (32 - TRI_BITS);
+}
+
+static void
+symSearchAdd(Sym s, void *closure)
+{
+SymSearch x = closure;
+	x->syms[x->n++] = s;
+}
+
+static void
+symSearchBuild(SymSearch x)
+{
+	free(x->syms);
+	free(x->tfirst);
+	free(x->post);
+	x->tfirst = 0;
+	x->post   = 0;
+	x->n      = 0;
+	assert( x->syms = malloc((symTbl.nsyms + 1) * sizeof(*x->syms)) );
+	/* in name order */
+	symTblWalk(&symTbl, symSearchAdd, x);
+}
+
+/* build the trigram index (two passes: count, then fill the posting lists) */
+static void
+symSearchTrigrams(SymSearch x)
+{
+int			*last, *fill, i, b, pass;
+const char	*p;
+
+	assert( x->tfirst = calloc(TRI_BUCKETS + 1, sizeof(*x->tfirst)) );
+	assert( last      = malloc(TRI_BUCKETS * sizeof(*last)) );
+	assert( fill      = malloc(TRI_BUCKETS * sizeof(*fill)) );
+
+	for ( pass = 0; pass < 2; pass++ ) {
+		/* list a symbol only once per bucket */
+		for ( b = 0; b < TRI_BUCKETS; b++ )
+			last[b] = -1;
+		for ( i = 0; i < x->n; i++ ) {
+			for ( p = x->syms[i]->name; p[0] && p[1] && p[2]; p++ ) {
+				b = triBucket(p);
+				if ( last[b] == i )
+					continue;
+				last[b] = i;
+				if ( pass )
+					x->post[fill[b]++] = i;
+				else
+					x->tfirst[b + 1]++;
+			}
+		}
+		if ( !pass ) {
+			for ( b = 0; b < TRI_BUCKETS; b++ ) {
+				x->tfirst[b + 1] += x->tfirst[b];
+				fill[b]           = x->tfirst[b];
+			}
+			assert( x->post = malloc((x->tfirst[TRI_BUCKETS] + 1) * sizeof(*x->post)) );
+		}
+	}
+	free(fill);
+	free(last);
+}
+
+/* RETURNS the index of the first symbol whose first 'len' characters compare >= ('upper': >) 'pfx' */
+static int
+symSearchBound(SymSearch x, const char *pfx, int len, int upper)
+{
+int lo = 0, hi = x->n, m, c;
+
+	while ( lo < hi ) {
+		m = (lo + hi) / 2;
+		c = strncmp(x->syms[m]->name, pfx, len);
+		if ( c < 0 || (upper && 0 == c) )
+			lo = m + 1;
+		else
+			hi = m;
+	}
+	return lo;
+}
+
+static INLINE void
+symSearchResult(SymSearch x, int *pn, Sym s)
+{
+	x->res = stackReserve(x->res, &x->ares, *pn + 1, sizeof(*x->res));
+	x->res[(*pn)++] = s;
+}
+
+/*
+ * Find all symbols matching 'pat'; RETURNS their number (*pres points
+ * to them, sorted by name; valid until the next call).
+ */
+static int
+symSearch(const char *pat, Sym **pres)
+{
+SymSearch	x = &symSearchIdx;
+int			plen, lo, hi, i, k, b, best = -1, nbest = 0, n = 0;
+const char	*p, *q;
+
+	if ( !x->syms || x->n != symTbl.nsyms )
+		symSearchBuild(x);
+
+	plen = strcspn(pat, "*?");
+	lo   = symSearchBound(x, pat, plen, 0);
+	hi   = symSearchBound(x, pat, plen, 1);
+
+	if ( hi - lo > TRI_MIN_RANGE ) {
+		for ( p = pat; *p; p = *q ? q + 1 : q ) {
+			q = p + strcspn(p, "*?");
+			for ( ; q - p >= 3; p++ ) {
+				if ( !x->tfirst )
+					symSearchTrigrams(x);
+				b = triBucket(p);
+				if ( best < 0 || x->tfirst[b + 1] - x->tfirst[b] < nbest ) {
+					best  = b;
+					nbest = x->tfirst[b + 1] - x->tfirst[b];
+				}
+			}
+		}
+	}
+
+	if ( best >= 0 && nbest < hi - lo ) {
+		for ( k = x->tfirst[best]; k < x->tfirst[best + 1]; k++ ) {
+			i = x->post[k];
+			if ( i >= lo && i < hi && globMatch(pat, x->syms[i]->name) )
+				symSearchResult(x, &n, x->syms[i]);
+		}
+	} else {
+		for ( i = lo; i < hi; i++ ) {
+			if ( globMatch(pat, x->syms[i]->name) )
+				symSearchResult(x, &n, x->syms[i]);
+		}
+	}
+
+	*pres = x->res;
+	return n;
+}
+
+/*
+ * Find all objects matching 'pat'; RETURNS their number (*pres points
+ * to them, in file list order; valid until the next call).
+ */
+static int
+objSearch(const char *pat, ObjF **pres)
+{
+static ObjF	*res = 0;
+static int	ares = 0;
+char		*lpat, *mpat, *pc;
+ObjF		f;
+int			n = 0;
+
+	assert( lpat = strdup(pat) );
+	if ( (mpat = strchr(lpat, '[')) && (pc = strrchr(mpat, ']')) ) {
+		*mpat++ = 0;
+		*pc     = 0;
+		pat     = *lpat ? libBasename(lpat) : 0;
+	} else {
+		mpat    = lpat;
+		pat     = 0;
+	}
+
+	for ( f = fileListFirst(); f; f = f->next ) {
+		if ( pat && (!f->lib || !globMatch(pat, f->lib->bname)) )
+			continue;
+		if ( !globMatch(mpat, f->name) )
+			continue;
+		res = stackReserve(res, &ares, n + 1, sizeof(*res));
+		res[n++] = f;
+	}
+	free(lpat);
+
+	*pres = res;
+	return n;
+}
+
+/* My private versions of getc, ungetc. They operate
+ * on a string buffer (*pchpt) until it's empty and then
+ * switch to the stream 'f'.
+ * These routines are mainly used to skip comments in
+ * the 'remove_list' file.
+ */
+static int mygc(char **pchpt, FILE *f)
+{
+int rval;
+	if (*pchpt) {
+		rval = *((*pchpt)++);
+		if (!**pchpt)
+			*pchpt = 0;
+	} else {
+		rval = getc(f);
+	}
+	return rval;
+}
+
+static int myugc(int ch, char **pchpt, FILE *f)
+{
+	return !*pchpt ? ungetc(ch,f) : (*(--(*pchpt)) = (unsigned char)ch);
+}
+
+/*
+ * Read the next entry of an optional/exclude list into 'buf'
+ * (MAXBUF+1 chars). Comments are skipped and so are lines not
+ * terminated by a ':' (thus ordinary name lists can be processed);
+ * the ':' is stripped.
+ *
+ * RETURNS: 1 if an entry was read, 0 at the end of the file,
+ *          -5 on buffer overflow.
+ */
+static int
+listNextEntry(FILE *remf, char *buf, int *pline, char *fname)
+{
+char *comment;
+int  i;
+
+	buf[MAXBUF] = 'X'; /* tag end of buffer */
+
+	while ( fgets(buf, MAXBUF+1, remf) ) {
+		(*pline)++;
+
+		if (!buf[MAXBUF]) {
+			fprintf(stderr,"Buffer overflow in %s (line %i)\n",
+							fname,
+							*pline);
+			return -5;
+		}
+
+		/* does a comment start on this line
+		 * (note: '/' '*' must be on the same line, i.e. in buf)
+		 */
+		if ( (comment = strchr(buf, '/')) && '*'==*(comment + 1) ) {
+			/* strip comment off 'buf' */
+			*comment = 0;
+			/* scan past comment */
+			comment += 2;
+			do {
+				while ( '*' != mygc(&comment, remf) )
+					/* nothing else to do */;
+				/* at this point, we scanned past the next '*' */
+
+				while ( '*' == (i = mygc(&comment, remf)) )
+					/* nothing else to do */;
+
+				/* at this point, we scanned past the last '*' in a row */
+
+			} while ( '/' != i );
+
+		}
+
+		/* now proceed scanning the buffer */
+
+		/* strip off white space */
+		for (comment = buf; *comment && !isspace(*comment); comment++)
+			/* that's it */;
+		*comment = 0;
+
+		if ( (i=strlen(buf)) < 1 )
+			continue; /* left an empty buffer */
+
+#if DEBUG & DEBUG_COMMENT
+fprintf(debugf,"Scanned '%s'\n",buf); continue;
+#endif
+
+		/*
+		 * ignore lines not terminating with a ':'; thus we
+		 * can process ordinary name lists :-)
+		 */
+
+		if ( ':' != buf[--i] ) {
+			continue;
+		}
+		/* strip ':' */
+		buf[i] = 0;
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Parallel reverse closures of exclude list entries ('-B' with '-j').
+ *
+ * Before processing an exclude list the closure (the work list of
+ * a depwalk(..., WALK_EXPORTS | WALK_BUILD_LIST)) of every entry is
+ * computed by up to 'nThreads' threads, each using its own DepWalkCtx.
+ * processFile() then merges them in list order (batchUnlinkMerge())
+ * and the members are unlinked at once like with the plain batch engine.
+ * The closures are computed before anything is removed; a rejection
+ * is decided (and looks) the same as with unlinkObj() but the work
+ * list logged for it may still contain objects removed by earlier
+ * entries.
+ */
+
+/* member of a closure (an element of a work list) */
+typedef struct CloseItemRec_ {
+	ObjF	obj;
+	Xref	via;		/* reference 'obj' was reached along (NULL for the root) */
+	int		depth;		/* as passed to a DepWalkActionRef */
+} CloseItemRec, *CloseItem;
+
+typedef struct CloseJobRec_ {
+	ObjF		root;
+	ObjF		reject;		/* first member of the closure in the application link set */
+	CloseItem	items;
+	int			n;
+	int			avail;
+} CloseJobRec, *CloseJob;
+
+typedef struct CloseJobsRec_ {
+	CloseJob		jobs;
+	int				n;
+	int				avail;
+	int				*bySeq;		/* job of a root (by seq; -1: none) */
+	WalkSet			app;
+	int				next;		/* next job to compute */
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t	mtx;
+#endif
+} CloseJobsRec, *CloseJobs;
+
+/* DepWalkActionRef recording a work list element */
+static void
+closeItemAdd(Xref r, int depth, void *closure)
+{
+CloseJob	job = closure;
+CloseItem	it;
+
+	if ( !job->reject && r->obj->link.anchor == &appLinkSet )
+		job->reject = r->obj;
+	job->items = stackReserve(job->items, &job->avail, job->n + 1, sizeof(*job->items));
+	it         = &job->items[job->n++];
+	it->obj    = r->obj;
+	it->via    = r->sym ? r : 0;
+	it->depth  = depth;
+}
+
+static void
+closeJobCompute(DepWalkCtx c, CloseJobs js, CloseJob job)
+{
+ObjF f = job->root;
+
+	if ( !f->link.anchor )
+		return; /* reported by batchUnlinkMerge() */
+
+	/* a root needed by the application is rejected; the work list is only needed for logging */
+	if ( walkSetHas(js->app, f) && ! LOGGING(DEBUG_UNLINK) ) {
+		job->reject = f;
+		return;
+	}
+
+	depwalk(c, f, 0, 0, WALK_EXPORTS | WALK_BUILD_LIST);
+	workListIterateRef(c, f, closeItemAdd, job);
+	depwalkListRelease(c, f);
+}
+
+#ifdef HAVE_PTHREAD_H
+static void *
+closeWorker(void *arg)
+{
+CloseJobs		js = arg;
+DepWalkCtxRec	ctx;
+int				i;
+
+	memset(&ctx, 0, sizeof(ctx));
+	for (;;) {
+		pthread_mutex_lock(&js->mtx);
+		i = js->next < js->n ? js->next++ : -1;
+		pthread_mutex_unlock(&js->mtx);
+
+		if ( i < 0 )
+			break;
+
+		closeJobCompute(&ctx, js, &js->jobs[i]);
+	}
+	/* statistics are merged by the main thread */
+	pthread_mutex_lock(&js->mtx);
+	depwalkCtxStats(&ctx);
+	pthread_mutex_unlock(&js->mtx);
+	depwalkCtxFree(&ctx);
+	return 0;
+}
+
+/*
+ * Compute the closures of all (unambiguous) entries of the exclude
+ * list 'remf' (which is rewound); 'app' is the application closure.
+ */
+static void
+closeJobsRun(CloseJobs js, WalkSet app, FILE *remf, char *fname)
+{
+char		buf[MAXBUF+1];
+int			line = 0, i, nt;
+ObjF		*pobj;
+pthread_t	*tids;
+int			k, nf;
+
+	assert( js->bySeq = malloc(numFiles * sizeof(*js->bySeq)) );
+	for ( i=0; i<numFiles; i++ )
+		js->bySeq[i] = -1;
+
+	while ( listNextEntry(remf, buf, &line, fname) > 0 ) {
+		if ( hasWildcard(buf) )
+			nf = objSearch(buf, &pobj);
+		else if ( 1 != (nf = fileListFind(buf, &pobj)) )
+			continue;
+		for ( k=0; k<nf; k++ ) {
+			if ( js->bySeq[pobj[k]->seq] >= 0 )
+				continue;
+			js->jobs = stackReserve(js->jobs, &js->avail, js->n + 1, sizeof(*js->jobs));
+			memset(&js->jobs[js->n], 0, sizeof(js->jobs[js->n]));
+			js->jobs[js->n].root      = pobj[k];
+			js->bySeq[pobj[k]->seq]   = js->n++;
+		}
+	}
+	rewind(remf);
+
+	js->app  = app;
+	js->next = 0;
+
+	pthread_mutex_init(&js->mtx, 0);
+	nt = nThreads < js->n ? nThreads : js->n;
+	assert( tids = malloc((nt ? nt : 1) * sizeof(*tids)) );
+	for ( i=0; i<nt; i++ )
+		assert( 0 == pthread_create(&tids[i], 0, closeWorker, js) );
+	for ( i=0; i<nt; i++ )
+		pthread_join(tids[i], 0);
+	free(tids);
+	pthread_mutex_destroy(&js->mtx);
+}
+#endif
+
+static void
+closeJobsFree(CloseJobs js)
+{
+int i;
+	for ( i=0; i<js->n; i++ )
+		free(js->jobs[i].items);
+	free(js->jobs);
+	free(js->bySeq);
+	memset(js, 0, sizeof(*js));
+}
+
+/*
+ * Like batchUnlinkAdd() but use the closure computed by closeJobsRun()
+ * (if there is one for 'f').
+ *
+ * RETURNS: 0 on success, NONZERO if 'f' is needed by the application.
+ */
+static ObjF
+batchUnlinkMerge(WalkSet app, WalkSet rem, CloseJobs js, ObjF f)
+{
+CloseJob	job;
+ObjF		reject = 0;
+XrefRec		r      = {0};
+int			k;
+
+	if ( !js->bySeq || js->bySeq[f->seq] < 0 )
+		return batchUnlinkAdd(app, rem, f);
+
+	job = &js->jobs[js->bySeq[f->seq]];
+
+	if ( !f->link.anchor || walkSetHas(rem, f) ) {
+		fputc(' ',logf);
+		fputc(' ',logf);
+		printObjName(logf,f);
+		fprintf(logf," is currently not part of any link set.\n");
+		return 0;
+	}
+
+	if ( job->reject ) {
+		if ( LOGGING(DEBUG_TRACE) )
+			traceEvent(TR_REJECT, 0, f, 0, job->reject);
+		if ( LOGGING(DEBUG_UNLINK) ) {
+			/* as unlinkObj() logs it */
+			checkSysLinkSet(job->reject, 0, &reject);
+			logUnlinkSkip(f, job->reject);
+			for ( k=0; k<job->n; k++ ) {
+				if ( job->items[k].via ) {
+					priInfAct(job->items[k].via, job->items[k].depth, job->reject);
+				} else {
+					r.obj = job->items[k].obj;
+					priInfAct(&r, job->items[k].depth, job->reject);
+				}
+			}
+		}
+		return job->reject;
+	}
+
+	for ( k=0; k<job->n; k++ )
+		walkSetAdd(rem, job->items[k].obj, 0, -1);
+	return 0;
+}
+
+/*
+ * (Un)link all files listed in the file 'fname' along with
+ * objects depending on them.
+ *
+ * RETURNS: 0 on success,
+ *          NONZERO on failure:
+ *             -4 list file not found
+ *             -3 listed object member name needs more qualification
+ *             -2 listed object not found
+ *             -1 listed object member of Application link set
+ *                (this error is ignored 
+ *             These errors may be ignored by setting the sloppyness
+ *             (makes probably only sense for sloppy < 2)
+ */
+int
+processFile(ProcTab pt, int sloppy)
+{
+FILE *remf;
+char buf[MAXBUF+1];
+int  got,i,k;
+int  line;
+int  glob;
+ObjF *pobj;
+int  rval = 0;
+int  batch = batchUnlink && ! pt->linkNotUnlink;
+WalkSetRec app = { 0 }, rem = { 0 };
+CloseJobsRec jobs = { 0 };
+
+	if ( ! (remf=ffind(pt->fname)) ) {
+		fprintf(stderr,	"Opening %s_list file '%s': %s\n",
+						pt->linkNotUnlink  ? "optional" : "exclude",
+						pt->fname,
+						strerror(errno));
+		return -4;
+	}
+
+	fprintf(logf,
+			"Processing list of files ('%s') to %s %s link set\n",
+			pt->fname,
+			pt->linkNotUnlink ? "add to" : "remove from",
+			optionalLinkSet.name);
+
+	if ( batch ) {
+		/* removals are collected and done at the end; rejection checks
+		 * use the closure of the application computed up front
+		 */
+		appClosure(&app);
+		walkSetInit(&rem);
+#ifdef HAVE_PTHREAD_H
+		if ( nThreads > 1 )
+			closeJobsRun(&jobs, &app, remf, pt->fname);
+#endif
+	}
+
+	line = 0;
+	while ( (rval >= 0 || sloppy) && (got = listNextEntry(remf, buf, &line, pt->fname)) ) {
+		if ( got < 0 ) {
+			rval = got;
+			break;
+		}
+
+		/* a wildcard entry ('libbsd.a[*]:') stands for all objects it matches */
+		glob = hasWildcard(buf);
+		got  = glob ? objSearch(buf, &pobj) : fileListFind(buf, &pobj);
+
+		rval = sloppy;
+
+		if ( 0 == got ) {
+			char *fmt = "Object '%s' not found!\n";
+			if ( (rval -= 2) >=0 ) {
+				if ( ! LOGGING(DEBUG_UNLINK) ) {
+					/* We didn't log so far and the stderr message may
+				 	* get lost...
+				 	*/
+					fprintf(logf, fmt, buf);
+				}
+				fprintf(stderr,"Warning: ");
+			}
+			fprintf(stderr, fmt, buf);
+		} else if ( got > 1 && !glob ) {
+			rval -= 3;
+			fprintf(stderr,"Multiple occurrences of '%s':\n",buf);
+			for (i=0; i<got; i++) {
+				fputc(' ',stderr);
+				fputc(' ',stderr);
+				printObjName(stderr,pobj[i]);
+				fputc('\n',stderr);
+			}
+			fprintf(stderr,"please be more specific!\n");
+		} else  {
+			/* every match counts as an entry of its own */
+			for ( k=0; k<got && rval >= 0; k++ ) {
+				rval = sloppy;
+				if ( glob )
+					sprintObjName(buf, sizeof(buf), pobj[k]);
+				if ( pt->linkNotUnlink ) {
+					if ( 0 == pobj[k]->link.anchor ) {
+						pobj[k]->link.anchor = &optionalLinkSet;
+						sprintf(buf,"<SCRIPT>'%s'",pt->fname);
+						rval -= linkObj( pobj[k], buf, 0 );
+					}
+				} else if ( batch ? batchUnlinkMerge(&app, &rem, &jobs, pobj[k]) : unlinkObj(pobj[k], 0) ) {
+					char *fmt = "Object '%s' couldn't be removed; probably it's needed by the application\n";
+					if ( (rval -= 1) >= 0 ) {
+						if ( ! LOGGING(DEBUG_UNLINK) ) {
+							/* We didn't log so far and the stderr message may
+						 	* get lost...
+						 	*/
+							fprintf(logf, fmt, buf);
+						}
+						fprintf(stderr,"Warning: ");
+					}
+					fprintf(stderr, fmt, buf);
+				}
+			}
+		}
+	}
+
+	if ( batch ) {
+		walkSetClose(&rem, 0, WALK_EXPORTS);
+		walkSetUnlink(&rem);
+		walkSetFree(&rem);
+		walkSetFree(&app);
+		closeJobsFree(&jobs);
+	}
+
+	fclose(remf);
+	return rval;
+}
+
+/*
+ * Buffered output for the linker script and the CEXP source:
+ * text is assembled in a large buffer and written out in bulk.
+ * A buffer without a 'file' just grows (it holds a section which
+ * is written after another one).
+ */
+#define OUTBUF_SIZE		(1<<16)
+
+typedef struct OutBufRec_ {
+	FILE	*file;
+	char	*buf;
+	int		len;
+	int		avail;
+} OutBufRec, *OutBuf;
+
+static void
+obInit(OutBuf b, FILE *file)
+{
+	b->file  = file;
+	b->len   = 0;
+	b->avail = OUTBUF_SIZE;
+	assert( b->buf = malloc(b->avail) );
+}
+
+static void
+obFlush(OutBuf b)
+{
+	if ( b->len ) {
+		fwrite(b->buf, 1, b->len, b->file);
+		b->len = 0;
+	}
+}
+
+/* Write out and release the buffer */
+static void
+obClose(OutBuf b)
+{
+	obFlush(b);
+	free(b->buf);
+	b->buf = 0;
+}
+
+static INLINE char *
+obReserve(OutBuf b, int n)
+{
+	if ( b->len + n > b->avail ) {
+		if ( b->file )
+			obFlush(b);
+		b->buf = stackReserve(b->buf, &b->avail, b->len + n, 1);
+	}
+	return b->buf + b->len;
+}
+
+static INLINE void
+obWrite(OutBuf b, const char *s, int n)
+{
+	memcpy(obReserve(b, n), s, n);
+	b->len += n;
+}
+
+static INLINE void
+obPuts(OutBuf b, const char *s)
+{
+	obWrite(b, s, strlen(s));
+}
+
+/* Append a string literal */
+#define OBLIT(b, lit)	obWrite((b), (lit), sizeof(lit) - 1)
+
+/* Append a decimal integer (what printf("%i") produces) */
+static void
+obInt(OutBuf b, int v)
+{
+char			tmp[12];
+char			*p = tmp + sizeof(tmp);
+unsigned		u  = v < 0 ? -(unsigned)v : (unsigned)v;
+
+	do {
+		*--p = '0' + u % 10;
+	} while ( (u /= 10) );
+	if ( v < 0 )
+		*--p = '-';
+	obWrite(b, p, tmp + sizeof(tmp) - p);
+}
+
+/* Append what printObjName() prints */
+static void
+obObjName(OutBuf b, ObjF f)
+{
+	if ( f->lib ) {
+		obPuts(b, f->lib->bname);
+		obWrite(b, "[", 1);
+		obPuts(b, f->name);
+		obWrite(b, "]", 1);
+	} else {
+		obPuts(b, f->name);
+	}
+}
+
+/* Append the 'title' and object header comments */
+static void
+obTitle(OutBuf b, char *title)
+{
+	OBLIT(b, "/* ----- ");
+	obPuts(b, title);
+	OBLIT(b, " Link Set ----- */\n\n");
+}
+
+static void
+obObjHeader(OutBuf b, ObjF f)
+{
+	OBLIT(b, "/* ");
+	obObjName(b, f);
+	OBLIT(b, ": */\n");
+}
+
+/*
+ * Output order. By default the members of a link set are written in
+ * link set order (i.e., as linkObj() prepended them) and their exports
+ * as they were listed. With '-R' the objects are sorted by library
+ * and object name (application objects without a library first) and
+ * the exports of each object by symbol name, so that the output only
+ * depends on the contents of the link sets.
+ */
+static int
+outObjCmp(const void *a, const void *b)
+{
+ObjF	fa = *(ObjF*)a;
+ObjF	fb = *(ObjF*)b;
+int		rval;
+
+	if ( fa->lib != fb->lib ) {
+		if ( !fa->lib || !fb->lib )
+			return fa->lib ? 1 : -1;
+		if ( (rval = strcmp(fa->lib->bname, fb->lib->bname)) )
+			return rval;
+	}
+	if ( fa->name != fb->name && (rval = strcmp(fa->name, fb->name)) )
+		return rval;
+	return fa->seq - fb->seq;
+}
+
+/* RETURNS the members of link set 's' in output order (malloc()ed; *pn: their number) */
+static ObjF *
+outObjs(LinkSet s, int *pn)
+{
+ObjF	*rval = 0, f;
+int		n = 0, avail = 0;
+
+	for ( f = s->set; f; f = f->link.next ) {
+		rval      = stackReserve(rval, &avail, n + 1, sizeof(*rval));
+		rval[n++] = f;
+	}
+	if ( n > 1 && sortedOutput )
+		qsort(rval, n, sizeof(*rval), outObjCmp);
+	*pn = n;
+	return rval;
+}
+
+static ObjF outExportsObj;	/* qsort() closure */
+
+static int
+outExportCmp(const void *a, const void *b)
+{
+Xref	ra = &outExportsObj->exports[*(int*)a];
+Xref	rb = &outExportsObj->exports[*(int*)b];
+int		rval;
+
+	if ( ra->sym != rb->sym && (rval = strcmp(ra->sym->name, rb->sym->name)) )
+		return rval;
+	return *(int*)a - *(int*)b;
+}
+
+/*
+ * RETURNS the indices of the exports of 'f' in output order (the
+ * array is reused by the next call)
+ */
+static int *
+outExports(ObjF f)
+{
+static int	*idx   = 0;
+static int	avail  = 0;
+int			n;
+
+	idx = stackReserve(idx, &avail, f->nexports, sizeof(*idx));
+	for ( n = 0; n < f->nexports; n++ )
+		idx[n] = n;
+	if ( f->nexports > 1 && sortedOutput ) {
+		outExportsObj = f;
+		qsort(idx, f->nexports, sizeof(*idx), outExportCmp);
+	}
+	return idx;
+}
+
+/*
+ * Write EXTERN declarations for all members of a link set
+ * to 'b'. A 'title' may be added as a C-style comment.
+ *
+ * The output is suitable for GNU ld.
+ */
+static int
+writeLinkSet(OutBuf b, LinkSet s, char *title)
+{
+ObjF	f, *objs;
+Xref	r;
+int		i, n, nobjs, *ex;
+
+	if ( !s->set )
+		return 0;
+
+	if (title)
+		obTitle(b, title);
+
+	objs = outObjs(s, &nobjs);
+	for ( i = 0; i < nobjs; i++ ) {
+		f  = objs[i];
+		ex = outExports(f);
+		obObjHeader(b, f);
+		for ( n = 0; n < f->nexports; n++ ) {
+			r = &f->exports[ex[n]];
+			OBLIT(b, "EXTERN( ");
+			obWrite(b, r->sym->name, r->sym->len);
+			OBLIT(b, " ) /* size ");
+			obInt(b, r->size);
+			OBLIT(b, " */\n");
+		}
+	}
+	free(objs);
+	return 0;
+}
+
+/*
+ * Generate a linker script with external references to enforce linking the
+ * application and optional link sets
+ */
+int
+writeScript(FILE *feil, int optionalOnly)
+{
+OutBufRec b;
+
+	obInit(&b, feil);
+	if ( !optionalOnly ) {
+		writeLinkSet(&b, &appLinkSet, "Application");
+		OBLIT(&b, "\n");
+	}
+
+	writeLinkSet(&b, &optionalLinkSet, "Optional");
+	obClose(&b);
+	return 0;
+}
+
+/* RETURNS the length of a symbol name without the version suffix */
+static int
+symStrippedLen(Sym ps)
+{
+#ifdef LINKER_VERSION_SEPARATOR
+char *chpt;
+	if ( (chpt = memchr(ps->name, LINKER_VERSION_SEPARATOR, ps->len)) )
+		return chpt - ps->name;
+#endif
+	return ps->len;
+}
+
+/* Append the alias name for the i-th symbol of a link set */
+static INLINE void
+obAlias(OutBuf b, char *title, int tlen, int i)
+{
+	OBLIT(b, DUMMY_ALIAS_PREFIX);
+	obWrite(b, title, tlen);
+	obInt(b, i);
+}
+
+static void
+writeSymdecl(OutBuf b, Xref r, char *title, int tlen, int i)
+{
+	/* Don't emit a declaration for weak undefined symbols */
+	if ( ! ISWEAKUNDEF(TYPE(r)) ) {
+		OBLIT(b, "extern int ");
+		obAlias(b, title, tlen, i);
+		OBLIT(b, ";\nasm(\".set ");
+		obAlias(b, title, tlen, i);
+		OBLIT(b, ",");
+		obWrite(b, r->sym->name, symStrippedLen(r->sym));
+		OBLIT(b, "\\n\");\n");
+	}
+}
+
+/* CEXP symbol table entry types and flags (for '-C' and '-K') */
+#define CSYM_TYPE_VOID		0
+#define CSYM_TYPE_FUNCP		1
+#define CSYM_TYPE_VOIDP		2
+#define CSYM_FLG_GLBL		4
+#define CSYM_FLG_WEAK		8
+
+/* RETURNS the CEXP type of a symbol table entry; flags are stored in *pflags */
+static int
+symdefInfo(Xref r, int *pflags)
+{
+char t            = TYPE(r);
+char ut           = ISWEAKUNDEF(t) ? t : toupper(t);
+
+	*pflags = 0;
+	if ( isupper(t) || ISWEAKUNDEF(t) )
+		*pflags |= CSYM_FLG_GLBL;
+	if ( ( 'W' == ut || 'V' == ut || ISWEAKUNDEF(ut) ) &&
+			strcmp("cexpSystemSymbols",r->sym->name) )
+		*pflags |= CSYM_FLG_WEAK;
+
+	if ( ISWEAKUNDEF(t) )
+		return CSYM_TYPE_VOIDP;
+	return 'T' == t ? CSYM_TYPE_FUNCP : CSYM_TYPE_VOID;
+}
+
+static void
+writeSymdef(OutBuf b, Xref r, char *title, int tlen, int i)
+{
+int flags;
+int type = symdefInfo(r, &flags);
+
+	OBLIT(b, "\t{\n\t\t.name        = \"");
+	obWrite(b, r->sym->name, r->sym->len);
+	OBLIT(b, "\",\n");
+	if ( CSYM_TYPE_VOIDP != type ) {
+		OBLIT(b, "\t\t.value.ptv   =(void*)&");
+		obAlias(b, title, tlen, i);
+		if ( CSYM_TYPE_FUNCP == type )
+			OBLIT(b, ",\n\t\t.value.type  =TFuncP,\n\t\t.size        =");
+		else
+			OBLIT(b, ",\n\t\t.value.type  =TVoid,\n\t\t.size        =");
+		obInt(b, r->size);
+		OBLIT(b, ",\n");
+	} else {
+		OBLIT(b, "\t\t.value.ptv   =(void*)0,\n");
+		OBLIT(b, "\t\t.value.type  =TVoidP,  \n");
+		OBLIT(b, "\t\t.size        =0,       \n");
+	}
+	OBLIT(b, "\t\t.flags       =0");
+	if ( flags & CSYM_FLG_GLBL )
+		OBLIT(b, "|CEXP_SYMFLG_GLBL");
+	if ( flags & CSYM_FLG_WEAK )
+		OBLIT(b, "|CEXP_SYMFLG_WEAK");
+	OBLIT(b, ",\n\t},\n");
+}
+
+/*
+ * Write symbol declarations (to 'decl') and definitions in C source form
+ * (to 'def') for all members of a link set in a single pass. A 'title'
+ * may be added as a C-style comment.
+ *
+ * The output is suitable for building into CEXP applications
+ */
+static int
+writeSymdefs(OutBuf decl, OutBuf def, LinkSet s, char *title)
+{
+ObjF	f, *objs;
+Xref	r;
+int		n, k, nobjs, *ex;
+int     i;
+int		tlen = strlen(title);
+
+	if ( !s->set )
+		return 0;
+
+	obTitle(decl, title);
+	obTitle(def,  title);
+
+	objs = outObjs(s, &nobjs);
+	for ( i=0, k=0 ; k < nobjs; k++ ) {
+		f  = objs[k];
+		ex = outExports(f);
+		obObjHeader(decl, f);
+		obObjHeader(def,  f);
+		for ( n = 0; n < f->nexports; n++ ) {
+			r = &f->exports[ex[n]];
+			if ( f != strongestExport( r->sym )->obj )
+				continue;
+			writeSymdecl(decl, r, title, tlen, i);
+			writeSymdef(def,   r, title, tlen, i);
+			i++;
+		}
+	}
+	free(objs);
+	return 0;
+}
+
+
+/*
+ * Generate a Cexp symbol table source file. Adding this to the application
+ * automatically triggers linkage of the optional link sets.
+ *
+ * The declarations go straight to 'feil'; the table is collected in
+ * memory and appended.
+ */
+int
+writeSource(FILE *feil, int optionalOnly)
+{
+OutBufRec decl, def;
+
+	obInit(&decl, feil);
+	obInit(&def,  0);
+
+	OBLIT(&decl, "#include <cexpsyms.h>\n");
+	OBLIT(&def,  "\n\nstatic CexpSymRec systemSymbols[] = {\n");
+
+	if ( !optionalOnly ) {
+		writeSymdefs(&decl, &def, &appLinkSet, "Application");
+		OBLIT(&decl, "\n");
+		OBLIT(&def,  "\n");
+	}
+
+	writeSymdefs(&decl, &def, &optionalLinkSet, "Optional");
+
+	if ( emitUndefs ) {
+		writeSymdefs(&decl, &def, &undefLinkSet, "UNDEFINED");
+	}
+
+	OBLIT(&def, "\t{\n");
+	OBLIT(&def, "\t0, /* terminating record */\n");
+	OBLIT(&def, "\t},\n");
+	OBLIT(&def, "};\n");
+	OBLIT(&def, "CexpSym cexpSystemSymbols = systemSymbols;\n");
+
+	obClose(&decl);
+	def.file = feil;
+	obClose(&def);
+	return 0;
+}
+
+
+/*
+ * Compact CEXP symbol table ('-K'): an assembler source (to be run
+ * through the C preprocessor, i.e., a '.S' file) with a single string
+ * blob and packed arrays instead of one initialized CexpSymRec and one
+ * alias per symbol. The symbols are referenced directly (which triggers
+ * linkage just like the C source does).
+ *
+ * Layout (all arrays have 'nsyms' entries, in the order '-C' emits them):
+ *
+ *  cexpCompactSymbols:
+ *      .long   CSYM_MAGIC, CSYM_VERSION, nsyms, size of the string blob
+ *      PTR     values, offsets, sizes, info, strings
+ *  values:     PTR   address of the symbol (0 for weak undefined symbols)
+ *  offsets:    .long offset of the name in the string blob
+ *  sizes:      .long size
+ *  info:       .byte type (CSYM_TYPE_XXX) | flags (CSYM_FLG_XXX)
+ *  strings:    NUL-terminated names
+ *
+ * A loader on the target builds its CexpSymRec table from this.
+ */
+#define CSYM_MAGIC			0x4353594d	/* 'CSYM' */
+#define CSYM_VERSION		1
+
+#define CSYM_ITEMS_PER_LINE	16
+
+typedef struct CompactOutRec_ {
+	OutBufRec	values, offsets, sizes, info, strings;
+	int			nsyms;
+	int			nstr;
+} CompactOutRec, *CompactOut;
+
+/* Append the 'i'-th item of a list, starting a new 'directive' line every so often */
+static void
+obItem(OutBuf b, const char *directive, int i)
+{
+	if ( 0 == i % CSYM_ITEMS_PER_LINE ) {
+		if ( i )
+			OBLIT(b, "\n");
+		obPuts(b, directive);
+	} else {
+		OBLIT(b, ",");
+	}
+}
+
+static void
+writeCompactSyms(CompactOut c, LinkSet s, char *title)
+{
+ObjF	f, *objs;
+Xref	r;
+int		n, k, nobjs, *ex, type, flags;
+
+	if ( !s->set )
+		return;
+
+	OBLIT(&c->values, "/* ----- ");
+	obPuts(&c->values, title);
+	OBLIT(&c->values, " Link Set ----- */\n");
+
+	objs = outObjs(s, &nobjs);
+	for ( k = 0; k < nobjs; k++ ) {
+		f  = objs[k];
+		ex = outExports(f);
+		for ( n = 0; n < f->nexports; n++ ) {
+			r = &f->exports[ex[n]];
+			if ( f != strongestExport( r->sym )->obj )
+				continue;
+
+			type = symdefInfo(r, &flags);
+
+			OBLIT(&c->values, "\tCEXP_PTR ");
+			if ( CSYM_TYPE_VOIDP == type )
+				OBLIT(&c->values, "0");
+			else
+				obWrite(&c->values, r->sym->name, symStrippedLen(r->sym));
+			OBLIT(&c->values, "\n");
+
+			obItem(&c->offsets, "\t.long ", c->nsyms);
+			obInt(&c->offsets, c->nstr);
+
+			obItem(&c->sizes, "\t.long ", c->nsyms);
+			obInt(&c->sizes, CSYM_TYPE_VOIDP == type ? 0 : r->size);
+
+			obItem(&c->info, "\t.byte ", c->nsyms);
+			obInt(&c->info, type | flags);
+
+			OBLIT(&c->strings, "\t.asciz \"");
+			obWrite(&c->strings, r->sym->name, r->sym->len);
+			OBLIT(&c->strings, "\"\n");
+
+			c->nstr += r->sym->len + 1;
+			c->nsyms++;
+		}
+	}
+	free(objs);
+}
+
+/* Append a list section (terminating its last line) */
+static void
+obSection(OutBuf b, OutBuf l, const char *label, const char *align)
+{
+	OBLIT(b, "\n");
+	obPuts(b, align);
+	obPuts(b, label);
+	OBLIT(b, ":\n");
+	obWrite(b, l->buf, l->len);
+	if ( l->len && '\n' != l->buf[l->len - 1] )
+		OBLIT(b, "\n");
+	free(l->buf);
+	l->buf = 0;
+}
+
+/*
+ * Generate a compact CEXP symbol table as assembler source, see above.
+ * Like writeSource() this triggers linkage of the optional link sets.
+ */
+int
+writeCompactSource(FILE *feil, int optionalOnly)
+{
+CompactOutRec	c;
+OutBufRec		b;
+char			hdr[64];
+
+	obInit(&c.values,  0);
+	obInit(&c.offsets, 0);
+	obInit(&c.sizes,   0);
+	obInit(&c.info,    0);
+	obInit(&c.strings, 0);
+	c.nsyms = c.nstr = 0;
+
+	/* same link sets as writeSource() */
+	if ( !optionalOnly )
+		writeCompactSyms(&c, &appLinkSet, "Application");
+	writeCompactSyms(&c, &optionalLinkSet, "Optional");
+	if ( emitUndefs )
+		writeCompactSyms(&c, &undefLinkSet, "UNDEFINED");
+
+	obInit(&b, feil);
+	OBLIT(&b, "/* Compact CEXP symbol table generated by ldep; preprocess (.S) and assemble */\n");
+	OBLIT(&b, "#if __SIZEOF_POINTER__ == 8\n#define CEXP_PTR    .quad\n#define CEXP_PTRALN .balign 8\n");
+	OBLIT(&b, "#else\n#define CEXP_PTR    .long\n#define CEXP_PTRALN .balign 4\n#endif\n\n");
+	OBLIT(&b, "/* info: type (0 TVoid, 1 TFuncP, 2 TVoidP) | flags (4 GLBL, 8 WEAK) */\n\n");
+	OBLIT(&b, "\t.data\n\tCEXP_PTRALN\n\t.globl cexpCompactSymbols\ncexpCompactSymbols:\n");
+	sprintf(hdr, "\t.long 0x%08x,%i,%i,%i\n", CSYM_MAGIC, CSYM_VERSION, c.nsyms, c.nstr);
+	obPuts(&b, hdr);
+	OBLIT(&b, "\tCEXP_PTR cexpCompactValues,cexpCompactOffsets,cexpCompactSizes,cexpCompactInfo,cexpCompactStrings\n");
+
+	obSection(&b, &c.values,  "cexpCompactValues",  "\tCEXP_PTRALN\n");
+	OBLIT(&b, "\n\t.section .rodata\n");
+	obSection(&b, &c.offsets, "cexpCompactOffsets", "\t.balign 4\n");
+	obSection(&b, &c.sizes,   "cexpCompactSizes",   "\t.balign 4\n");
+	obSection(&b, &c.info,    "cexpCompactInfo",    "");
+	obSection(&b, &c.strings, "cexpCompactStrings", "");
+
+	obClose(&b);
+	return 0;
+}
+
+/*
+ * Graph export ('--export'): the objects with their link set and size,
+ * the symbols and the cross-references, streamed from the ObjFRec and
+ * XrefRec arrays. The file name selects the format: '.dot'/'.gv'
+ * (graphviz) and '.graphml' are text (for small graphs; one edge per
+ * import, to the strongest export of its symbol), anything else is
+ * binary (native endian):
+ *
+ *   GRAPH_MAGIC, u32 nobjs, nsyms, nexports, nimports
+ *   objects (by seq):  string name, u32 link set (GRAPH_SET_XXX), u32 size
+ *   symbols:           string name (sorted by name; 'sym' is the index)
+ *   exports (CSR):     u32 first[nobjs + 1]; per export: u32 sym, size, type
+ *   imports (CSR):     u32 first[nobjs + 1]; per import: u32 sym, obj
+ *
+ * A string is its u32 length followed by the bytes (no NUL). The 'obj'
+ * of an import is the object with the strongest export of the symbol;
+ * object 0 is the pseudo object 'defining' all undefined symbols.
+ */
+#define GRAPH_MAGIC			"LDEPGR01"
+
+static long
+objSize(ObjF f);
+
+#define GRAPH_BINARY		0
+#define GRAPH_DOT			1
+#define GRAPH_GRAPHML		2
+
+#define GRAPH_SET_NONE		0
+#define GRAPH_SET_APP		1
+#define GRAPH_SET_OPTIONAL	2
+#define GRAPH_SET_UNDEF		3
+
+/* RETURNS the export format for file 'name' */
+static int
+graphFormat(const char *name)
+{
+const char *sfx = strrchr(name, '.');
+	if ( sfx && (!strcmp(sfx, ".dot") || !strcmp(sfx, ".gv")) )
+		return GRAPH_DOT;
+	if ( sfx && !strcmp(sfx, ".graphml") )
+		return GRAPH_GRAPHML;
+	return GRAPH_BINARY;
+}
+
+static unsigned
+graphSet(ObjF f)
+{
+	if ( f->link.anchor == &appLinkSet )
+		return GRAPH_SET_APP;
+	if ( f->link.anchor == &optionalLinkSet )
+		return GRAPH_SET_OPTIONAL;
+	if ( f->link.anchor == &undefLinkSet )
+		return GRAPH_SET_UNDEF;
+	return GRAPH_SET_NONE;
+}
+
+static INLINE void
+obU32(OutBuf b, uint32_t v)
+{
+	obWrite(b, (char*)&v, sizeof(v));
+}
+
+static void
+obString(OutBuf b, const char *s, int len)
+{
+	obU32(b, len);
+	obWrite(b, s, len);
+}
+
+/* Append 's' quoted for a DOT string or escaped for XML */
+static void
+obEscaped(OutBuf b, const char *s, int format)
+{
+const char *p;
+	for ( p = s; *p; p++ ) {
+		if ( GRAPH_DOT == format ) {
+			if ( '"' == *p || '\\' == *p )
+				OBLIT(b, "\\");
+			obWrite(b, p, 1);
+		} else switch ( *p ) {
+			case '&': OBLIT(b, "&amp;");  break;
+			case '<': OBLIT(b, "&lt;");   break;
+			case '>': OBLIT(b, "&gt;");   break;
+			case '"': OBLIT(b, "&quot;"); break;
+			default:  obWrite(b, p, 1);   break;
+		}
+	}
+}
+
+/* RETURNS the seq of the object with the strongest export of 's' */
+static INLINE uint32_t
+graphTarget(Sym s)
+{
+Xref ex = strongestExport(s);
+	return ex ? ex->obj->seq : 0;
+}
+
+static void
+writeGraphText(OutBuf b, int format)
+{
+ObjF	f;
+Xref	imp;
+int		i;
+char	buf[MAXBUF+1];
+
+	if ( GRAPH_DOT == format ) {
+		OBLIT(b, "digraph ldep {\n");
+	} else {
+		OBLIT(b, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		OBLIT(b, "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n");
+		OBLIT(b, "  <key id=\"name\" for=\"node\" attr.name=\"name\" attr.type=\"string\"/>\n");
+		OBLIT(b, "  <key id=\"set\" for=\"node\" attr.name=\"linkset\" attr.type=\"string\"/>\n");
+		OBLIT(b, "  <key id=\"size\" for=\"node\" attr.name=\"size\" attr.type=\"long\"/>\n");
+		OBLIT(b, "  <key id=\"sym\" for=\"edge\" attr.name=\"symbol\" attr.type=\"string\"/>\n");
+		OBLIT(b, "  <graph id=\"ldep\" edgedefault=\"directed\">\n");
+	}
+
+	for ( f = fileListHead; f; f = f->next ) {
+		sprintObjName(buf, sizeof(buf), f);
+		if ( GRAPH_DOT == format ) {
+			OBLIT(b, "  n");
+			obInt(b, f->seq);
+			OBLIT(b, " [label=\"");
+			obEscaped(b, buf, format);
+			OBLIT(b, "\", linkset=\"");
+			obPuts(b, f->link.anchor ? f->link.anchor->name : "");
+			OBLIT(b, "\", size=");
+			obInt(b, (int)objSize(f));
+			OBLIT(b, "];\n");
+		} else {
+			OBLIT(b, "    <node id=\"n");
+			obInt(b, f->seq);
+			OBLIT(b, "\"><data key=\"name\">");
+			obEscaped(b, buf, format);
+			OBLIT(b, "</data><data key=\"set\">");
+			obPuts(b, f->link.anchor ? f->link.anchor->name : "");
+			OBLIT(b, "</data><data key=\"size\">");
+			obInt(b, (int)objSize(f));
+			OBLIT(b, "</data></node>\n");
+		}
+	}
+
+	for ( f = fileListHead; f; f = f->next ) {
+		for ( i = 0, imp = f->imports; i < f->nimports; i++, imp++ ) {
+			if ( GRAPH_DOT == format ) {
+				OBLIT(b, "  n");
+				obInt(b, f->seq);
+				OBLIT(b, " -> n");
+				obInt(b, graphTarget(imp->sym));
+				OBLIT(b, " [label=\"");
+				obEscaped(b, imp->sym->name, format);
+				OBLIT(b, "\"];\n");
+			} else {
+				OBLIT(b, "    <edge source=\"n");
+				obInt(b, f->seq);
+				OBLIT(b, "\" target=\"n");
+				obInt(b, graphTarget(imp->sym));
+				OBLIT(b, "\"><data key=\"sym\">");
+				obEscaped(b, imp->sym->name, format);
+				OBLIT(b, "</data></edge>\n");
+			}
+		}
+	}
+
+	if ( GRAPH_DOT == format )
+		OBLIT(b, "}\n");
+	else
+		OBLIT(b, "  </graph>\n</graphml>\n");
+}
+
+/*
+ * Symbol ids of the binary graph: the symbols are numbered in
+ * symTblWalk() order (by name) so that the export doesn't depend
+ * on the layout of the symbol table. While the graph is written
+ * the 'refcnt' of every symbol holds its id (the counts are saved
+ * in 'refcnt[id]' and put back by graphSymIdsRestore()).
+ */
+typedef struct GraphSymIdsRec_ {
+	OutBuf		b;
+	int			*refcnt;
+	uint32_t	n;
+} GraphSymIdsRec, *GraphSymIds;
+
+/* symTblWalk() action: number 's' and write its name */
+static void
+graphSymId(Sym s, void *closure)
+{
+GraphSymIds c = closure;
+	c->refcnt[c->n] = s->refcnt;
+	s->refcnt       = c->n++;
+	obString(c->b, s->name, s->len);
+}
+
+static void
+graphSymIdsRestore(GraphSymIds c)
+{
+unsigned	k;
+Sym			s;
+	for ( k = 0; k < symTbl.size; k++ ) {
+		if ( (s = symTbl.slots[k].sym) )
+			s->refcnt = c->refcnt[s->refcnt];
+	}
+	free(c->refcnt);
+}
+
+static void
+writeGraphBinary(OutBuf b)
+{
+ObjF			f;
+Xref			x;
+int				i;
+uint32_t		nexp = 0, nimp = 0, n;
+GraphSymIdsRec	ids;
+char			buf[MAXBUF+1];
+
+#define GRAPH_SYMID(s)	((uint32_t)(s)->refcnt)
+
+	for ( f = fileListHead; f; f = f->next ) {
+		nexp += f->nexports;
+		nimp += f->nimports;
+	}
+
+	obWrite(b, GRAPH_MAGIC, strlen(GRAPH_MAGIC));
+	obU32(b, numFiles);
+	obU32(b, symTbl.nsyms);
+	obU32(b, nexp);
+	obU32(b, nimp);
+
+	for ( n = 0, f = fileListHead; f; f = f->next ) {
+		/* the seq numbers the objects references use */
+		assert( f->seq == (int)n++ );
+		sprintObjName(buf, sizeof(buf), f);
+		obString(b, buf, strlen(buf));
+		obU32(b, graphSet(f));
+		obU32(b, objSize(f));
+	}
+
+	ids.b = b;
+	ids.n = 0;
+	assert( ids.refcnt = malloc((symTbl.nsyms ? symTbl.nsyms : 1) * sizeof(*ids.refcnt)) );
+	symTblWalk(&symTbl, graphSymId, &ids);
+	assert( ids.n == symTbl.nsyms );
+
+	for ( n = 0, f = fileListHead; f; f = f->next ) {
+		obU32(b, n);
+		n += f->nexports;
+	}
+	obU32(b, n);
+	for ( f = fileListHead; f; f = f->next ) {
+		for ( i = 0, x = f->exports; i < f->nexports; i++, x++ ) {
+			obU32(b, GRAPH_SYMID(x->sym));
+			obU32(b, x->size);
+			obU32(b, (unsigned char)TYPE(x));
+		}
+	}
+
+	for ( n = 0, f = fileListHead; f; f = f->next ) {
+		obU32(b, n);
+		n += f->nimports;
+	}
+	obU32(b, n);
+	for ( f = fileListHead; f; f = f->next ) {
+		for ( i = 0, x = f->imports; i < f->nimports; i++, x++ ) {
+			obU32(b, GRAPH_SYMID(x->sym));
+			obU32(b, graphTarget(x->sym));
+		}
+	}
+#undef GRAPH_SYMID
+
+	graphSymIdsRestore(&ids);
+}
+
+/* Export the object graph to 'feil' in 'format' (GRAPH_XXX) */
+int
+writeGraph(FILE *feil, int format)
+{
+OutBufRec b;
+
+	obInit(&b, feil);
+	if ( GRAPH_BINARY == format )
+		writeGraphBinary(&b);
+	else
+		writeGraphText(&b, format);
+	obClose(&b);
+	return 0;
+}
+
+static void 
+usage(const char *nm)
+{
+const char *strip = strrchr(nm,'/');
+	if (strip)
+		nm = strip+1;
+	fprintf(stderr,"\nUsage: %s [-BDIOPRdfhilmqsuv] [-A main_symbol] [-c db_file] [-j threads] [-S socket] [-L path] [-o optional_list] [-x exclude_list] [-e script_file] [-C src_file] [-K asm_file] nm_files\n\n", nm);
+	fprintf(stderr,"   Object file dependency analysis; the input files must be\n");
+	fprintf(stderr,"   created with 'nm -g -fposix' - or be ELF objects or 'ar' archives (of ELF\n");
+	fprintf(stderr,"   objects) which are then read directly.\n\n");
+	fprintf(stderr,"(This is ldep %s by Till Straumann <strauman@slac.stanford.edu>)\n\n", GITREV);
+	fprintf(stderr,"   Input:\n");
+	fprintf(stderr,"           If no 'nm_files' are given, 'stdin' is used. The first 'nm_file' is\n");
+	fprintf(stderr,"           special (unless using -A, see below): it lists MANDATORY objects/symbols\n");
+    fprintf(stderr,"           (AKA 'application files').\n");
+	fprintf(stderr,"           objects added by the other 'nm_files' are 'optional' unless a mandatory\n");
+	fprintf(stderr,"           object depends on an optional object. In this case, the latter becomes\n");
+	fprintf(stderr,"           mandatory as well.\n\n");
+
+	fprintf(stderr,"   Options:\n");
+	fprintf(stderr,"     -A:   use 'main_symbol' to construct the set of mandatory objects - anything\n");
+	fprintf(stderr,"           (directly or indirectly) needed by the object defining 'main_symbol' is\n");
+	fprintf(stderr,"           mandatory.\n");
+	fprintf(stderr,"           NOTE: The first 'nm_file' is NOT treated special if this option is used.\n");
+	fprintf(stderr,"     -B:   batch unlinking: remove the objects depending on all undefined symbols\n");
+	fprintf(stderr,"           (or on all members of an 'exclude_list') in a single pass (same result)\n");
+	fprintf(stderr,"     -c:   cache the database (after scanning all 'nm_files') in 'db_file'; if the\n");
+	fprintf(stderr,"           'nm_files' (and '-f') are unchanged since 'db_file' was written then\n");
+	fprintf(stderr,"           the database is loaded from there instead of scanning\n");
+	fprintf(stderr,"     -I:   incremental mode: with '-c', only cache all but the first 'nm_file' (the\n");
+	fprintf(stderr,"           application is always scanned); the objects the previous run removed\n");
+	fprintf(stderr,"           because of undefined symbols (saved in '<db_file>.state') are removed\n");
+	fprintf(stderr,"           again without re-checking them if the application's changes allow it;\n");
+	fprintf(stderr,"           the files generated by '-e' and '-C' are only replaced if their contents\n");
+	fprintf(stderr,"           change\n");
+	fprintf(stderr,"     -R:   reproducible output: the objects of every link set are written sorted by\n");
+	fprintf(stderr,"           library and object name, their symbols by name; like with '-I' the output\n");
+	fprintf(stderr,"           files ('-e', '-C', '-K') are written to a temporary file and only replace\n");
+	fprintf(stderr,"           the target if the contents differ (an unchanged file keeps its mtime)\n");
+	fprintf(stderr,"     -F:   tolerate/ignore failure when processing 'exclude_lists'\n");
+	fprintf(stderr,"     -L:   add 'path' to search path for 'nm_files', 'optional_lists' and 'exclude_lists'\n");
+	fprintf(stderr,"           NOTE: if at least one '-L' is present, '.' must explicitely added.'\n");
+	fprintf(stderr,"     -O:   when generating a script (see -e), only list the optional link set\n");
+	fprintf(stderr,"     -P:   pre-size the symbol table from the sizes of the 'nm_files' (avoids\n");
+	fprintf(stderr,"           rehashing while scanning large inputs)\n");
+	fprintf(stderr,"     -o:   add a list of optional objects to the link - name them, one per line, in\n");
+    fprintf(stderr,"           the file 'optional_list'. Object names must be appended a ':', e.g. 'blah.o:'!\n");
+	fprintf(stderr,"           NOTES: - multiple '-o' and '-x' options may be present. The respective files\n");
+	fprintf(stderr,"                    are processed in the order the options are given on the command line\n");
+	fprintf(stderr,"                  - if at least one '-o' option is present, the 'optional nm_files' are\n");
+	fprintf(stderr,"                    merely added to the database but NOT linked/added to the application,\n");
+	fprintf(stderr,"                    ONLY objects listed in '-o' files are.\n");
+	fprintf(stderr,"                  - names may contain the wildcards '*' and '?' and then stand for\n");
+	fprintf(stderr,"                    all objects matching, e.g. 'libbsd.a[*]:' or '[*socket*]:'\n");
+	fprintf(stderr,"     -d:   show all module dependencies (huge amounts of data! -- use '-l', '-u')\n");
+	fprintf(stderr,"     -D:   show all module dependencies in compact form: groups of mutually\n");
+	fprintf(stderr,"           dependent objects and, per group, all groups requiring it\n");
+	fprintf(stderr,"     -j:   use up to 'threads' threads (for scanning 'nm_files', for '-D' and,\n");
+	fprintf(stderr,"           with '-B', for computing the closures of '-x' list entries)\n");
+	fprintf(stderr,"     -e:   on success, generate a linker script 'script_file' with EXTERN statements\n");
+	fprintf(stderr,"     -C:   on success, generate a C-source file with CEXP symbol table definitions\n");
+	fprintf(stderr,"     -K:   on success, generate the CEXP symbol table in compact form: assembler\n");
+	fprintf(stderr,"           source ('.S', needs the C preprocessor) with a string table and packed\n");
+	fprintf(stderr,"           arrays ('cexpCompactSymbols')\n");
+	fprintf(stderr,"     -U:   add undefined symbols in the application link set to the CEXP symbol\n");
+	fprintf(stderr,"           table definitions (assuming they will be supplied by the linker, startfiles or libraries of which no '.nm' file was provided\n");
+	fprintf(stderr,"     -f:   be less paranoid when scanning symbols: accept 'local symbols' (map all\n");
+	fprintf(stderr,"           types to upper-case) and assume unrecognized symbol types ('?') are 'U'\n");
+	fprintf(stderr,"     -h:   print this message.\n");
+	fprintf(stderr,"     -v:   print version info.\n");
+	fprintf(stderr,"     -i:   enter interactive mode (symbol/object queries, also with wildcards)\n");
+	fprintf(stderr,"     -l:   log info about the linking process\n");
+	fprintf(stderr,"     -q:   quiet; just build database and do basic checks\n");
+	fprintf(stderr,"     -S:   when done, serve queries (what '-i' offers and more) on the Unix socket\n");
+	fprintf(stderr,"           'socket'; send 'help' over the socket for a list of requests\n");
+	fprintf(stderr,"  -t <sym> trace symbol 'sym' and log info (may use multiple times)\n");
+	fprintf(stderr,"     -x:   exclude/remove a list of objects from the link - name them, one per line, in\n");
+	fprintf(stderr,"           the file 'exclude_list'\n");
+	fprintf(stderr,"           NOTES: - if a mandatory object depends on an object to be removed, removal\n");
+	fprintf(stderr,"                    is rejected.\n");
+	fprintf(stderr,"                  - object names must be appended a ':', e.g. 'blah.o:' - other lines are\n");
+	fprintf(stderr,"                    ignored. Thus, output from 'nm -fposix' is accepted.\n");
+	fprintf(stderr,"     -s:   show all symbol info (huge amounts of data! -- use '-l', '-u')\n");
+	fprintf(stderr,"     -u:   log info about the unlinking process\n");
+	fprintf(stderr,"  --paranoid: run expensive consistency checks (e.g., work list circularity\n");
+	fprintf(stderr,"           on every edge followed by a dependency walk)\n");
+	fprintf(stderr,"  --stats: print the time spent in the processing phases, counters (lines,\n");
+	fprintf(stderr,"           symbols, cross-references, dependency walks, ...) and peak memory use\n");
+	fprintf(stderr,"           to stderr when done\n");
+	fprintf(stderr,"  --stats-json=file: write the same in JSON form to 'file'\n");
+	fprintf(stderr,"  --list-undefs: list the undefined symbols (by default, only their number\n");
+	fprintf(stderr,"           is printed)\n");
+	fprintf(stderr,"  --low-mem: release the 'nm_file' buffers (copying the symbol names) and the\n");
+	fprintf(stderr,"           indices as soon as they are no longer needed; '--stats' reports\n");
+	fprintf(stderr,"           how much was released\n");
+	fprintf(stderr,"  --config=name: start a named configuration; the '-o', '-x', '-e', '-C', '-K'\n");
+	fprintf(stderr,"           and '--export' options following it belong to it. Every configuration\n");
+	fprintf(stderr,"           is evaluated on the same database (loaded once) with the same result\n");
+	fprintf(stderr,"           as a separate run with just its options; those preceding the first\n");
+	fprintf(stderr,"           '--config' form an unnamed one (skipped if empty)\n");
+	fprintf(stderr,"  --impact=symbol|lib[obj]: when done, show what '-x' of the object (defining\n");
+	fprintf(stderr,"           'symbol') would remove and the size of its definitions, or which\n");
+	fprintf(stderr,"           application object prevents it; may be repeated\n");
+	fprintf(stderr,"  --export=file: when done, write the object graph (objects with link set and\n");
+	fprintf(stderr,"           size, symbols, exports and imports) to 'file': Graphviz for '.dot'/'.gv',\n");
+	fprintf(stderr,"           GraphML for '.graphml' (both for small graphs), otherwise a compact\n");
+	fprintf(stderr,"           binary (CSR) format\n");
+	fprintf(stderr,"  --trace-events=file: record the link/unlink decisions (as '-l' and '-u' log\n");
+	fprintf(stderr,"           them) as compact binary events in 'file'\n");
+	fprintf(stderr,"  --trace-show=file: print the events recorded in trace 'file' as text and exit\n");
+	fprintf(stderr,"\n"
+				   "   NOTES:\n");
+	fprintf(stderr,"\n"
+				   "     -     '-o' and '-x' files may contain 'C-style' comments ('/* */') with the restriction\n");
+	fprintf(stderr,"           that a comment must not split an input line (but a comment may start on one line\n");
+	fprintf(stderr,"           and end on another line, i.e.\n");
+	fprintf(stderr,"               'blah/* is */illegal:'\n");
+	fprintf(stderr,"               'blah:/* is \n");
+	fprintf(stderr,"                legal*/foo:\n");
+}
+
+/*
+ * Find the object named 'arg' ('lib[obj]' or '[obj]'; may contain
+ * wildcards) or defining the symbol 'arg'; RETURNS the number of
+ * objects found (*pfound points to an array of them).
+ */
+static int
+queryFindObjs(FILE *feil, char *arg, ObjF **pfound)
 {
-CheckArg arg  = closure;
-	if (depth > f->workDepth && f == arg->test)
-		arg->result = -1;
+static ObjF	def;
+Sym			sym;
+int			nf = 0;
+
+	if ( *arg && ']' == arg[strlen(arg)-1] ) {
+		if ( !(nf = hasWildcard(arg) ? objSearch(arg, pfound) : fileListFind(arg, pfound)) )
+			fprintf(feil,"object '%s' not found\n", arg);
+	} else if ( !(sym = symTblFind(&symTbl, arg)) ) {
+		fprintf(feil,"Symbol '%s' not found\n", arg);
+	} else if ( symIsUndef(sym) ) {
+		fprintf(feil,"Symbol '%s' is not defined by any object\n", arg);
+	} else {
+		def      = strongestExport(sym)->obj;
+		*pfound  = &def;
+		nf       = 1;
+	}
+	return nf;
 }
 
-int checkCircWorkList(ObjF f)
+/*
+ * "What-if" queries ('--impact', interactive mode, server 'impact'
+ * request): what '-x' of an object would remove, which member of the
+ * application link set blocks it and how much code and data goes away.
+ *
+ * The application closure (appClosure()) serves as the index: an object
+ * can be removed unless it is a member and then the chain it was reached
+ * along ends at the blocking application object. The closure doesn't
+ * change once linking is done (none of its members can be unlinked), so
+ * it is computed only once; a query costs no more than the edges of the
+ * objects it removes.
+ */
+typedef struct ImpactRec_ {
+	ObjF	reject;		/* application link set member blocking the removal (or NULL) */
+	int		nobjs;		/* number of linked objects removed */
+	long	size;		/* sum of the sizes of their definitions */
+} ImpactRec, *Impact;
+
+static WalkSetRec	impactApp   = { 0 };
+static int			impactReady = 0;
+
+/* RETURNS the size of the definitions of 'f' */
+static long
+objSize(ObjF f)
 {
-CheckArgRec arg;
-	arg.test   = f;
-	arg.result = 0;
-	workListIterate(f, circCheckAction, &arg);
-	return arg.result;
+long	rval = 0;
+Xref	ex;
+int		i;
+
+	for ( i=0, ex=f->exports; i<f->nexports; i++, ex++ ) {
+		if ( !ISUNDEF( TYPE(ex) ) )
+			rval += ex->size;
+	}
+	return rval;
 }
 
-/* Depwalk action for printing node info */
-void
-depPrint(ObjF f, int d, void *closure)
+/* Find out what '-x f' would do; what it removes is left in 'rem' (empty if rejected) */
+static void
+impactQuery(ObjF f, WalkSet rem, Impact res)
 {
-DepPrintArg  arg  = (DepPrintArg)closure;
-FILE		*feil = arg->file;
+int k;
 
-	if (d < arg->minDepth)
+	if ( !impactReady ) {
+		appClosure(&impactApp);
+		impactReady = 1;
+	}
+	memset(res, 0, sizeof(*res));
+	walkSetInit(rem);
+
+	if ( walkSetHas(&impactApp, f) ) {
+		for ( k = impactApp.idx[f->seq]; impactApp.nodes[k].from >= 0; k = impactApp.nodes[k].from )
+			/* nothing else to do */;
+		res->reject = impactApp.nodes[k].obj;
 		return;
+	}
 
-	if (!feil)
-		feil = logf;
+	walkSetAdd(rem, f, 0, -1);
+	walkSetClose(rem, 0, WALK_EXPORTS);
 
-	if (arg->depthIndent >= 0)
-		d <<= arg->depthIndent;
-	else
-		d = 0;
-	d += arg->indent;
-	while (d-- > 0)
-		fputc(' ', feil);
+	for ( k=0; k<rem->n; k++ ) {
+		if ( rem->nodes[k].obj->link.anchor ) {
+			res->nobjs++;
+			res->size += objSize(rem->nodes[k].obj);
+		}
+	}
+}
+
+/* Print what '-x f' would do */
+static void
+impactReport(FILE *feil, ObjF f)
+{
+static WalkSetRec	rem = { 0 };
+ImpactRec			res;
+int					k;
+
+	fprintf(feil,"Removing '");
 	printObjName(feil, f);
-	fputc('\n', feil);
+	if ( !f->link.anchor ) {
+		fprintf(feil,"': currently not part of any link set.\n");
+		return;
+	}
+
+	impactQuery(f, &rem, &res);
+
+	if ( res.reject ) {
+		fprintf(feil,"' would be rejected because '");
+		printObjName(feil, res.reject);
+		fprintf(feil,"' is needed by app\n");
+		logAppDependency(feil, &impactApp, f);
+		return;
+	}
+
+	fprintf(feil,"' removes %i object%s (%li bytes):\n", res.nobjs, 1 == res.nobjs ? "" : "s", res.size);
+	for ( k=0; k<rem.n; k++ ) {
+		if ( !rem.nodes[k].obj->link.anchor )
+			continue;
+		fprintf(feil,"    ");
+		printObjName(feil, rem.nodes[k].obj);
+		fprintf(feil," (%li bytes", objSize(rem.nodes[k].obj));
+		if ( rem.nodes[k].via )
+			fprintf(feil,", because of '%s'", rem.nodes[k].via->sym->name);
+		fprintf(feil,")\n");
+	}
 }
 
 /*
- * Compare two objects by name. If the names match,
- * the library names are compared unless any of the
- * library pointers has the special value 'MATCH_ANY'
+ * Print the matches 'first' .. 'first + max - 1' of the wildcard
+ * pattern 'pat' (objects if it ends in ']', symbols otherwise) along
+ * with the object defining a symbol or the link set of an object.
+ *
+ * RETURNS: the total number of matches.
  */
 static int
-objcmp(const void *a, const void *b)
+queryMatches(FILE *feil, char *pat, int first, int max)
 {
-ObjF	obja=*(ObjF*)a;
-ObjF	objb=*(ObjF*)b;
-int		rval;
+Sym		*syms;
+ObjF	*objs;
+int		n, i;
+int		isObj = *pat && ']' == pat[strlen(pat)-1];
+
+	n = isObj ? objSearch(pat, &objs) : symSearch(pat, &syms);
+
+	for ( i = first; i < n && i - first < max; i++ ) {
+		fprintf(feil,"  ");
+		if ( isObj ) {
+			printObjName(feil, objs[i]);
+			fprintf(feil," (%s)\n", objs[i]->link.anchor ? objs[i]->link.anchor->name : "not linked");
+		} else if ( symIsUndef(syms[i]) ) {
+			fprintf(feil,"%s (undefined)\n", syms[i]->name);
+		} else {
+			fprintf(feil,"%s (", syms[i]->name);
+			printObjName(feil, strongestExport(syms[i])->obj);
+			fprintf(feil,")\n");
+		}
+	}
+	if ( !n )
+		fprintf(feil,"Nothing matches '%s'\n", pat);
+	return n;
+}
 
-	if (rval = strcmp(obja->name, objb->name))
-		return rval;
+#define QUERY_PAGE	20		/* matches shown at once in interactive mode */
 
-	if (MATCH_ANY == obja->lib  || MATCH_ANY == objb->lib)
-		return 0;
+/* Primitive interactive command interpreter (database queries) */
+int
+interactive(FILE *feil)
+{
+Sym		found;
+ObjF	*f;
+char	buf[MAXBUF+1];
+char	more[MAXBUF+1];
+int		len, nf, i, choice;
 
-	/* matching object names; compare libraries */
-	if (obja->lib) {
-		if (objb->lib) {
-			return libcmp(obja->lib->name, objb->lib->name);
-		} else
-			return 1; /* a has library name, b has not b<a */
-	}
-	rval = objb->lib ? -1 : 0;
+	buf[0]=0;
 
-	return rval;
-}
+	buf[MAXBUF]='0';
 
-/* Build a sorted index of all objects */
-ObjF *
-fileListBuildIndex()
-{
-ObjF *rval;
-ObjF f;
-int  i;
+	do {
+		if ( MAXBUF == (len=strlen(buf)) ) {
+			fprintf(stderr,"Line buffer overflow in interactive mode\n");
+			return -1;
+		}
 
-	assert( rval = malloc(numFiles * sizeof(*rval)) );
-	for ( i=0, f = fileListHead; f; i++, f=f->next) {
-		rval[i] = f;
-	}
-	qsort(rval, numFiles, sizeof(*rval), objcmp);
-	return rval;
+		if ( !*buf || '\n'==*buf ) {
+			fputc('\n',feil);
+			fprintf(feil, "Query database (enter single '.' to quit) for\n");
+			fprintf(feil, " A) Symbols, e.g. 'printf'\n");
+			fprintf(feil, " B) Objects, e.g. '[printf.o]', 'libc.a[printf.o]'\n");
+			fprintf(feil, " C) What '-x' would remove, e.g. '-x printf', '-x libc.a[printf.o]'\n");
+			fprintf(feil, " D) Wildcard searches ('*', '?'), e.g. 'pthread_*', 'libbsd.a[*socket*]'\n\n");
+		} else {
+			buf[--len]=0; /* strip trailing '\n' */
+			if ( !strncmp(buf, "-x ", 3) ) {
+				for ( i = 3; isspace(((unsigned char*)buf)[i]); i++ )
+					/* nothing else to do */;
+				nf = queryFindObjs(feil, buf + i, &f);
+				for ( i = 0; i < nf; i++ )
+					impactReport(feil, f[i]);
+			} else if ( hasWildcard(buf) ) {
+				for ( i = 0; (nf = queryMatches(feil, buf, i, QUERY_PAGE)) > i + QUERY_PAGE; i += QUERY_PAGE ) {
+					fprintf(feil, "-- %i more; <Enter> to continue, '.' to stop --\n", nf - i - QUERY_PAGE);
+					if ( !fgets(more, sizeof(more), stdin) || '.' == *more )
+						break;
+				}
+			} else if ( ']' == buf[len-1] ) {
+				nf = fileListFind(buf, &f);
+
+				if ( !nf ) {
+					fprintf(feil,"object '%s' not found, try again.\n", buf);
+				} else {
+					choice = 0;
+					if ( nf > 1 ) {
+						fprintf(feil,"multiple instances found, make a choice:\n");
+						for (i = 0; i<nf; i++) {
+							fprintf(feil,"%i) - ",i); printObjName(feil, f[i]); fputc('\n', feil);
+						}
+
+						while (    !fgets( buf, MAXBUF, stdin) ||
+								 1 !=sscanf(buf,"%i",&choice)  ||
+								 choice < 0                    ||
+								 choice >= nf ) {
+
+								if ( !strcmp(".\n",buf) )
+									return 0;
+
+								fprintf(feil, "\nInvalid Choice, ");
+								
+								if (!*buf) {
+									fprintf(feil,"bailing out\n");
+									return -1;
+								}
+
+								fprintf(feil,"try again\n");
+								*buf = 0;
+						}
+
+
+					}
+					trackObj(feil, f[choice]);
+				}
+			} else {
+				found = symTblFind(&symTbl, buf);
+
+				if ( !found ) {
+					fprintf(feil,"Symbol '%s' not found, try again\n", buf);
+				} else {
+					trackSym(feil, found);
+				}
+			}
+		}
+	} while ( fgets(buf, MAXBUF, stdin) && *buf && strcmp(buf,".\n") );
 }
 
 /*
- * Find an object with 'name' in the index of all objects.
+ * Server mode ('-S'): keep the database resident and answer queries
+ * on a Unix domain socket. The protocol is line based; every request
+ * is a single line
  *
- * Return the number of matches found.
- * A pointer to the first match in the index
- * array is returned in *pfound.
+ *   sym <symbol>          what trackSym() prints
+ *   obj <lib[obj]>        what trackObj() prints (for every match)
+ *   why <symbol|lib[obj]> who pulls the object (defining the symbol) in
+ *   unlink <symbol|lib[obj]>
+ *                         what '-x' of the object would remove
+ *   impact <symbol|lib[obj]>
+ *                         the same with sizes, or the application
+ *                         object blocking it (impactReport())
+ *   find <pattern> [first]
+ *                         symbols (objects if 'pattern' ends in ']')
+ *                         matching a wildcard pattern; SERVER_PAGE of
+ *                         them starting with match number 'first'
+ *   help                  list requests
+ *   quit                  close the connection
+ *   shutdown              terminate the server
  *
- * 'name' is temporarily edited.
+ * and every reply is terminated by a line holding a single '.'.
+ * Queries see the database after all processing (link sets as
+ * written to the linker script).
  */
-int
-fileListFind(char *name, ObjF **pfound)
+#define SERVER_MAX_CLIENTS	64
+#define SERVER_PAGE			100
+
+#define SERVER_MAX_PENDING	(4<<20)	/* a client with more unsent replies is dropped */
+#define SERVER_TOO_LONG		"Line too long\n.\n"
+
+/*
+ * Client sockets are non-blocking: the replies are buffered and sent
+ * as the client reads them, and no more requests are read from a client
+ * while it has replies pending.
+ */
+typedef struct ClientRec_ {
+	int		fd;
+	int		closing;	/* close when the replies are sent */
+	int		len;
+	char	buf[MAXBUF+1];
+	char	*out;		/* replies, 'osent' of 'olen' bytes sent */
+	size_t	olen, osent, oavail;
+} ClientRec, *Client;
+
+/* who pulls in 'f' */
+static void
+serverWhy(FILE *feil, ObjF f)
 {
-char	*objn, *po, *pc;
-ObjFRec	frec = {0};
-ObjF	f    = &frec;
-Lib		l;
-ObjF	*found, *end;
-int		rval = 0;
+WalkSetRec	app = { 0 };
+Xref		ex, imp;
+int			i, n = 0;
 
-	if ( ! (objn=splitName(name,&po,&pc)) ) {
-		return 0; /* ill-formed name */
+	printObjName(feil, f);
+	if ( !f->link.anchor ) {
+		fprintf(feil," is currently not part of any link set.\n");
+		return;
 	}
+	fprintf(feil," is a member of the %s link set\n", f->link.anchor->name);
 
-	f->name = objn;
-
-	if (po && *name) {
-		for (l=libListHead; l; l=l->next) {
-			if ( !libcmp(l->name, name) ) {
-				break;
-			}
-		}
-		if (!l) {
-			goto cleanup;
+	fprintf(feil,"  Imported by:\n");
+	for ( i=0, ex=f->exports; i<f->nexports; i++, ex++ ) {
+		if ( strongestExport(ex->sym)->obj != f )
+			continue;
+		for ( imp = ex->sym->importedFrom; imp; imp = XREF_NEXT(imp) ) {
+			fprintf(feil,"    ");
+			printObjName(feil, imp->obj);
+			fprintf(feil," (because of '%s')\n", ex->sym->name);
+			n++;
 		}
-		f->lib = l;
-	} else  {
-		f->lib = MATCH_ANY;
 	}
+	if ( !n )
+		fprintf(feil,"    NONE\n");
 
-	if ( ! (found = bsearch(&f, fileListIndex, numFiles, sizeof(f), objcmp)) )
-		goto cleanup;
-
-	/* find all matches */
-	end = found;
-	while ( ++end < fileListIndex + numFiles && !objcmp(&f,end) )
-		/* nothing else to do */;
-
-	while (--found >= fileListIndex && !objcmp(&f, found))
-		/* nothing else to do */;
+	appClosure(&app);
+	if ( walkSetHas(&app, f) )
+		logAppDependency(feil, &app, f);
+	else
+		fprintf(feil," -- not needed by application\n");
+	walkSetFree(&app);
+}
 
-	found++;
+/* what unlinkObj() would remove */
+static void
+serverUnlink(FILE *feil, ObjF f)
+{
+DepPrintArgRec	arg;
+ObjF			reject = 0;
+int				saved  = verbose;
 
-	if (pfound)
-		*pfound = found;
+	if ( !f->link.anchor ) {
+		printObjName(feil, f);
+		fprintf(feil," is currently not part of any link set.\n");
+		return;
+	}
 
-	rval = end-found;
+	arg.minDepth    = 0;
+	arg.indent      = 4;
+	arg.depthIndent = -1;
+	arg.file		= feil;
 
-cleanup:
-	if (po) {
-		*po = '[';
-		*pc = ']';
+	fprintf(feil,"Unlinking '");
+	printObjName(feil, f);
+	fprintf(feil,"' removes:\n");
+
+	depwalk(&depwalkMain, f, depPrint, (void*)&arg, WALK_EXPORTS | WALK_BUILD_LIST);
+	/* checkSysLinkSet() must not log */
+	verbose &= ~DEBUG_UNLINK;
+	workListIterate(&depwalkMain, f, checkSysLinkSet, &reject);
+	verbose  = saved;
+	depwalkListRelease(&depwalkMain, f);
+
+	if ( reject ) {
+		fprintf(feil,"Unlinking would be rejected because '");
+		printObjName(feil, reject);
+		fprintf(feil,"' is needed by app\n");
 	}
-	return rval;
 }
 
-/* My private versions of getc, ungetc. They operate
- * on a string buffer (*pchpt) until it's empty and then
- * switch to the stream 'f'.
- * These routines are mainly used to skip comments in
- * the 'remove_list' file.
- */
-static int mygc(char **pchpt, FILE *f)
+/* Answer a request; RETURNS 1 to close the connection, 2 to shut down, 0 otherwise */
+static int
+serverQuery(FILE *feil, char *line)
 {
-int rval;
-	if (*pchpt) {
-		rval = *((*pchpt)++);
-		if (!**pchpt)
-			*pchpt = 0;
-	} else {
-		rval = getc(f);
+char	*arg, *end;
+ObjF	*f;
+int		nf, i;
+long	l;
+
+	for ( arg = line; *arg && !isspace(*(unsigned char*)arg); arg++ )
+		/* nothing else to do */;
+	if ( *arg )
+		*arg++ = 0;
+	while ( isspace(*(unsigned char*)arg) )
+		arg++;
+
+	if ( !strcmp(line, "quit") ) {
+		return 1;
+	} else if ( !strcmp(line, "shutdown") ) {
+		return 2;
+	} else if ( !strcmp(line, "sym") ) {
+		Sym found = symTblFind(&symTbl, arg);
+		if ( !found )
+			fprintf(feil,"Symbol '%s' not found\n", arg);
+		else
+			trackSym(feil, found);
+	} else if ( !strcmp(line, "obj") ) {
+		if ( !(nf = fileListFind(arg, &f)) )
+			fprintf(feil,"object '%s' not found\n", arg);
+		for ( i = 0; i < nf; i++ )
+			trackObj(feil, f[i]);
+	} else if ( !strcmp(line, "why") ) {
+		nf = queryFindObjs(feil, arg, &f);
+		for ( i = 0; i < nf; i++ )
+			serverWhy(feil, f[i]);
+	} else if ( !strcmp(line, "unlink") ) {
+		nf = queryFindObjs(feil, arg, &f);
+		for ( i = 0; i < nf; i++ )
+			serverUnlink(feil, f[i]);
+	} else if ( !strcmp(line, "find") ) {
+		char *pat = arg;
+		for ( ; *arg && !isspace(*(unsigned char*)arg); arg++ )
+			/* nothing else to do */;
+		if ( *arg )
+			*arg++ = 0;
+		l = strtol(arg, &end, 10);
+		while ( isspace(*(unsigned char*)end) )
+			end++;
+		if ( *end || l < 0 || l > INT_MAX - SERVER_PAGE ) {
+			fprintf(feil,"Invalid first match '%s' (try 'help')\n", arg);
+			return 0;
+		}
+		i  = l;
+		nf = queryMatches(feil, pat, i, SERVER_PAGE);
+		if ( nf - i > SERVER_PAGE )
+			fprintf(feil,"%i more (find %s %i)\n", nf - i - SERVER_PAGE, pat, i + SERVER_PAGE);
+	} else if ( !strcmp(line, "impact") ) {
+		nf = queryFindObjs(feil, arg, &f);
+		for ( i = 0; i < nf; i++ )
+			impactReport(feil, f[i]);
+	} else if ( !strcmp(line, "help") ) {
+		fprintf(feil,"sym <symbol>              show info about a symbol\n");
+		fprintf(feil,"obj <lib[obj]>            show info about an object\n");
+		fprintf(feil,"why <symbol|lib[obj]>     show who pulls an object in\n");
+		fprintf(feil,"unlink <symbol|lib[obj]>  show what removing an object would remove\n");
+		fprintf(feil,"impact <symbol|lib[obj]>  the same with sizes (or what blocks it)\n");
+		fprintf(feil,"find <pattern> [first]    list symbols/objects ('lib[obj]') matching a pattern\n");
+		fprintf(feil,"quit                      close connection\n");
+		fprintf(feil,"shutdown                  terminate server\n");
+	} else if ( *line ) {
+		fprintf(feil,"Unknown request '%s' (try 'help')\n", line);
 	}
-	return rval;
+	return 0;
 }
 
-static int myugc(int ch, char **pchpt, FILE *f)
+static void
+clientClose(Client c)
 {
-	return !*pchpt ? ungetc(ch,f) : (*(--(*pchpt)) = (unsigned char)ch);
+	close(c->fd);
+	free(c->out);
+	c->out  = 0;
+	c->olen = c->osent = c->oavail = 0;
+	c->fd   = -1;
 }
 
-/*
- * (Un)link all files listed in the file 'fname' along with
- * objects depending on them.
- *
- * RETURNS: 0 on success,
- *          NONZERO on failure:
- *             -4 list file not found
- *             -3 listed object member name needs more qualification
- *             -2 listed object not found
- *             -1 listed object member of Application link set
- *                (this error is ignored 
- *             These errors may be ignored by setting the sloppyness
- *             (makes probably only sense for sloppy < 2)
- */
-int
-processFile(ProcTab pt, int sloppy)
+/* Send what the client takes of its pending replies; RETURNS -1 on error */
+static int
+clientSend(Client c)
 {
-FILE *remf;
-char buf[MAXBUF+1];
-int  got,i;
-int  line;
-ObjF *pobj;
-int  rval = 0;
-char *comment;
-
-	buf[MAXBUF] = 'X'; /* tag end of buffer */
+ssize_t	n;
 
-	if ( ! (remf=ffind(pt->fname)) ) {
-		fprintf(stderr,	"Opening %s_list file '%s': %s\n",
-						pt->linkNotUnlink  ? "optional" : "exclude",
-						pt->fname,
-						strerror(errno));
-		return -4;
+	while ( c->osent < c->olen ) {
+		if ( (n = write(c->fd, c->out + c->osent, c->olen - c->osent)) < 0 ) {
+			if ( EINTR == errno )
+				continue;
+			return EAGAIN == errno || EWOULDBLOCK == errno ? 0 : -1;
+		}
+		c->osent += n;
 	}
+	c->olen = c->osent = 0;
+	return 0;
+}
 
-	fprintf(logf,
-			"Processing list of files ('%s') to %s %s link set\n",
-			pt->fname,
-			pt->linkNotUnlink ? "add to" : "remove from",
-			optionalLinkSet.name);
+/* Append to the pending replies of 'c' */
+static void
+clientAppend(Client c, const char *rep, size_t len)
+{
+	if ( c->olen + len > c->oavail ) {
+		c->oavail = 2 * (c->olen + len);
+		assert( c->out = realloc(c->out, c->oavail) );
+	}
+	memcpy(c->out + c->olen, rep, len);
+	c->olen += len;
+}
 
-	line = 0;
-	while ( (rval >= 0 || sloppy) && fgets(buf, MAXBUF+1, remf) ) {
-		line++;
+/* Answer a request into the pending replies of 'c'; RETURNS what serverQuery() does */
+static int
+clientRequest(Client c, char *line)
+{
+FILE	*f;
+char	*rep;
+size_t	len;
+int		rval;
 
-		if (!buf[MAXBUF]) {
-			fprintf(stderr,"Buffer overflow in %s (line %i)\n",
-							pt->fname,
-							line);
-			fclose(remf);
-			return -5;
-		}
+	if ( !(f = open_memstream(&rep, &len)) ) {
+		perror("buffering reply");
+		return 1;
+	}
+	rval = serverQuery(f, line);
+	fprintf(f, ".\n");
+	fclose(f);
 
-		/* does a comment start on this line
-		 * (note: '/' '*' must be on the same line, i.e. in buf)
-		 */
-		if ( (comment = strchr(buf, '/')) && '*'==*(comment + 1) ) {
-			/* strip comment off 'buf' */
-			*comment = 0;
-			/* scan past comment */
-			comment += 2;
-			do {
-				while ( '*' != mygc(&comment, remf) )
-					/* nothing else to do */;
-				/* at this point, we scanned past the next '*' */
+	clientAppend(c, rep, len);
+	free(rep);
+	return rval;
+}
 
-				while ( '*' == (i = mygc(&comment, remf)) )
-					/* nothing else to do */;
+/* Serve requests on the socket 'path' until a 'shutdown' request; RETURNS 0 on success */
+int
+serve(char *path)
+{
+struct sockaddr_un	addr;
+struct pollfd		pfd[SERVER_MAX_CLIENTS + 1];
+ClientRec			clients[SERVER_MAX_CLIENTS];
+Client				c;
+struct stat			st;
+int					lsn, fd, i, k, n, got, rval;
+char				*eol;
+
+	if ( strlen(path) >= sizeof(addr.sun_path) ) {
+		fprintf(stderr,"Socket path '%s' too long\n", path);
+		return -1;
+	}
 
-				/* at this point, we scanned past the last '*' in a row */
+	/* only replace a (stale) socket */
+	if ( !lstat(path, &st) ) {
+		if ( !S_ISSOCK(st.st_mode) ) {
+			fprintf(stderr,"'%s' exists and is not a socket; refusing to replace it\n", path);
+			return -1;
+		}
+		unlink(path);
+	}
 
-			} while ( '/' != i );
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
 
-		}
+	if ( (lsn = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ) {
+		perror("creating server socket");
+		return -1;
+	}
+	if ( bind(lsn, (struct sockaddr*)&addr, sizeof(addr)) || listen(lsn, SERVER_MAX_CLIENTS) ) {
+		perror("binding server socket");
+		close(lsn);
+		return -1;
+	}
 
-		/* now proceed scanning the buffer */
+	/* a client going away must not kill us */
+	signal(SIGPIPE, SIG_IGN);
 
-		/* strip off white space */
-		for (comment = buf; *comment && !isspace(*comment); comment++)
-			/* that's it */;
-		*comment = 0;
+	for ( i = 0; i < SERVER_MAX_CLIENTS; i++ )
+		clients[i].fd = -1;
 
-		if ( (i=strlen(buf)) < 1 )
-			continue; /* left an empty buffer */
+	fprintf(logf,"Serving queries on '%s'\n", path);
+	fflush(logf);
 
-#if DEBUG & DEBUG_COMMENT
-fprintf(debugf,"Scanned '%s'\n",buf); continue;
-#endif
+	for ( rval = 0; !rval; ) {
+		pfd[0].fd     = lsn;
+		pfd[0].events = POLLIN;
+		for ( i = 0; i < SERVER_MAX_CLIENTS; i++ ) {
+			pfd[i+1].fd     = clients[i].fd;
+			pfd[i+1].events = clients[i].olen ? POLLOUT : POLLIN;
+		}
 
-		/*
-		 * ignore lines not terminating with a ':'; thus we
-		 * can process ordinary name lists :-)
-		 */
+		if ( poll(pfd, SERVER_MAX_CLIENTS + 1, -1) < 0 ) {
+			if ( EINTR == errno )
+				continue;
+			perror("poll");
+			rval = -1;
+			break;
+		}
 
-		if ( ':' != buf[--i] ) {
-			continue;
+		if ( pfd[0].revents & POLLIN ) {
+			if ( (fd = accept(lsn, 0, 0)) >= 0 ) {
+				for ( i = 0; i < SERVER_MAX_CLIENTS && clients[i].fd >= 0; i++ )
+					/* nothing else to do */;
+				if ( i == SERVER_MAX_CLIENTS || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) ) {
+					close(fd);
+				} else {
+					memset(&clients[i], 0, sizeof(clients[i]));
+					clients[i].fd = fd;
+				}
+			}
 		}
-		/* strip ':' */
-		buf[i] = 0;
 
-		got = fileListFind(buf, &pobj);
+		for ( i = 0; i < SERVER_MAX_CLIENTS && !rval; i++ ) {
+			c = &clients[i];
+			if ( c->fd < 0 )
+				continue;
 
-		rval = sloppy;
+			if ( c->olen ) {
+				if ( (pfd[i+1].revents & (POLLOUT | POLLHUP | POLLERR))
+				     && (clientSend(c) || (!c->olen && c->closing)) )
+					clientClose(c);
+				continue;
+			}
 
-		if ( 0 == got ) {
-			char *fmt = "Object '%s' not found!\n";
-			if ( (rval -= 2) >=0 ) {
-				if ( ! (verbose & DEBUG_UNLINK) ) {
-					/* We didn't log so far and the stderr message may
-				 	* get lost...
-				 	*/
-					fprintf(logf, fmt, buf);
+			if ( !(pfd[i+1].revents & (POLLIN | POLLHUP | POLLERR)) )
+				continue;
+
+			if ( (got = read(c->fd, c->buf + c->len, MAXBUF - c->len)) <= 0 ) {
+				if ( got < 0 && (EAGAIN == errno || EINTR == errno) )
+					continue;
+				clientClose(c);
+				continue;
+			}
+			c->len += got;
+
+			/* process all complete lines */
+			for ( k = 0; !c->closing && (eol = memchr(c->buf + k, '\n', c->len - k)); k = eol + 1 - c->buf ) {
+				*eol = 0;
+				if ( eol > c->buf + k && '\r' == eol[-1] )
+					eol[-1] = 0;
+				if ( (n = clientRequest(c, c->buf + k)) ) {
+					c->closing = 1;
+					if ( 2 == n )
+						rval = 1;
 				}
-				fprintf(stderr,"Warning: ");
 			}
-			fprintf(stderr, fmt, buf);
-		} else if ( got > 1 ) {
-			rval -= 3;
-			fprintf(stderr,"Multiple occurrences of '%s':\n",buf);
-			for (i=0; i<got; i++) {
-				fputc(' ',stderr);
-				fputc(' ',stderr);
-				printObjName(stderr,pobj[i]);
-				fputc('\n',stderr);
+
+			memmove(c->buf, c->buf + k, c->len - k);
+			c->len -= k;
+			if ( MAXBUF == c->len && !c->closing ) {
+				clientAppend(c, SERVER_TOO_LONG, sizeof(SERVER_TOO_LONG) - 1);
+				c->closing = 1;
 			}
-			fprintf(stderr,"please be more specific!\n");
-		} else  {
-			if ( pt->linkNotUnlink ) {
-				if ( 0 == (*pobj)->link.anchor ) {
-					(*pobj)->link.anchor = &optionalLinkSet;
-					sprintf(buf,"<SCRIPT>'%s'",pt->fname);
-					rval -= linkObj( *pobj, buf, 0 );
-				}
-			} else if ( unlinkObj(*pobj, 0) ) {
-				char *fmt = "Object '%s' couldn't be removed; probably it's needed by the application\n";
-				if ( (rval -= 1) >= 0 ) {
-					if ( ! (verbose & DEBUG_UNLINK) ) {
-						/* We didn't log so far and the stderr message may
-					 	* get lost...
-					 	*/
-						fprintf(logf, fmt, buf);
-					}
-					fprintf(stderr,"Warning: ");
-				}
-				fprintf(stderr, fmt, buf);
+
+			if ( clientSend(c) || (!c->olen && c->closing) ) {
+				clientClose(c);
+			} else if ( c->olen > SERVER_MAX_PENDING ) {
+				fprintf(logf,"Dropping a client which doesn't read its replies\n");
+				fflush(logf);
+				clientClose(c);
 			}
 		}
 	}
 
-	fclose(remf);
-	return rval;
+	/* whatever the clients take without waiting */
+	for ( i = 0; i < SERVER_MAX_CLIENTS; i++ ) {
+		if ( clients[i].fd >= 0 ) {
+			clientSend(&clients[i]);
+			clientClose(&clients[i]);
+		}
+	}
+	close(lsn);
+	unlink(path);
+	return rval < 0 ? -1 : 0;
 }
 
-/*
- * Write EXTERN declarations for all members of a link set
- * to 'feil'. A 'title' may be added as a C-style comment.
- *
- * The output is suitable for GNU ld.
- */
-static int
-writeLinkSet(FILE *feil, LinkSet s, char *title)
-{
-ObjF	f = s->set;
-int		n;
+#define OPT_SHOW_DEPS		(1<<0)
+#define OPT_SHOW_SYMS		(1<<1)
+#define OPT_INTERACTIVE		(1<<2)
+#define OPT_QUIET			(1<<3)
+#define OPT_NO_APPSET		(1<<5)
+#define OPT_SLOPPY_UNLINK	(1<<6)
+#define OPT_PRESIZE_SYMTBL	(1<<7)
+#define OPT_SHOW_DEPS_COMPACT	(1<<8)
+
+/* long options without a short equivalent */
+#define LOPT_PARANOID		256
+#define LOPT_STATS			257
+#define LOPT_STATS_JSON		258
+#define LOPT_IMPACT			259
+#define LOPT_LOW_MEM		260
+#define LOPT_CONFIG			261
+#define LOPT_TRACE_EVENTS	262
+#define LOPT_TRACE_SHOW		263
+#define LOPT_EXPORT			264
+#define LOPT_LIST_UNDEFS	265
+
+static struct option longOpts[] = {
+	{ "paranoid",	no_argument,		0,	LOPT_PARANOID	},
+	{ "stats",		no_argument,		0,	LOPT_STATS		},
+	{ "stats-json",	required_argument,	0,	LOPT_STATS_JSON	},
+	{ "impact",		required_argument,	0,	LOPT_IMPACT		},
+	{ "low-mem",	no_argument,		0,	LOPT_LOW_MEM	},
+	{ "config",		required_argument,	0,	LOPT_CONFIG		},
+	{ "trace-events",	required_argument,	0,	LOPT_TRACE_EVENTS	},
+	{ "trace-show",	required_argument,	0,	LOPT_TRACE_SHOW	},
+	{ "export",		required_argument,	0,	LOPT_EXPORT		},
+	{ "list-undefs",	no_argument,		0,	LOPT_LIST_UNDEFS	},
+	{ 0,			0,					0,	0				}
+};
 
-	if ( !f )
-		return 0;
+/* Print the statistics to stderr ('--stats') and/or as JSON ('--stats-json'); only once */
+static void
+statReport()
+{
+double			now[2];
+struct rusage	ru;
+unsigned long	nxrefs = 0;
+ObjF			f;
+FILE			*js;
+int				i;
 
-	if (title)
-		fprintf(feil,"/* ----- %s Link Set ----- */\n\n", title);
+	if ( !stats.on )
+		return;
+	stats.on = 0;
+
+	statNow(now);
+	for ( f = fileListHead; f; f = f->next )
+		nxrefs += f->nexports + f->nimports;
+	getrusage(RUSAGE_SELF, &ru);
+
+	if ( stats.human ) {
+		fprintf(stderr,"Statistics:\n");
+		fprintf(stderr,"  %-16s %10s %10s\n", "phase", "wall [s]", "cpu [s]");
+		for ( i = 0; i < STAT_NPHASES; i++ )
+			fprintf(stderr,"  %-16s %10.4f %10.4f\n", statPhaseNames[i], stats.t[i][0], stats.t[i][1]);
+		fprintf(stderr,"  %-16s %10.4f %10.4f\n", "total", now[0] - stats.start[0], now[1] - stats.start[1]);
+		fprintf(stderr,"  lines scanned:        %lu\n", stats.lines);
+		fprintf(stderr,"  objects:              %d\n",  numFiles - 1);
+		fprintf(stderr,"  libraries:            %d\n",  numLibs);
+		fprintf(stderr,"  symbols:              %d\n",  symTbl.nsyms);
+		fprintf(stderr,"  xrefs:                %lu\n", nxrefs);
+		fprintf(stderr,"  symbol table probes:  %lu\n", stats.probes);
+		fprintf(stderr,"  depwalk nodes:        %lu\n", stats.walkNodes);
+		fprintf(stderr,"  depwalk edges:        %lu\n", stats.walkEdges);
+		fprintf(stderr,"  unlinkObj() calls:    %lu\n", stats.unlinkCalls);
+		fprintf(stderr,"  peak RSS [kB]:        %ld\n", ru.ru_maxrss);
+		fprintf(stderr,"  released early [kB]:  %lu\n", stats.released / 1024);
+	}
 
-	for ( ; f; f = f->link.next ) {
-		fprintf(feil,"/* "); printObjName(feil,f); fprintf(feil,": */\n");
-		for ( n = 0; n < f->nexports; n++ ) {
-			fprintf(feil,"EXTERN( %s ) /* size %i */\n", f->exports[n].sym->name, f->exports[n].size);
+	if ( stats.json ) {
+		if ( !(js = fopen(stats.json, "w")) ) {
+			perror("opening statistics file");
+			return;
 		}
+		fprintf(js,"{\n  \"phases\": {\n");
+		for ( i = 0; i < STAT_NPHASES; i++ )
+			fprintf(js,"    \"%s\": { \"wall\": %.6f, \"cpu\": %.6f },\n", statPhaseNames[i], stats.t[i][0], stats.t[i][1]);
+		fprintf(js,"    \"total\": { \"wall\": %.6f, \"cpu\": %.6f }\n  },\n", now[0] - stats.start[0], now[1] - stats.start[1]);
+		fprintf(js,"  \"counters\": {\n");
+		fprintf(js,"    \"lines\": %lu,\n",        stats.lines);
+		fprintf(js,"    \"objects\": %d,\n",       numFiles - 1);
+		fprintf(js,"    \"libraries\": %d,\n",     numLibs);
+		fprintf(js,"    \"symbols\": %d,\n",       symTbl.nsyms);
+		fprintf(js,"    \"xrefs\": %lu,\n",        nxrefs);
+		fprintf(js,"    \"symtab_probes\": %lu,\n", stats.probes);
+		fprintf(js,"    \"depwalk_nodes\": %lu,\n", stats.walkNodes);
+		fprintf(js,"    \"depwalk_edges\": %lu,\n", stats.walkEdges);
+		fprintf(js,"    \"unlink_calls\": %lu,\n",  stats.unlinkCalls);
+		fprintf(js,"    \"peak_rss_kb\": %ld,\n",   ru.ru_maxrss);
+		fprintf(js,"    \"released_kb\": %lu\n",    stats.released / 1024);
+		fprintf(js,"  }\n}\n");
+		fclose(js);
 	}
-	return 0;
 }
 
 /*
- * Generate a linker script with external references to enforce linking the
- * application and optional link sets
+ * '--low-mem': release what the remaining phases don't need. After the
+ * unlinking phases ('final' == 0) these are the depwalk() arrays
+ * (rebuilt on demand should a query need them); once all queries are
+ * answered ('final') the object index for fileListFind(), the
+ * application closure of the what-if queries and the wildcard search
+ * index.
  */
-int
-writeScript(FILE *feil, int optionalOnly)
+static void
+lowMemRelease(int final)
 {
-	if ( !optionalOnly ) {
-		writeLinkSet(feil, &appLinkSet, "Application");
-		fputc('\n',feil);
+	if ( !lowMem )
+		return;
+
+	if ( !final ) {
+		stats.released +=   depwalkMain.size  * (sizeof(*depwalkMain.mark) + sizeof(*depwalkMain.work) + sizeof(*depwalkMain.depth))
+		                  + depwalkMain.avail * sizeof(*depwalkMain.stack);
+		depwalkCtxFree(&depwalkMain);
+		return;
 	}
 
-	writeLinkSet(feil, &optionalLinkSet, "Optional");
-	return 0;
+	if ( fileListIndex ) {
+		stats.released += numFiles * sizeof(*fileListIndex);
+		free(fileListIndex);
+		fileListIndex = 0;
+	}
+	stats.released += strIndex.size * sizeof(*strIndex.slots);
+	free(strIndex.slots);
+	memset(&strIndex, 0, sizeof(strIndex));
+
+	if ( symSearchIdx.syms )
+		stats.released += (symSearchIdx.n + 1) * sizeof(*symSearchIdx.syms);
+	if ( symSearchIdx.tfirst )
+		stats.released += (TRI_BUCKETS + 1 + symSearchIdx.tfirst[TRI_BUCKETS] + 1) * sizeof(int);
+	stats.released += symSearchIdx.ares * sizeof(*symSearchIdx.res);
+	free(symSearchIdx.syms);
+	free(symSearchIdx.tfirst);
+	free(symSearchIdx.post);
+	free(symSearchIdx.res);
+	memset(&symSearchIdx, 0, sizeof(symSearchIdx));
+
+	stats.released +=   impactApp.avail * sizeof(*impactApp.nodes)
+	                  + impactApp.size  * (sizeof(*impactApp.mark) + sizeof(*impactApp.idx));
+	walkSetFree(&impactApp);
+	impactReady = 0;
 }
 
-static const char *getsname(Sym ps, char **pstripped)
-{
-char *chpt;
-const char *sname = ps->name;
+/*
+ * Link state of all objects: their link set membership and the lists of
+ * importers linkObj() and doUnlink() maintain. Several configurations
+ * ('--config') are evaluated on one database by restoring the state
+ * saved after linking the application.
+ */
+typedef struct LinkStateRec_ {
+	ObjF		sets[3];	/* members of the application, optional and undefined link sets */
+	LinkNodeRec	*links;		/* by seq */
+	Xref		*impNext;	/* XREF_NEXT() of all imports (in file list order) */
+	Xref		*impFrom;	/* 'importedFrom' of their symbols */
+} LinkStateRec, *LinkState;
 
-	if ( pstripped ) {
-		*pstripped = strdup(sname);
-#ifdef LINKER_VERSION_SEPARATOR
-		if ( chpt = strchr(*pstripped, LINKER_VERSION_SEPARATOR) ) {
-			*chpt = 0;
+static void
+linkStateSave(LinkState s)
+{
+ObjF	f;
+int		i, n;
+
+	for ( n = 0, f = fileListHead; f; f = f->next )
+		n += f->nimports;
+
+	assert( s->links   = malloc(numFiles * sizeof(*s->links)) );
+	assert( s->impNext = malloc((n + 1)  * sizeof(*s->impNext)) );
+	assert( s->impFrom = malloc((n + 1)  * sizeof(*s->impFrom)) );
+
+	s->sets[0] = appLinkSet.set;
+	s->sets[1] = optionalLinkSet.set;
+	s->sets[2] = undefLinkSet.set;
+	for ( n = 0, f = fileListHead; f; f = f->next ) {
+		s->links[f->seq] = f->link;
+		for ( i=0; i<f->nimports; i++, n++ ) {
+			s->impNext[n] = XREF_NEXT(&f->imports[i]);
+			s->impFrom[n] = f->imports[i].sym->importedFrom;
 		}
-#endif
 	}
-	return sname;
 }
 
 static void
-writeSymdecl(FILE *feil, Xref r, char *title, int *pi)
+linkStateRestore(LinkState s)
 {
-char *stripped;
-
-	/* Don't emit a declaration for weak undefined symbols */
-	if ( ! ISWEAKUNDEF(TYPE(r)) ) {
-		getsname(r->sym, &stripped);
-		fprintf(feil,"extern int "DUMMY_ALIAS_PREFIX"%s%i;\n",title,*pi);
-		fprintf(feil,"asm(\".set "DUMMY_ALIAS_PREFIX"%s%i,%s\\n\");\n",title,*pi,stripped);
-		free(stripped);
+ObjF	f;
+int		i, n;
+
+	appLinkSet.set      = s->sets[0];
+	optionalLinkSet.set = s->sets[1];
+	undefLinkSet.set    = s->sets[2];
+	for ( n = 0, f = fileListHead; f; f = f->next ) {
+		f->link = s->links[f->seq];
+		for ( i=0; i<f->nimports; i++, n++ ) {
+			xref_set_next(&f->imports[i], s->impNext[n]);
+			f->imports[i].sym->importedFrom = s->impFrom[n];
+		}
 	}
-	(*pi)++;
 }
 
 static void
-writeSymdef(FILE *feil, Xref r, char *title, int *pi)
+linkStateFree(LinkState s)
 {
-const char *sname = getsname(r->sym,0);
-char t            = TYPE(r);
-char ut           = ISWEAKUNDEF(t) ? t : toupper(t);
-
-	fprintf(feil,"\t{\n");
-	fprintf(feil,"\t\t.name        = \"%s\",\n", sname);
-	if ( !ISWEAKUNDEF(t) ) {
-		fprintf(feil,"\t\t.value.ptv   =(void*)&"DUMMY_ALIAS_PREFIX"%s%i,\n",title,*pi);
-		fprintf(feil,"\t\t.value.type  =%s,\n",      'T'==t ? "TFuncP" : "TVoid");
-		fprintf(feil,"\t\t.size        =%i,\n",      r->size);
-	} else {
-		fprintf(feil,"\t\t.value.ptv   =(void*)0,\n");
-		fprintf(feil,"\t\t.value.type  =TVoidP,  \n");
-		fprintf(feil,"\t\t.size        =0,       \n");
-	}
-	fprintf(feil,"\t\t.flags       =0");
-	if ( isupper(t) || ISWEAKUNDEF(t) )
-		fprintf(feil,"|CEXP_SYMFLG_GLBL");
-	if ( ( 'W' == ut || 'V' == ut || ISWEAKUNDEF(ut) ) &&
-			strcmp("cexpSystemSymbols",sname) )
-		fprintf(feil,"|CEXP_SYMFLG_WEAK");
-	fprintf(feil,",\n");
-	fprintf(feil,"\t},\n");
-
-	(*pi)++;
+	free(s->links);
+	free(s->impNext);
+	free(s->impFrom);
+	memset(s, 0, sizeof(*s));
 }
 
-/*
- * Write symbol definitions in C source form for all members of a link set
- * to 'feil'. A 'title' may be added as a C-style comment.
- *
- * The output is suitable for building into CEXP applications
- */
+/* RETURNS nonzero if a configuration has neither lists nor output files */
 static int
-writeSymdefs(FILE *feil, LinkSet s, char *title, int pass, int genUndefs)
+configEmpty(Config c)
 {
-ObjF	f = s->set;
-int		n;
-int     i;
-Sym     sym;
-int     doHeader;
-
-	if ( !f )
-		return 0;
-
-	if (title)
-		fprintf(feil,"/* ----- %s Link Set ----- */\n\n", title);
+	return !c->nProc && !c->scrn && !c->srcn && !c->cmpn && !c->expn;
+}
 
-if ( 0 == pass ) {
-	for ( i=0 ; f; f = f->link.next ) {
-		doHeader = 1;
-		fprintf(feil,"/* "); printObjName(feil,f); fprintf(feil,": */\n");
-		for ( n = 0; n < f->nexports; n++ ) {
-			sym = f->exports[n].sym;
-			if ( f != strongestExport( sym )->obj )
-				continue;
-			writeSymdecl(feil, &f->exports[n], title, &i);
-		}
-	}
-} else {
-	for ( i=0 ; f; f = f->link.next ) {
-		doHeader = 1;
-		fprintf(feil,"/* "); printObjName(feil,f); fprintf(feil,": */\n");
-		for ( n = 0; n < f->nexports; n++ ) {
-			sym         = f->exports[n].sym;
-			if ( f != strongestExport( sym )->obj )
-				continue;
-			writeSymdef(feil, &f->exports[n], title, &i);
+/* Link all objects not part of any link set to 's' (in file list order) */
+static void
+linkRest(LinkSet s)
+{
+ObjF f;
+	for ( f=fileListFirst(); f; f=f->next) {
+		if ( !f->link.anchor ) {
+			f->link.anchor = s;
+			linkObj(f, 0, 0);
 		}
 	}
 }
-	return 0;
-}
 
+static const char *prognam(const char *argvnam)
+{
+const char *rval;
+	return (rval=strrchr(argvnam,'/')) ? rval+1 : argvnam;
+}
 
 /*
- * Generate a Cexp symbol table source file. Adding this to the application
- * automatically triggers linkage of the optional link sets.
+ * Scan the 'n' nm files 'names' (stdin if 'n' is zero).
+ *
+ * RETURNS: the last object of the first file (the application's
+ *          mandatory file set - unless '-A' is used).
  */
-int
-writeSource(FILE *feil, int optionalOnly)
+static ObjF
+scanFiles(char **names, int n)
 {
-int pass;
-	for ( pass = 0; pass < 2; pass++ ) {
-		if ( 0== pass )
-			fprintf(feil,"#include <cexpsyms.h>\n");
-		else
-			fprintf(feil,"\n\nstatic CexpSymRec systemSymbols[] = {\n");
-		if ( !optionalOnly ) {
-			writeSymdefs(feil, &appLinkSet, "Application", pass, emitUndefs);
-			fputc('\n',feil);
+ObjF	lastAppObj = 0;
+FILE	*feil      = stdin;
+int		i          = 0;
+
+	statBegin(STAT_SCAN);
+#ifdef HAVE_PTHREAD_H
+	if ( nThreads > 1 && n > 1 ) {
+		scanFilesMT(names, n, &lastAppObj);
+		statEnd(STAT_SCAN);
+		return lastAppObj;
+	}
+#endif
+	do {
+		char *nm = i < n ? names[i] : "<stdin>";
+		if ( i < n && !(feil=ffind(nm)) ) {
+			fprintf(stderr,"Opening nm_file '%s': %s\n", nm, strerror(errno));
+			exit(1);
+		}
+		if (scan_file(feil,nm)) {
+			fprintf(stderr,"Error scanning %s\n",nm); 
+			exit(1);
 		}
+		/* scan_file() keeps the contents; the stream is no longer needed */
+		if ( feil != stdin )
+			fclose(feil);
+		/* the first file we scan contains the application's
+		 * mandatory file set - unless '-A' is used.
+		 */
+		if ( !lastAppObj )
+			lastAppObj = fileListTail;
+	} while (++i < n);
 
-		writeSymdefs(feil, &optionalLinkSet, "Optional", pass, 0);
-
-		if ( emitUndefs ) {
-			writeSymdefs(feil, &undefLinkSet, "UNDEFINED", pass, 0);
-		}
-		if ( 1 == pass ) {
-			fprintf(feil,"\t{\n");
-			fprintf(feil,"\t0, /* terminating record */\n");
-			fprintf(feil,"\t},\n");
-			fprintf(feil,"};\n");
-			fprintf(feil,"CexpSym cexpSystemSymbols = systemSymbols;\n");
-		}
-}
-	return 0;
+	statEnd(STAT_SCAN);
+	return lastAppObj;
 }
 
-
-static void 
-usage(const char *nm)
+/* Fix up all objects (once all cross-references are placed) */
+static void
+fixupDatabase()
 {
-const char *strip = strrchr(nm,'/');
-	if (strip)
-		nm = strip+1;
-	fprintf(stderr,"\nUsage: %s [-Odfhilmqsuv] [-A main_symbol] [-L path] [-o optional_list] [-x exclude_list] [-e script_file] [-C src_file] nm_files\n\n", nm);
-	fprintf(stderr,"   Object file dependency analysis; the input files must be\n");
-	fprintf(stderr,"   created with 'nm -g -fposix'.\n\n");
-	fprintf(stderr,"(This is ldep %s by Till Straumann <strauman@slac.stanford.edu>)\n\n", GITREV);
-	fprintf(stderr,"   Input:\n");
-	fprintf(stderr,"           If no 'nm_files' are given, 'stdin' is used. The first 'nm_file' is\n");
-	fprintf(stderr,"           special (unless using -A, see below): it lists MANDATORY objects/symbols\n");
-    fprintf(stderr,"           (AKA 'application files').\n");
-	fprintf(stderr,"           objects added by the other 'nm_files' are 'optional' unless a mandatory\n");
-	fprintf(stderr,"           object depends on an optional object. In this case, the latter becomes\n");
-	fprintf(stderr,"           mandatory as well.\n\n");
+ObjF f;
 
-	fprintf(stderr,"   Options:\n");
-	fprintf(stderr,"     -A:   use 'main_symbol' to construct the set of mandatory objects - anything\n");
-	fprintf(stderr,"           (directly or indirectly) needed by the object defining 'main_symbol' is\n");
-	fprintf(stderr,"           mandatory.\n");
-	fprintf(stderr,"           NOTE: The first 'nm_file' is NOT treated special if this option is used.\n");
-	fprintf(stderr,"     -F:   tolerate/ignore failure when processing 'exclude_lists'\n");
-	fprintf(stderr,"     -L:   add 'path' to search path for 'nm_files', 'optional_lists' and 'exclude_lists'\n");
-	fprintf(stderr,"           NOTE: if at least one '-L' is present, '.' must explicitely added.'\n");
-	fprintf(stderr,"     -O:   when generating a script (see -e), only list the optional link set\n");
-	fprintf(stderr,"     -o:   add a list of optional objects to the link - name them, one per line, in\n");
-    fprintf(stderr,"           the file 'optional_list'. Object names must be appended a ':', e.g. 'blah.o:'!\n");
-	fprintf(stderr,"           NOTES: - multiple '-o' and '-x' options may be present. The respective files\n");
-	fprintf(stderr,"                    are processed in the order the options are given on the command line\n");
-	fprintf(stderr,"                  - if at least one '-o' option is present, the 'optional nm_files' are\n");
-	fprintf(stderr,"                    merely added to the database but NOT linked/added to the application,\n");
-	fprintf(stderr,"                    ONLY objects listed in '-o' files are.\n");
-	fprintf(stderr,"     -d:   show all module dependencies (huge amounts of data! -- use '-l', '-u')\n");
-	fprintf(stderr,"     -e:   on success, generate a linker script 'script_file' with EXTERN statements\n");
-	fprintf(stderr,"     -C:   on success, generate a C-source file with CEXP symbol table definitions\n");
-	fprintf(stderr,"     -U:   add undefined symbols in the application link set to the CEXP symbol\n");
-	fprintf(stderr,"           table definitions (assuming they will be supplied by the linker, startfiles or libraries of which no '.nm' file was provided\n");
-	fprintf(stderr,"     -f:   be less paranoid when scanning symbols: accept 'local symbols' (map all\n");
-	fprintf(stderr,"           types to upper-case) and assume unrecognized symbol types ('?') are 'U'\n");
-	fprintf(stderr,"     -h:   print this message.\n");
-	fprintf(stderr,"     -v:   print version info.\n");
-	fprintf(stderr,"     -i:   enter interactive mode\n");
-	fprintf(stderr,"     -l:   log info about the linking process\n");
-	fprintf(stderr,"     -q:   quiet; just build database and do basic checks\n");
-	fprintf(stderr,"  -t <sym> trace symbol 'sym' and log info (may use multiple times)\n");
-	fprintf(stderr,"     -x:   exclude/remove a list of objects from the link - name them, one per line, in\n");
-	fprintf(stderr,"           the file 'exclude_list'\n");
-	fprintf(stderr,"           NOTES: - if a mandatory object depends on an object to be removed, removal\n");
-	fprintf(stderr,"                    is rejected.\n");
-	fprintf(stderr,"                  - object names must be appended a ':', e.g. 'blah.o:' - other lines are\n");
-	fprintf(stderr,"                    ignored. Thus, output from 'nm -fposix' is accepted.\n");
-	fprintf(stderr,"     -s:   show all symbol info (huge amounts of data! -- use '-l', '-u')\n");
-	fprintf(stderr,"     -u:   log info about the unlinking process\n");
-	fprintf(stderr,"\n"
-				   "   NOTES:\n");
-	fprintf(stderr,"\n"
-				   "     -     '-o' and '-x' files may contain 'C-style' comments ('/* */') with the restriction\n");
-	fprintf(stderr,"           that a comment must not split an input line (but a comment may start on one line\n");
-	fprintf(stderr,"           and end on another line, i.e.\n");
-	fprintf(stderr,"               'blah/* is */illegal:'\n");
-	fprintf(stderr,"               'blah:/* is \n");
-	fprintf(stderr,"                legal*/foo:\n");
+	statBegin(STAT_FIXUP);
+	for ( f = fileListFirst(); f; f=f->next )
+		fixupObj( f );
+	statEnd(STAT_FIXUP);
+
+	statBegin(STAT_UNDEFS);
+	gatherDanglingUndefs();
+	statEnd(STAT_UNDEFS);
 }
 
-/* Primitive interactive command interpreter (database queries) */
-int
-interactive(FILE *feil)
+/* Scan (see scanFiles()) and fix up the database; RETURNS 'lastAppObj' */
+static ObjF
+buildDatabase(char **names, int n, int presize)
 {
-Sym		*found;
-ObjF	*f;
-char	buf[MAXBUF+1];
-int		len, nf, i, choice;
-SymRec	sym = {0};
+ObjF	lastAppObj;
 
-	sym.name = buf;
+	if ( presize && n > 0 ) {
+		symTblResize(&symTbl, estimateSymbols(names, n));
+	}
 
-	buf[0]=0;
+	lastAppObj = scanFiles(names, n);
 
-	buf[MAXBUF]='0';
+	placeXrefs(fileListHead);
 
-	do {
-		if ( MAXBUF == (len=strlen(buf)) ) {
-			fprintf(stderr,"Line buffer overflow in interactive mode\n");
-			return -1;
-		}
+	fixupDatabase();
 
-		if ( !*buf || '\n'==*buf ) {
-			fputc('\n',feil);
-			fprintf(feil, "Query database (enter single '.' to quit) for\n");
-			fprintf(feil, " A) Symbols, e.g. 'printf'\n");
-			fprintf(feil, " B) Objects, e.g. '[printf.o]', 'libc.a[printf.o]'\n\n");
-		} else {
-			buf[--len]=0; /* strip trailing '\n' */
-			if ( ']' == buf[len-1] ) {
-				nf = fileListFind(buf, &f);
+	return lastAppObj;
+}
 
-				if ( !nf ) {
-					fprintf(feil,"object '%s' not found, try again.\n", buf);
-				} else {
-					choice = 0;
-					if ( nf > 1 ) {
-						fprintf(feil,"multiple instances found, make a choice:\n");
-						for (i = 0; i<nf; i++) {
-							fprintf(feil,"%i) - ",i); printObjName(feil, f[i]); fputc('\n', feil);
-						}
+/*
+ * Build the database (see buildDatabase()) using an incremental
+ * database cache 'dbname' for all but the first of the 'n' > 1 files.
+ *
+ * RETURNS: 'lastAppObj'
+ */
+static ObjF
+buildIncremental(char *dbname, char **names, int n, int presize)
+{
+ObjF	lastAppObj, last;
 
-						while (    !fgets( buf, MAXBUF, stdin) ||
-								 1 !=sscanf(buf,"%i",&choice)  ||
-								 choice < 0                    ||
-								 choice >= nf ) {
+	lastAppObj = scanFiles(names, 1);
 
-								if ( !strcmp(".\n",buf) )
-									return 0;
+	placeXrefs(fileListHead);
 
-								fprintf(feil, "\nInvalid Choice, ");
-								
-								if (!*buf) {
-									fprintf(feil,"bailing out\n");
-									return -1;
-								}
+	if ( numLibs ) {
+		/* libraries referenced by the application's nm_file are
+		 * shared with the others; can't cache those separately.
+		 */
+		fprintf(stderr,"Warning: '%s' lists library members; not using incremental database cache\n", names[0]);
+		last = fileListTail;
+		scanFiles(names + 1, n - 1);
+		placeXrefs(last->next);
+	} else if ( dbcLoad(dbname, names + 1, n - 1, 0, DBC_LIBS) ) {
+		if ( presize )
+			symTblResize(&symTbl, symTbl.nsyms + estimateSymbols(names + 1, n - 1));
+
+		last         = fileListTail;
+		notesRecord  = 1;
+		scanMarkSyms = 1;
+		scanFiles(names + 1, n - 1);
+		scanMarkSyms = 0;
+		notesRecord  = 0;
+
+		placeXrefs(last->next);
+
+		dbcWrite(dbname, names + 1, n - 1, 0, last->next, DBC_LIBS);
+	}
 
-								fprintf(feil,"try again\n");
-								*buf = 0;
-						}
+	fixupDatabase();
 
+	return lastAppObj;
+}
 
-					}
-					trackObj(feil, f[choice]);
-				}
-			} else {
-				found = (Sym*) tfind(&sym, &symTbl, symcmp);
+/*
+ * Open the output file 'name'. If 'keep' is nonzero then
+ * the output goes to a temporary file (*ptmp) which outClose()
+ * renames to 'name' only if the contents differ - an unchanged
+ * file (and its modification time) is left alone.
+ */
+static FILE *
+outOpen(char *name, char **ptmp, int keep)
+{
+FILE *rval;
 
-				if ( !found ) {
-					fprintf(feil,"Symbol '%s' not found, try again\n", sym.name);
-				} else {
-					trackSym(feil, *found);
-				}
-			}
-		}
-	} while ( fgets(buf, MAXBUF, stdin) && *buf && strcmp(buf,".\n") );
+	*ptmp = 0;
+	if ( !keep )
+		return fopen(name, "w");
+
+	assert( *ptmp = malloc(strlen(name) + 20) );
+	sprintf(*ptmp, "%s.tmp%u", name, (unsigned)getpid());
+	if ( !(rval = fopen(*ptmp, "w")) ) {
+		free(*ptmp);
+		*ptmp = 0;
+	}
+	return rval;
 }
 
-#define OPT_SHOW_DEPS		(1<<0)
-#define OPT_SHOW_SYMS		(1<<1)
-#define OPT_INTERACTIVE		(1<<2)
-#define OPT_QUIET			(1<<3)
-#define OPT_NO_APPSET		(1<<5)
-#define OPT_SLOPPY_UNLINK	(1<<6)
+/* RETURNS: nonzero if the files 'a' and 'b' have the same contents */
+static int
+sameContents(char *a, char *b)
+{
+FILE	*fa, *fb;
+char	ba[BUFSIZ], bb[BUFSIZ];
+size_t	na, nb;
 
-static const char *prognam(const char *argvnam)
+	if ( !(fa = fopen(a, "r")) )
+		return 0;
+	if ( !(fb = fopen(b, "r")) ) {
+		fclose(fa);
+		return 0;
+	}
+	do {
+		na = fread(ba, 1, sizeof(ba), fa);
+		nb = fread(bb, 1, sizeof(bb), fb);
+	} while ( na == nb && na > 0 && !memcmp(ba, bb, na) );
+	/* e.g. 'b' is a directory */
+	if ( ferror(fa) || ferror(fb) )
+		na = 1;
+	fclose(fb);
+	fclose(fa);
+	return 0 == na && 0 == nb;
+}
+
+/*
+ * Close a file opened by outOpen(); the temporary file is removed if
+ * writing or renaming it fails.
+ *
+ * RETURNS 0 on success, nonzero (with errno set) on failure.
+ */
+static int
+outClose(FILE *feil, char *name, char *tmp)
 {
-const char *rval;
-	return (rval=strrchr(argvnam,'/')) ? rval+1 : argvnam;
+int rval = ferror(feil);		/* an earlier write may have failed */
+int err  = errno;
+
+	if ( fclose(feil) ) {
+		rval = -1;
+		err  = errno;
+	}
+	if ( tmp ) {
+		if ( rval || sameContents(tmp, name) ) {
+			unlink(tmp);
+		} else if ( (rval = rename(tmp, name)) ) {
+			err = errno;
+			unlink(tmp);
+		}
+		free(tmp);
+	}
+	errno = err;
+	return rval;
 }
 
 int
 main(int argc, char **argv)
 {
-FILE	*feil         = stdin;
 FILE	*scrf         = 0;
-char	*scrn         = 0;
-char    *srcn         = 0;
 ObjF	lastAppObj    = 0; 
 SymRec	mainSym       = {0};
-ProcTab	procTab		  = 0;
-int		nProc         = 0;
+Config	configs       = 0;
+int		nConfigs      = 1;
+Config	cf, last;
+LinkStateRec linked   = {0};
+RelinkRec relink      = {0};
+int		first;
 char	*mainName     = 0;
+char	*dbName       = 0;
+char	*sockName     = 0;
+char	*tmpn         = 0;
+char	*traceName    = 0;
+int		incremental   = 0;
 int		options       = 0;
-int		hasOptional   = 0;
 int     nTracSyms     = 0;
 char  **tracSyms      = 0;
+int		nImpacts      = 0;
+char  **impacts       = 0;
 int		i,nfile,ch;
 ObjF	f;
 LinkSet	linkSet;
-Sym		*found;
+Sym		found;
 
 	logf = stdout;
 
-	while ( (ch=getopt(argc, argv, "vOC:FL:A:qhifsdlux:o:e:Ut:")) >= 0 ) {
+	assert( cf = configs = calloc(1, sizeof(*configs)) );
+
+	while ( (ch=getopt_long(argc, argv, "BIvOPRc:C:K:FL:A:qhifsdDj:lS:ux:o:e:Ut:", longOpts, 0)) >= 0 ) {
 		switch (ch) { 
 			default: fprintf(stderr, "Unknown option '%c'\n",ch);
 					 exit(1);
@@ -2265,10 +8221,19 @@ Sym		*found;
 			break;
 			case 'O': options |= OPT_NO_APPSET;
 			break;    
+			case 'P': options |= OPT_PRESIZE_SYMTBL;
+			break;    
 			case 'u': verbose |= DEBUG_UNLINK;
 			break;
 			case 'd': options |= OPT_SHOW_DEPS;
 			break;
+			case 'D': options |= OPT_SHOW_DEPS_COMPACT;
+			break;
+			case 'j': if ( (nThreads = atoi(optarg)) < 1 ) {
+						fprintf(stderr,"Invalid number of threads '%s'\n", optarg);
+						exit(1);
+					  }
+			break;
 			case 'f': force        = 1;
 			break;
 			case 'i': options |= OPT_INTERACTIVE;
@@ -2279,34 +8244,89 @@ Sym		*found;
 			break;
 			case 'F': options |= OPT_SLOPPY_UNLINK;
 			break;
-			case 'o': procTab = realloc(procTab, sizeof(*procTab) * (nProc+1));
-					  procTab[nProc].fname         = optarg;
-					  procTab[nProc].linkNotUnlink = 1;
-					  nProc++;
-					  hasOptional++;
+			case 'o': cf->procTab = realloc(cf->procTab, sizeof(*cf->procTab) * (cf->nProc+1));
+					  cf->procTab[cf->nProc].fname         = optarg;
+					  cf->procTab[cf->nProc].linkNotUnlink = 1;
+					  cf->nProc++;
+					  cf->hasOptional++;
 			break;
 			case 't':
 			          nTracSyms++;
 			          tracSyms = realloc(tracSyms, nTracSyms*sizeof(tracSyms[0]));
 			          tracSyms[nTracSyms-1] = optarg;
 			break;
-			case 'x': procTab = realloc(procTab, sizeof(*procTab) * (nProc+1));
-					  procTab[nProc].fname         = optarg;
-					  procTab[nProc].linkNotUnlink = 0;
-					  nProc++;
+			case 'x': cf->procTab = realloc(cf->procTab, sizeof(*cf->procTab) * (cf->nProc+1));
+					  cf->procTab[cf->nProc].fname         = optarg;
+					  cf->procTab[cf->nProc].linkNotUnlink = 0;
+					  cf->nProc++;
+			break;
+			case 'e': cf->scrn = optarg;
+			break;
+			case 'C': cf->srcn = optarg;
+			break;
+			case 'K': cf->cmpn = optarg;
 			break;
-			case 'e': scrn = optarg;
+			case 'c': dbName = optarg;
 			break;
-			case 'C': srcn = optarg;
+			case 'I': incremental = 1;
 			break;
+			case 'S': sockName = optarg;
+			break;
+			case 'R': sortedOutput = 1;
+			break;
+
 			case 'U': emitUndefs = 1;
 			break;
+			case 'B': batchUnlink = 1;
+			break;
+			case LOPT_PARANOID: paranoid = 1;
+			break;
+			case LOPT_STATS: stats.human = 1;
+			break;
+			case LOPT_STATS_JSON: stats.json = optarg;
+			break;
+			case LOPT_LOW_MEM: lowMem = 1;
+			break;
+			case LOPT_LIST_UNDEFS: listUndefs = 1;
+			break;
+			case LOPT_CONFIG:
+					  assert( configs = realloc(configs, sizeof(*configs) * (nConfigs+1)) );
+					  cf = &configs[nConfigs++];
+					  memset(cf, 0, sizeof(*cf));
+					  cf->name = optarg;
+			break;
+			case LOPT_EXPORT: cf->expn = optarg;
+			break;
+			case LOPT_TRACE_EVENTS: traceName = optarg;
+			break;
+			case LOPT_TRACE_SHOW:
+					  exit( traceShow(optarg, stdout) ? 1 : 0 );
+			case LOPT_IMPACT:
+			          nImpacts++;
+			          impacts = realloc(impacts, nImpacts*sizeof(impacts[0]));
+			          impacts[nImpacts-1] = optarg;
+			break;
 		}
 	}
 
+	/* the log is for reading afterwards; don't pay for frequent writes */
+	if ( !isatty(fileno(logf)) )
+		setvbuf(logf, 0, _IOFBF, LOG_BUFSIZE);
+
 	debugf = logf;
 
+	if ( traceName ) {
+		if ( traceOpen(traceName) )
+			exit(1);
+		verbose |= DEBUG_TRACE;
+	}
+
+	if ( verbose & ~(LOG_MASK) & (DEBUG_LINK | DEBUG_UNLINK | DEBUG_TRACE) )
+		fprintf(stderr,"Warning: '-l', '-u' or '--trace-events' logging was disabled at compile time (LOG_MASK)\n");
+
 	nfile = optind;
+	if ( (stats.on = stats.human || stats.json) )
+		statNow(stats.start);
 
 	if ( 0 == numSearchPaths ) {
 		/* implicit default */
@@ -2318,37 +8338,39 @@ Sym		*found;
 			maxPathLen = ch;
 	}
 
-	do {
-		char *nm = nfile < argc ? argv[nfile] : "<stdin>";
-		if ( nfile < argc && !(feil=ffind(nm)) ) {
-			fprintf(stderr,"Opening nm_file '%s': %s\n", nm, strerror(errno));
-			exit(1);
+	if ( dbName && incremental && argc - nfile > 1 ) {
+		lastAppObj = buildIncremental(dbName, argv + nfile, argc - nfile, options & OPT_PRESIZE_SYMTBL);
+		if ( dbcLibValid && lastAppObj ) {
+			assert( relink.name = malloc(strlen(dbName) + sizeof(".state")) );
+			sprintf(relink.name, "%s.state", dbName);
+			relink.lastApp = lastAppObj;
 		}
-		if (scan_file(feil,nm)) {
-			fprintf(stderr,"Error scanning %s\n",nm); 
-			exit(1);
+	} else if ( dbName && nfile < argc && 0 == dbcLoad(dbName, argv + nfile, argc - nfile, &lastAppObj, DBC_FULL) ) {
+		/* database restored from the cache */
+	} else {
+		notesRecord = dbName && nfile < argc;
+		lastAppObj  = buildDatabase(argv + nfile, argc - nfile, options & OPT_PRESIZE_SYMTBL);
+		if ( notesRecord ) {
+			notesRecord = 0;
+			dbcWrite(dbName, argv + nfile, argc - nfile, lastAppObj, fileListFirst(), DBC_FULL);
 		}
-		/* the first file we scan contains the application's
-		 * mandatory file set - unless '-A' is used.
-		 */
-		if ( !lastAppObj )
-			lastAppObj = fileListTail;
-	} while (++nfile < argc);
-
-	for ( f = fileListFirst(); f; f=f->next )
-		fixupObj( f );
-
-	gatherDanglingUndefs();
+	}
 
+	statBegin(STAT_INDEX);
 	fileListIndex = fileListBuildIndex();
+	statEnd(STAT_INDEX);
 
 	fprintf(logf,"Looking for UNDEFINED symbols:\n");
-	for (i=0; i<fileListHead->nexports; i++) {
+	if ( listUndefs ) {
+		for (i=0; i<fileListHead->nexports; i++) {
 #if 0
-		trackSym(logf, fileListHead->exports[i].sym);
+			trackSym(logf, fileListHead->exports[i].sym);
 #else
-		fprintf(logf," - '%s'\n",fileListHead->exports[i].sym->name);
+			fprintf(logf," - '%s'\n",fileListHead->exports[i].sym->name);
 #endif
+		}
+	} else {
+		fprintf(logf," %i found (use '--list-undefs' to list them)\n", fileListHead->nexports);
 	}
 	fprintf(logf,"done\n");
 
@@ -2356,17 +8378,18 @@ Sym		*found;
 
 	linkSet = &appLinkSet;
 
+	statBegin(STAT_LINK);
 	if ( mainSym.name ) {
-		if ( !(found = (Sym*)tfind( &mainSym, &symTbl, symcmp )) ) {
+		if ( !(found = symTblFind( &symTbl, mainSym.name )) ) {
 			fprintf(stderr,"Error: unable to find main symbol '%s'\n",mainSym.name);
 			exit(1);
 		}
 
-		if ( !(*found)->exportedBy ) {
+		if ( !found->exportedBy ) {
 			fprintf(stderr,"Error: no object defines main application symbol '%s'\n",mainSym.name);
 		}
 
-		f = (*found)->exportedBy->obj;
+		f = found->exportedBy->obj;
 
 		fprintf(logf,"Main application symbol '%s' found in '", mainSym.name);
 		printObjName(logf,f);
@@ -2375,7 +8398,7 @@ Sym		*found;
 		assert( !f->link.anchor );
 		f->link.anchor = linkSet;
 		linkObj(f, mainSym.name, 0);
-		linkSet = hasOptional ? 0 : &optionalLinkSet;
+		linkSet = 0;
 
 		/* ignore lastAppObj */
 	}
@@ -2386,95 +8409,203 @@ Sym		*found;
 			linkObj(f, 0, 0);
 		}
 		if ( f==lastAppObj )
-			linkSet = hasOptional ? 0 : &optionalLinkSet;	
-	}
-
-	if ( options & OPT_QUIET ) {
-		fprintf(logf,"OK, that's it for now\n");
-		exit(0);
+			linkSet = 0;
 	}
+	statEnd(STAT_LINK);
+
+	/* evaluate every configuration starting from the state after linking the application */
+	if ( (first = nConfigs > 1 && configEmpty(&configs[0])) < nConfigs - 1 )
+		linkStateSave(&linked);
+
+	last = &configs[nConfigs - 1];
+
+	/* the incremental relink needs every object linked when the lists are processed */
+	if ( last != &configs[first] || last->hasOptional )
+		relink.name = 0;
+
+	for ( cf = &configs[first]; cf <= last; cf++ ) {
+		if ( cf > &configs[first] )
+			linkStateRestore(&linked);
+		if ( cf->name )
+			fprintf(logf,"Configuration '%s':\n", cf->name);
+
+		statBegin(STAT_LINK);
+		if ( !cf->hasOptional )
+			linkRest(&optionalLinkSet);
+		statEnd(STAT_LINK);
+
+		if ( options & OPT_QUIET ) {
+			fprintf(logf,"OK, that's it for now\n");
+			statReport();
+			if ( traceClose() )
+				exit(1);
+			exit( sockName && serve(sockName) ? 1 : 0 );
+		}
 
-	for ( i=0; i<nProc; i++ ) {
+		statBegin(STAT_PROCESS);
+		for ( i=0; i<cf->nProc; i++ ) {
 #define F_SLOPPYNESS	1
-		/* tolerate failure to unlink due to dependency on app link set */
-		if (F_SLOPPYNESS +
-			processFile( &procTab[i],
-						(options & OPT_SLOPPY_UNLINK) ? F_SLOPPYNESS : 0) < 0 )
-			exit(1);
-	}
+			/* tolerate failure to unlink due to dependency on app link set */
+			if (F_SLOPPYNESS +
+				processFile( &cf->procTab[i],
+							(options & OPT_SLOPPY_UNLINK) ? F_SLOPPYNESS : 0) < 0 )
+				exit(1);
+		}
+		statEnd(STAT_PROCESS);
 
+		statBegin(STAT_REPORTS);
+		if ( options & OPT_SHOW_SYMS )
+			symTblWalk(&symTbl, symTraceAct, 0);
 
-	if ( options & OPT_SHOW_SYMS )
-		twalk(symTbl, symTraceAct);
+		for ( i=0; i<nTracSyms; i++ ) {
+			Sym fnd = symTblFind( &symTbl, tracSyms[i] );
+			if ( ! fnd ) {
+				fprintf(logf, "Symbol '%s' not found (-t option) -- ignoring\n", tracSyms[i]);
+				continue;
+			}
 
-	for ( i=0; i<nTracSyms; i++ ) {
-		SymRec s;
-		s.name = tracSyms[i];
-		Sym   *fnd = (Sym*)tfind( &s, &symTbl, symcmp );
-		if ( ! fnd ) {
-			fprintf(logf, "Symbol '%s' not found (-t option) -- ignoring\n", s.name);
-			continue;
+			trackSym(logf, fnd);
 		}
 
-		trackSym(logf, *fnd);
-	}
-
-	if ( options & OPT_SHOW_DEPS ) {
-			for (f=fileListFirst(); f; f=f->next) {
-			DepPrintArgRec arg;
-				arg.minDepth    =  0;
-				arg.indent      = -4;
-				arg.depthIndent = 2;
-				arg.file		= logf;
+		if ( options & OPT_SHOW_DEPS ) {
+				for (f=fileListFirst(); f; f=f->next) {
+				DepPrintArgRec arg;
+					arg.minDepth    =  0;
+					arg.indent      = -4;
+					arg.depthIndent = 2;
+					arg.file		= logf;
 #if 0
-			/* this recursion can become VERY deep */
-			fprintf(logf,"\n\nDependencies ON object: ");
-			depwalk(f, depPrint, (void*)&arg, WALK_EXPORTS);
+				/* this produces VERY large amounts of output */
+				fprintf(logf,"\n\nDependencies ON object: ");
+				depwalk(&depwalkMain, f, depPrint, (void*)&arg, WALK_EXPORTS);
 #endif
-			fprintf(logf,"\nFlat dependency list for objects requiring: %s\n", f->name);
-			arg.indent      = 0;
-			arg.depthIndent = -1;
-			depwalk(f, depPrint, (void*)&arg, WALK_EXPORTS | WALK_BUILD_LIST);
-			depwalkListRelease(f);
+				fprintf(logf,"\nFlat dependency list for objects requiring: %s\n", f->name);
+				arg.indent      = 0;
+				arg.depthIndent = -1;
+				depwalk(&depwalkMain, f, depPrint, (void*)&arg, WALK_EXPORTS | WALK_BUILD_LIST);
+				depwalkListRelease(&depwalkMain, f);
+			}
 		}
-	}
 
-	fprintf(logf,"Removing undefined symbols\n");
-	unlinkUndefs();
+		if ( options & OPT_SHOW_DEPS_COMPACT )
+			showDepsCompact(logf);
+		statEnd(STAT_REPORTS);
 
-	fprintf(logf,"Removing multiply defined symbols\n");
-	unlinkMultdefs();
+		fprintf(logf,"Removing undefined symbols\n");
+		statBegin(STAT_UNLINK_UNDEFS);
+		if ( relink.name && 0 == relinkUndefs(&relink) )
+			/* the previous run's removals were reused */;
+		else if ( batchUnlink )
+			unlinkUndefsBatch();
+		else
+			unlinkUndefs();
+		if ( relink.name )
+			relinkSave(&relink);
+		statEnd(STAT_UNLINK_UNDEFS);
+
+		fprintf(logf,"Removing multiply defined symbols\n");
+		statBegin(STAT_UNLINK_MULTDEFS);
+		unlinkMultdefs();
+		statEnd(STAT_UNLINK_MULTDEFS);
+
+		if ( cf == last )
+			lowMemRelease(0);
+
+		for ( i=0; i<nImpacts; i++ ) {
+		ObjF	*fnd;
+		int		nf, k;
+			fprintf(logf,"What-if ('--impact=%s'):\n", impacts[i]);
+			nf = queryFindObjs(logf, impacts[i], &fnd);
+			for ( k=0; k<nf; k++ )
+				impactReport(logf, fnd[k]);
+		}
 
-	if ( options & OPT_INTERACTIVE ) {
-		interactive(stderr);
-	}
+		if ( options & OPT_INTERACTIVE ) {
+			interactive(stderr);
+		}
 
-	assert( 0 == checkObjPtrs() );
+		/* the server needs the index */
+		if ( cf == last && !sockName )
+			lowMemRelease(1);
+
+		assert( 0 == checkObjPtrs() );
 
-	if ( scrn ) {
-		fprintf(logf,"Writing linker script to '%s'...", scrn);
-		if ( !(scrf = fopen(scrn,"w")) ) {
-			perror("opening script file");
-			fprintf(logf,"opening file failed.\n");
-			exit (1);
+		statBegin(STAT_WRITE);
+		if ( cf->scrn ) {
+			fprintf(logf,"Writing linker script to '%s'...", cf->scrn);
+			if ( !(scrf = outOpen(cf->scrn, &tmpn, incremental || sortedOutput)) ) {
+				perror("opening script file");
+				fprintf(logf,"opening file failed.\n");
+				exit (1);
+			}
+			writeScript(scrf, options & OPT_NO_APPSET);
+			if ( outClose(scrf, cf->scrn, tmpn) ) {
+				perror("writing script file");
+				fprintf(logf,"writing file failed.\n");
+				exit (1);
+			}
+			fprintf(logf,"done.\n");
 		}
-		writeScript(scrf, options & OPT_NO_APPSET);
-		fclose(scrf);
-		fprintf(logf,"done.\n");
-	}
-	if ( srcn ) {
-		fprintf(logf,"Writing CEXP symbol table source file to '%s'...", srcn);
-		if ( !(scrf = fopen(srcn,"w")) ) {
-			perror("opening source file");
-			fprintf(logf,"opening file failed.\n");
-			exit (1);
+		if ( cf->srcn ) {
+			fprintf(logf,"Writing CEXP symbol table source file to '%s'...", cf->srcn);
+			if ( !(scrf = outOpen(cf->srcn, &tmpn, incremental || sortedOutput)) ) {
+				perror("opening source file");
+				fprintf(logf,"opening file failed.\n");
+				exit (1);
+			}
+			writeSource(scrf, options & OPT_NO_APPSET);
+			if ( outClose(scrf, cf->srcn, tmpn) ) {
+				perror("writing source file");
+				fprintf(logf,"writing file failed.\n");
+				exit (1);
+			}
+			fprintf(logf,"done.\n");
+		}
+		if ( cf->cmpn ) {
+			fprintf(logf,"Writing compact CEXP symbol table to '%s'...", cf->cmpn);
+			if ( !(scrf = outOpen(cf->cmpn, &tmpn, incremental || sortedOutput)) ) {
+				perror("opening compact symbol table file");
+				fprintf(logf,"opening file failed.\n");
+				exit (1);
+			}
+			writeCompactSource(scrf, options & OPT_NO_APPSET);
+			if ( outClose(scrf, cf->cmpn, tmpn) ) {
+				perror("writing compact symbol table file");
+				fprintf(logf,"writing file failed.\n");
+				exit (1);
+			}
+			fprintf(logf,"done.\n");
+		}
+		if ( cf->expn ) {
+			fprintf(logf,"Exporting the object graph to '%s'...", cf->expn);
+			if ( !(scrf = outOpen(cf->expn, &tmpn, incremental || sortedOutput)) ) {
+				perror("opening graph export file");
+				fprintf(logf,"opening file failed.\n");
+				exit (1);
+			}
+			writeGraph(scrf, graphFormat(cf->expn));
+			if ( outClose(scrf, cf->expn, tmpn) ) {
+				perror("writing graph export file");
+				fprintf(logf,"writing file failed.\n");
+				exit (1);
+			}
+			fprintf(logf,"done.\n");
 		}
-		writeSource(scrf, options & OPT_NO_APPSET);
-		fclose(scrf);
-		fprintf(logf,"done.\n");
+		statEnd(STAT_WRITE);
 	}
+	linkStateFree(&linked);
+
+	statReport();
+
+	if ( traceClose() )
+		exit(1);
+
+	if ( sockName && serve(sockName) )
+		exit(1);
 
-	free(procTab);
+	for ( i=0; i<nConfigs; i++ )
+		free(configs[i].procTab);
+	free(configs);
 
 	return 0;
 }
@@ -0,0 +1,266 @@
+/* generate synthetic 'nm -g -fposix' listings for benchmarking ldep ('make bench') */
+
+/* Consult the LICENSE file (same terms as ldep) */
+
+/*
+ * The generated set consists of
+ *
+ *   <prefix>-app.nm        application objects (the first 'nm_file')
+ *   <prefix>-lib<N>.nm     one file per library
+ *   <prefix>.x             an exclude list ('-x') with some library members
+ *
+ * Library members are spread over 'depth' layers; a member imports from
+ * the next layer (so dependency chains are 'depth' long) or, with the
+ * cycle probability, from its own or an earlier layer. The application
+ * imports from the first layer. Some imports are left undefined.
+ *
+ * Output is a function of the parameters only (own random number
+ * generator) so that runs can be compared.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+typedef struct ParmsRec_ {
+	int			libs;		/* number of libraries */
+	int			members;	/* members per library */
+	int			syms;		/* symbols exported per member */
+	int			imports;	/* symbols imported per member */
+	int			appObjs;	/* application objects */
+	int			depth;		/* dependency layers */
+	int			weak;		/* percentage of weak definitions */
+	int			common;		/* percentage of common symbols */
+	int			undef;		/* percentage of undefined imports */
+	int			cycles;		/* percentage of imports going back (creating cycles) */
+	int			excludes;	/* members listed in the exclude file */
+	unsigned	seed;
+	char		*prefix;
+} ParmsRec, *Parms;
+
+static unsigned long rngState;
+
+/* RETURNS a pseudo random number in 0..n-1 (64-bit LCG, high bits) */
+static unsigned
+rnd(unsigned n)
+{
+	rngState = rngState * 6364136223846793005UL + 1442695040888963407UL;
+	return n ? (unsigned)((rngState >> 33) % n) : 0;
+}
+
+/* RETURNS nonzero with a probability of 'percent' */
+static int
+chance(int percent)
+{
+	return (int)rnd(100) < percent;
+}
+
+/* total number of library members (numbered lib * members + i) */
+static int
+nMembers(Parms p)
+{
+	return p->libs * p->members;
+}
+
+/*
+ * pick a random member of layer 'l' (-1 if the layer is empty);
+ * layer 'l' holds the members l, l + depth, l + 2*depth, ...
+ */
+static int
+layerMember(Parms p, int l)
+{
+int n = nMembers(p);
+int k = (n - l + p->depth - 1) / p->depth;
+
+	if ( l >= n || k <= 0 )
+		return -1;
+	return l + rnd(k) * p->depth;
+}
+
+static void
+printSym(FILE *f, int member, int sym)
+{
+	fprintf(f, "s%d_%d", member, sym);
+}
+
+/* emit the definitions of member 'm' */
+static void
+defineSyms(FILE *f, Parms p, int m)
+{
+int  i;
+char t;
+
+	for ( i = 0; i < p->syms; i++ ) {
+		printSym(f, m, i);
+		if ( chance(p->common) ) {
+			fprintf(f, " C %x %x\n", 8, 8);
+			continue;
+		}
+		t = (i & 1) ? 'D' : 'T';
+		if ( chance(p->weak) )
+			t = 'T' == t ? 'W' : 'V';
+		fprintf(f, " %c %x %x\n", t, 16 * i, 4 + rnd(64));
+	}
+}
+
+/* emit the imports of an object in layer 'l' ('self': its member number or -1) */
+static void
+importSyms(FILE *f, Parms p, int l, int self)
+{
+int i, tl, m;
+
+	for ( i = 0; i < p->imports; i++ ) {
+		if ( chance(p->undef) ) {
+			fprintf(f, "undef_%u U\n", rnd(1000000));
+			continue;
+		}
+		if ( l > 0 && chance(p->cycles) )
+			tl = rnd(l + 1);
+		else
+			tl = l + 1;
+		if ( tl >= p->depth || (m = layerMember(p, tl)) < 0 || m == self )
+			continue;
+		printSym(f, m, rnd(p->syms));
+		fprintf(f, " U\n");
+	}
+}
+
+static FILE *
+openOut(Parms p, const char *fmt, int n)
+{
+char *nm;
+FILE *f;
+
+	if ( !(nm = malloc(strlen(p->prefix) + strlen(fmt) + 20)) ) {
+		perror("malloc");
+		exit(1);
+	}
+	sprintf(nm, "%s", p->prefix);
+	sprintf(nm + strlen(nm), fmt, n);
+	if ( !(f = fopen(nm, "w")) ) {
+		fprintf(stderr, "Unable to create '%s': %s\n", nm, strerror(errno));
+		exit(1);
+	}
+	free(nm);
+	return f;
+}
+
+static void
+generate(Parms p)
+{
+FILE *f;
+int  lib, i, m;
+
+	rngState = p->seed;
+
+	/* application objects import from the first layer */
+	f = openOut(p, "-app.nm", 0);
+	for ( i = 0; i < p->appObjs; i++ ) {
+		fprintf(f, "app%d.o:\n", i);
+		if ( 0 == i )
+			fprintf(f, "main T 0 10\n");
+		fprintf(f, "app_%d T 10 10\n", i);
+		importSyms(f, p, -1, -1);
+	}
+	fclose(f);
+
+	for ( lib = 0; lib < p->libs; lib++ ) {
+		f = openOut(p, "-lib%d.nm", lib);
+		for ( i = 0; i < p->members; i++ ) {
+			m = lib * p->members + i;
+			fprintf(f, "libbench%d.a[m%d.o]:\n", lib, m);
+			defineSyms(f, p, m);
+			importSyms(f, p, m % p->depth, m);
+		}
+		fclose(f);
+	}
+
+	f = openOut(p, ".x", 0);
+	for ( i = 0; i < p->excludes; i++ ) {
+		m = rnd(nMembers(p));
+		fprintf(f, "libbench%d.a[m%d.o]:\n", m / p->members, m);
+	}
+	fclose(f);
+}
+
+static void
+usage(const char *nm)
+{
+	fprintf(stderr, "Usage: %s [-h] [-l libs] [-m members] [-s syms] [-i imports] [-a app_objs]\n", nm);
+	fprintf(stderr, "          [-d depth] [-w weak%%] [-c common%%] [-u undef%%] [-y cycle%%]\n");
+	fprintf(stderr, "          [-x excludes] [-r seed] [-o prefix]\n\n");
+	fprintf(stderr, "   Generate synthetic 'nm -g -fposix' listings for benchmarking ldep:\n");
+	fprintf(stderr, "   'prefix'-app.nm, 'prefix'-lib<N>.nm and an exclude list 'prefix'.x\n\n");
+	fprintf(stderr, "     -l:   number of libraries (default 10)\n");
+	fprintf(stderr, "     -m:   members per library (default 1000)\n");
+	fprintf(stderr, "     -s:   symbols defined per member (default 4)\n");
+	fprintf(stderr, "     -i:   symbols imported per member (default 4)\n");
+	fprintf(stderr, "     -a:   application objects (default 10)\n");
+	fprintf(stderr, "     -d:   dependency depth; members are spread over 'depth' layers and import\n");
+	fprintf(stderr, "           from the next one (default 20)\n");
+	fprintf(stderr, "     -w:   percentage of weak definitions (default 5)\n");
+	fprintf(stderr, "     -c:   percentage of common symbols (default 2)\n");
+	fprintf(stderr, "     -u:   percentage of imports which are undefined (default 1)\n");
+	fprintf(stderr, "     -y:   percentage of imports from the same or an earlier layer (cycles;\n");
+	fprintf(stderr, "           default 2)\n");
+	fprintf(stderr, "     -x:   members listed in the exclude file (default 10)\n");
+	fprintf(stderr, "     -r:   random seed (default 1)\n");
+	fprintf(stderr, "     -o:   output file prefix (default 'bench')\n");
+}
+
+int
+main(int argc, char **argv)
+{
+ParmsRec	p;
+int			ch;
+
+	p.libs     = 10;
+	p.members  = 1000;
+	p.syms     = 4;
+	p.imports  = 4;
+	p.appObjs  = 10;
+	p.depth    = 20;
+	p.weak     = 5;
+	p.common   = 2;
+	p.undef    = 1;
+	p.cycles   = 2;
+	p.excludes = 10;
+	p.seed     = 1;
+	p.prefix   = "bench";
+
+	while ( (ch = getopt(argc, argv, "hl:m:s:i:a:d:w:c:u:y:x:r:o:")) >= 0 ) {
+		switch ( ch ) {
+			default:
+				usage(argv[0]);
+			return 1;
+
+			case 'h':
+				usage(argv[0]);
+			return 0;
+
+			case 'l': p.libs     = atoi(optarg); break;
+			case 'm': p.members  = atoi(optarg); break;
+			case 's': p.syms     = atoi(optarg); break;
+			case 'i': p.imports  = atoi(optarg); break;
+			case 'a': p.appObjs  = atoi(optarg); break;
+			case 'd': p.depth    = atoi(optarg); break;
+			case 'w': p.weak     = atoi(optarg); break;
+			case 'c': p.common   = atoi(optarg); break;
+			case 'u': p.undef    = atoi(optarg); break;
+			case 'y': p.cycles   = atoi(optarg); break;
+			case 'x': p.excludes = atoi(optarg); break;
+			case 'r': p.seed     = strtoul(optarg, 0, 0); break;
+			case 'o': p.prefix   = optarg; break;
+		}
+	}
+
+	if ( p.libs < 1 || p.members < 1 || p.syms < 1 || p.depth < 1 || p.appObjs < 1 ) {
+		fprintf(stderr, "libraries, members, symbols, depth and application objects must be > 0\n");
+		return 1;
+	}
+
+	generate(&p);
+	return 0;
+}
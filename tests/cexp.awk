@@ -0,0 +1,51 @@
+# 'make check': list the symbols of a CEXP symbol table, either C
+# source ('-C') or compact assembly ('-K'), as 'name type size flags'
+# lines (in table order) so that the two can be compared.
+
+function flagstr(glbl, weak) {
+	return (glbl ? "GLBL" : "") (weak ? "|WEAK" : "")
+}
+
+# -C
+/^\t\t\.name *= "/ {
+	name = $0; sub(/^[^"]*"/, "", name); sub(/",$/, "", name)
+	next
+}
+/^\t\t\.value\.type *=/ {
+	type = $0; sub(/^[^=]*= */, "", type); sub(/, *$/, "", type)
+	next
+}
+/^\t\t\.size *=/ {
+	size = $0; sub(/^[^=]*= */, "", size); sub(/, *$/, "", size)
+	next
+}
+/^\t\t\.flags *=/ {
+	print name, type, size, flagstr(/CEXP_SYMFLG_GLBL/, /CEXP_SYMFLG_WEAK/)
+	next
+}
+
+# -K
+/^[a-zA-Z]*:$/ {
+	sect = $1
+	next
+}
+sect == "cexpCompactSizes:" && /^\t\.long / {
+	sub(/^\t\.long /, ""); n = split($0, v, ",")
+	for ( i = 1; i <= n; i++ )
+		sizes[nsizes++] = v[i]
+}
+sect == "cexpCompactInfo:" && /^\t\.byte / {
+	sub(/^\t\.byte /, ""); n = split($0, v, ",")
+	for ( i = 1; i <= n; i++ )
+		info[ninfo++] = v[i]
+}
+sect == "cexpCompactStrings:" && /^\t\.asciz "/ {
+	s = $0; sub(/^[^"]*"/, "", s); sub(/"$/, "", s)
+	names[nnames++] = s
+}
+
+END {
+	split("TVoid TFuncP TVoidP", types, " ")
+	for ( i = 0; i < nnames; i++ )
+		print names[i], types[info[i] % 4 + 1], sizes[i], flagstr(int(info[i] / 4) % 2, int(info[i] / 8) % 2)
+}
@@ -0,0 +1,267 @@
+#!/bin/sh
+#
+# Differential check ('make check'); run in the build directory:
+#
+#   check.sh <tests_dir> <ldep> <ldep-ref> [nm_files]
+#
+# 'ldep-ref' is ldep as of the baseline revision (see Makefile.in). For
+# every input set it runs with the options the baseline understands; each
+# variant of ldep must produce the same linker script ('-e'), CEXP source
+# ('-C'), log, warnings and exit status as the reference. The log of ldep
+# lists the undefined symbols only with '--list-undefs' which it therefore
+# always gets. The object graph ('--export') of every variant must be that
+# of the plain (ser) run. Variants handled specially:
+#
+#   sorted     '-R': the files are compared sorted
+#   K          '-K': the compact table must list the symbols of '-C'
+#   config     two '--config's (the reference options and none at all)
+#              against two reference runs; only the files are compared
+#   D          '-D' against the reference's '-d' (sets with at most
+#              CHECK_DEPS_MAX objects only)
+#   relink     incremental runs ('-I') while the application changes: one
+#              with the original application (saving the state), one with
+#              some of its imports dropped, which must reuse that state
+#              (unless '-o' lists rule it out), and one with the original
+#              again; each against the reference on the same inputs
+#
+# The input sets are the synthetic one (nmgen, CHECK_NMGEN_OPTS) or
+# 'nm_files' (with exclude list CHECK_X), the real listings in
+# <tests_dir>/corpus and, if the C compiler builds them, archives of
+# <tests_dir>/elf-*.c which must give the same results as their 'nm'
+# listings. CHECK_OPTS are passed to all runs (reference included).
+# The server ('-S', using <tests_dir>/sclient.c as the client) must answer
+# malformed requests with an error, serve a client while another one
+# stops reading and refuse to replace a file which isn't a socket. A '-R'
+# run whose output can't be replaced must fail and leave no temporary file.
+#
+# Exit status: 0 if all are the same, 1 otherwise.
+
+T=$1; PROG=$2; REF=$3; shift 3
+
+: ${CHECK_VARIANTS:="B j4 Bj4 lowmem cache cached libcache libcached relink sorted K config D"}
+: ${CHECK_NMGEN_OPTS:="-l 10 -m 500 -x 40"}
+: ${CHECK_DEPS_MAX:=1000}
+: ${CC:=cc} ${AR:=ar} ${NM:=nm}
+
+fail=0
+
+# run <prefix> <binary> <options...>: output in <prefix>.{log,err,rc}
+run() {
+	rp=$1; rb=$2; shift 2
+	$rb "$@" > $rp.log 2> $rp.err
+	echo $? > $rp.rc
+}
+
+# same <file> <file>: (quietly) compare
+same() {
+	cmp -s "$1" "$2"
+}
+
+# report <set> <variant> <differing parts>
+report() {
+	if [ -z "$3" ]; then
+		res=same
+	else
+		res="DIFFERS:$3"; fail=1
+	fi
+	t=`sed -n 's/.*"total": { "wall": \([0-9.]*\).*/\1/p' check-$1-$2.json 2>/dev/null`
+	printf "%-7s %-9s %-24s total %s s\n" $1 $2 "$res" "${t:--}"
+}
+
+# check <set> <options> <nm_files...>
+check() {
+	s=$1; o=$2; shift 2
+	r=check-$s-ref
+	rm -f check-$s-*.db check-$s-*.db.state check-$s-*.rc
+
+	run $r $REF $CHECK_OPTS $o -e $r.lds -C $r.c "$@"
+	awk -f $T/cexp.awk $r.c > $r.cexp
+
+	for v in ser $CHECK_VARIANTS; do
+		p=check-$s-$v
+		case $v in
+			ser)		x="";;
+			B)			x="-B";;
+			j4)			x="-j 4";;
+			Bj4)		x="-B -j 4";;
+			lowmem)		x="--low-mem";;
+			cache|cached)
+						x="-c check-$s-full.db";;
+			libcache|libcached)
+						x="-c check-$s-lib.db -I";;
+			sorted)		x="-R";;
+			K)			x="-K $p.S";;
+			config|D|relink)
+						x="";;
+			*)			echo "Unknown variant '$v'"; exit 1;;
+		esac
+
+		d=""
+		case $v in
+			config)
+				run check-$s-refb $REF $CHECK_OPTS \
+					-e check-$s-refb.lds -C check-$s-refb.c "$@"
+				run $p $PROG $CHECK_OPTS --stats-json=$p.json \
+					--config=a $o -e $p-a.lds -C $p-a.c \
+					--config=b -e $p-b.lds -C $p-b.c "$@"
+				same $r.rc $p.rc             || d="$d rc"
+				same $r.lds $p-a.lds         || d="$d lds"
+				same $r.c $p-a.c             || d="$d c"
+				same check-$s-refb.lds $p-b.lds || d="$d lds(b)"
+				same check-$s-refb.c $p-b.c     || d="$d c(b)"
+				report $s $v "$d"
+				continue
+			;;
+			D)
+				n=`cat "$@" | grep -c ':$'`
+				if [ $n -gt $CHECK_DEPS_MAX ]; then
+					printf "%-7s %-9s skipped (%i objects)\n" $s $v $n
+					continue
+				fi
+				run check-$s-refd $REF $CHECK_OPTS -d "$@"
+				run $p $PROG $CHECK_OPTS --stats-json=$p.json -D "$@"
+				awk -f $T/deps.awk check-$s-refd.log | sort > check-$s-refd.deps
+				awk -f $T/deps.awk $p.log | sort > $p.deps
+				same check-$s-refd.rc $p.rc      || d="$d rc"
+				same check-$s-refd.deps $p.deps  || d="$d deps"
+				report $s $v "$d"
+				continue
+			;;
+			relink)
+				a=check-$s-app2.nm; app=$1; shift
+				awk '/ U$/ { if ( ++n % 3 == 0 ) next } { print }' $app > $a
+				run check-$s-ref2 $REF $CHECK_OPTS $o \
+					-e check-$s-ref2.lds -C check-$s-ref2.c $a "$@"
+				for i in 1 2 3; do
+					case $i in
+						2)	ri=check-$s-ref2; ai=$a;;
+						*)	ri=$r; ai=$app;;
+					esac
+					pi=$p-$i
+					run $pi $PROG --list-undefs $CHECK_OPTS $o --stats-json=$p.json \
+						-c check-$s-relink.db -I -e $pi.lds -C $pi.c $ai "$@"
+					sed -e "s/$pi\./$ri./g" -e "/^Incremental relink: /d" $pi.log > $pi.log.n
+					same $ri.rc  $pi.rc    || d="$d rc($i)"
+					same $ri.log $pi.log.n || d="$d log($i)"
+					same $ri.err $pi.err   || d="$d err($i)"
+					same $ri.lds $pi.lds   || d="$d lds($i)"
+					same $ri.c   $pi.c     || d="$d c($i)"
+				done
+				case " $o " in
+					*" -o "*)	;;
+					*)			grep -q '^Incremental relink: previous state reused' $p-2.log || d="$d reuse";;
+				esac
+				set -- "$app" "$@"
+				report $s $v "$d"
+				continue
+			;;
+		esac
+
+		run $p $PROG --list-undefs $CHECK_OPTS $o $x --stats-json=$p.json \
+			-e $p.lds -C $p.c --export=$p.graph "$@"
+		# the log names the output files; the reference writes no '-K', '--export'
+		# or incremental relink notes
+		sed -e "s/$p\./$r./g" -e "/^Writing compact CEXP symbol table to /d" \
+			-e "/^Exporting the object graph to /d" -e "/^Incremental relink: /d" $p.log > $p.log.n
+
+		same $r.rc    $p.rc    || d="$d rc"
+		same $r.log   $p.log.n || d="$d log"
+		same $r.err   $p.err   || d="$d err"
+		case $v in
+			sorted)
+				sort $r.lds    > $r.lds.s;    sort $p.lds > $p.lds.s
+				sort $r.cexp   > $r.cexp.s;   awk -f $T/cexp.awk $p.c | sort > $p.cexp.s
+				same $r.lds.s  $p.lds.s  || d="$d lds"
+				same $r.cexp.s $p.cexp.s || d="$d c"
+			;;
+			*)
+				same $r.lds $p.lds || d="$d lds"
+				same $r.c   $p.c   || d="$d c"
+			;;
+		esac
+		if [ K = $v ]; then
+			awk -f $T/cexp.awk $p.S > $p.cexp
+			same $r.cexp $p.cexp || d="$d S"
+		fi
+		if [ ser != $v ]; then
+			same check-$s-ser.graph $p.graph || d="$d graph"
+		fi
+		report $s $v "$d"
+	done
+}
+
+if [ $# -gt 0 ]; then
+	check nm "${CHECK_X:+-x $CHECK_X}" "$@"
+else
+	./nmgen $CHECK_NMGEN_OPTS -o check-synth > /dev/null || exit 1
+	check synth "-x check-synth.x" check-synth-app.nm `ls check-synth-lib*.nm`
+fi
+
+C=$T/corpus
+CORPUS="$C/app.nm $C/libz.nm $C/libbz2.nm $C/libSM.nm $C/libICE.nm $C/libXau.nm $C/libXdmcp.nm"
+check corpus "-x $C/excl.lst -o $C/opt.lst" $CORPUS
+
+# an output file which can't be replaced ('-R') fails the run without leftovers
+rm -rf check-corpus-dir.lds*; mkdir check-corpus-dir.lds
+$PROG -R -e check-corpus-dir.lds $CORPUS > /dev/null 2>&1 && d=" rc" || d=""
+[ -z "`ls -d check-corpus-dir.lds.* 2>/dev/null`" ] || d="$d tmp"
+report corpus outfail "$d"
+
+# the server ('-S') on the corpus: malformed requests get an error reply,
+# a client which doesn't read its replies doesn't hold up the others and
+# a file which isn't a socket is not replaced
+if $CC $CFLAGS -o check-sclient $T/sclient.c 2>/dev/null; then
+	sock=check-server.sock
+	rm -f $sock
+	$PROG -q -S $sock $CORPUS > check-server.log 2> check-server.err &
+	srv=$!
+	awk 'BEGIN { for ( i = 0; i < 20000; i++ ) print "find *" }' > check-server-stall.req
+	./check-sclient -s 30 $sock < check-server-stall.req & stall=$!
+	printf 'find * -100000000\nfind * 1x\nfind libz.a[*] 2\nquit\n' |
+		./check-sclient -t 5 $sock > check-server-find.out
+	echo shutdown | ./check-sclient -t 5 $sock > /dev/null
+	wait $srv; rc=$?
+	kill $stall 2>/dev/null
+	d=""
+	[ 0 = $rc ]                                                    || d="$d rc"
+	[ `grep -c '^Invalid first match' check-server-find.out` = 2 ] || d="$d first"
+	grep -q '^  libz.a\[deflate.o\]' check-server-find.out         || d="$d find"
+	report server find "$d"
+
+	echo keep > check-server.file
+	$PROG -q -S check-server.file $CORPUS > /dev/null 2>&1 && d=" rc" || d=""
+	[ keep = "`cat check-server.file`" ] || d="$d file"
+	report server file "$d"
+else
+	printf "%-7s %-9s skipped (sclient.c doesn't compile)\n" server find
+fi
+
+# ELF objects and archives against their listings
+for s in elf-app elf-lib1 elf-lib2; do
+	if ! $CC $CFLAGS -c -o check-$s.o $T/$s.c 2>/dev/null; then
+		printf "%-7s %-9s skipped (%s.c doesn't compile)\n" elf archive $s
+		exit $fail
+	fi
+done
+rm -f check-elf-app.a check-elf-lib.a
+$AR rc check-elf-app.a check-elf-app.o &&
+$AR rc check-elf-lib.a check-elf-lib1.o check-elf-lib2.o &&
+$NM -g -fposix check-elf-app.a > check-elf-app.nm &&
+$NM -g -fposix check-elf-lib.a > check-elf-lib.nm || exit 1
+for v in nm archive; do
+	p=check-elf-$v
+	case $v in
+		nm)			i="check-elf-app.nm check-elf-lib.nm";;
+		archive)	i="check-elf-app.a check-elf-lib.a";;
+	esac
+	run $p $PROG -u -l --list-undefs --stats-json=$p.json \
+		-e $p.lds --export=$p.graph $i
+	sed -e "s/$p\./check-elf-nm./g" $p.log > $p.log.n
+done
+d=""
+for f in rc log.n err lds graph; do
+	same check-elf-nm.$f check-elf-archive.$f || d="$d $f"
+done
+report elf archive "$d"
+
+exit $fail
@@ -0,0 +1,57 @@
+# 'make check': turn the dependency listing of '-d' (per object, all
+# objects requiring it) or of '-D' (components and, per component, all
+# components requiring it) into 'object <- requiring object' lines;
+# the results of both (sorted) must be the same.
+
+# -d
+/^Flat dependency list for objects requiring: / {
+	blk = 1; key = ""
+	next
+}
+
+# -D
+/^Dependency components / {
+	comps = 1
+	next
+}
+/^Flat dependency list for components requiring:/ {
+	comps = 0; reqs = 1
+	next
+}
+
+/^$/ || /^Removing / || /^Looking for / {
+	blk = comps = reqs = 0
+	next
+}
+
+blk {
+	if ( "" == key )
+		key = $1
+	else
+		print key " <- " $1
+	next
+}
+
+comps {
+	c = $1; sub(/:$/, "", c)
+	memb[c] = ""
+	for ( i = 2; i <= NF; i++ )
+		memb[c] = memb[c] " " $i
+	next
+}
+
+reqs {
+	c = $1; sub(/:$/, "", c)
+	n = split(memb[c], self, " ")
+	for ( i = 1; i <= n; i++ ) {
+		for ( j = 1; j <= n; j++ )
+			if ( i != j )
+				print self[i] " <- " self[j]
+		for ( k = 2; k <= NF; k++ ) {
+			m = split(memb[$k], req, " ")
+			for ( j = 1; j <= m; j++ )
+				print self[i] " <- " req[j]
+		}
+	}
+	next
+}
@@ -0,0 +1,12 @@
+/*
+ * 'make check' (elf): the application, stored in an archive of its
+ * own. Together with elf-lib1.c and elf-lib2.c it covers the symbol
+ * classes of 'nm -g -fposix' which ldep reads from ELF objects itself.
+ */
+extern int lib1_fn(void);
+
+int
+main(void)
+{
+	return lib1_fn();
+}
@@ -0,0 +1,50 @@
+/* 'make check' (elf): first library member */
+extern int lib2_fn(void);
+extern void lib1_weakref(void) __attribute__((weak));	/* 'w' */
+
+int			lib1_data = 1;								/* 'D' */
+const int	lib1_rodata = 2;							/* 'R' */
+int			lib1_bss;									/* 'B' */
+int			lib1_common __attribute__((common));		/* 'C' */
+__thread int lib1_tls = 3;								/* 'D' */
+int			lib1_weakobj __attribute__((weak)) = 4;		/* 'V' */
+
+void __attribute__((weak))
+lib1_weakfn(void)										/* 'W' */
+{
+}
+
+static int
+impl(void)
+{
+	return lib1_rodata;
+}
+
+static void *
+resolve(void)
+{
+	return (void*)impl;
+}
+
+int lib1_ifunc(void) __attribute__((ifunc("resolve")));	/* 'i' */
+
+/* 'u': a unique global, as g++ emits it for the statics of inline
+ * functions; elf-lib2.c defines it, too
+ */
+__asm__(
+	".section .data.shared_tag,\"aw\"\n"
+	"	.globl	shared_tag\n"
+	"	.type	shared_tag, @gnu_unique_object\n"
+	"	.size	shared_tag, 4\n"
+	"shared_tag:\n"
+	"	.long	1\n"
+	"	.previous\n"
+);
+
+int
+lib1_fn(void)											/* 'T' */
+{
+	if ( lib1_weakref )
+		lib1_weakref();
+	return lib1_ifunc() + lib2_fn();
+}
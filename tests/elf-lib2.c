@@ -0,0 +1,25 @@
+/* 'make check' (elf): second library member */
+extern int lib1_data;
+extern int missing_fn(void);							/* 'U', undefined */
+
+__asm__(
+	".section .data.shared_tag,\"aw\"\n"
+	"	.globl	shared_tag\n"
+	"	.type	shared_tag, @gnu_unique_object\n"
+	"	.size	shared_tag, 4\n"
+	"shared_tag:\n"
+	"	.long	1\n"
+	"	.previous\n"
+);
+
+int
+lib2_fn(void)
+{
+	return lib1_data + missing_fn();
+}
+
+int
+lib2_unused(void)
+{
+	return 0;
+}
@@ -0,0 +1,136 @@
+/* minimal client for the ldep server ('-S'), used by 'make check' */
+
+/* Consult the LICENSE file (same terms as ldep) */
+
+/*
+ * sclient [-w wait] [-t timeout] [-s stall] <socket>
+ *
+ * Sends the requests read from stdin and copies the replies to stdout
+ * until the server closes the connection. The server may still be
+ * loading: connecting is retried for 'wait' seconds. Without a reply for
+ * 'timeout' seconds the client gives up (exit status 2). With '-s' the
+ * client sends its requests but doesn't read any reply for 'stall'
+ * seconds (a client that stopped reading must not hold up the others).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static void
+timedOut(int sig)
+{
+	static const char msg[] = "sclient: timed out\n";
+	write(2, msg, sizeof(msg) - 1);
+	_exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+struct sockaddr_un	addr;
+struct pollfd		pfd;
+char				*req = 0, buf[4096];
+size_t				len = 0, sent = 0;
+int					wait = 30, timeout = 10, stall = 0;
+int					ch, fd, i, got;
+
+	while ( (ch = getopt(argc, argv, "w:t:s:h")) > 0 ) {
+		switch ( ch ) {
+			case 'w': wait    = atoi(optarg); break;
+			case 't': timeout = atoi(optarg); break;
+			case 's': stall   = atoi(optarg); break;
+			default:
+				fprintf(stderr,"usage: %s [-w wait] [-t timeout] [-s stall] <socket>\n", argv[0]);
+				return 'h' == ch ? 0 : 1;
+		}
+	}
+	if ( optind + 1 != argc || strlen(argv[optind]) >= sizeof(addr.sun_path) ) {
+		fprintf(stderr,"%s: need a (short enough) socket path\n", argv[0]);
+		return 1;
+	}
+
+	/* the requests */
+	do {
+		if ( !(req = realloc(req, len + sizeof(buf))) ) {
+			perror("sclient: no memory");
+			return 1;
+		}
+		if ( (got = read(0, req + len, sizeof(buf))) < 0 ) {
+			perror("sclient: reading requests");
+			return 1;
+		}
+		len += got;
+	} while ( got > 0 );
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, argv[optind]);
+
+	for ( i = 0; ; i++ ) {
+		if ( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ) {
+			perror("sclient: socket");
+			return 1;
+		}
+		if ( !connect(fd, (struct sockaddr*)&addr, sizeof(addr)) )
+			break;
+		close(fd);
+		if ( i >= 10 * wait ) {
+			perror("sclient: connecting");
+			return 1;
+		}
+		usleep(100000);
+	}
+
+	signal(SIGALRM, timedOut);
+	signal(SIGPIPE, SIG_IGN);
+
+	pfd.fd = fd;
+	for ( ;; ) {
+		pfd.events = (sent < len ? POLLOUT : 0) | (stall ? 0 : POLLIN);
+		if ( !pfd.events )
+			break;
+		if ( !stall )
+			alarm(timeout);
+		if ( (i = poll(&pfd, 1, stall ? 1000 * stall : -1)) < 0 ) {
+			if ( EINTR == errno )
+				continue;
+			perror("sclient: poll");
+			return 1;
+		}
+		if ( !i )
+			break;		/* the server doesn't take any more */
+		if ( pfd.revents & POLLOUT ) {
+			if ( (got = write(fd, req + sent, len - sent)) < 0 ) {
+				perror("sclient: sending requests");
+				return 1;
+			}
+			if ( (sent += got) == len && !stall )
+				shutdown(fd, SHUT_WR);
+		}
+		if ( pfd.revents & (POLLIN | POLLHUP | POLLERR) ) {
+			if ( (got = read(fd, buf, sizeof(buf))) < 0 ) {
+				perror("sclient: reading replies");
+				return 1;
+			}
+			if ( !got )
+				break;
+			fwrite(buf, 1, got, stdout);
+		}
+	}
+	alarm(0);
+
+	/* keep the connection (and the unread replies) for a while */
+	if ( stall )
+		sleep(stall);
+
+	close(fd);
+	free(req);
+	return 0;
+}